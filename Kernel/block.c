@@ -0,0 +1,290 @@
+#include <stdint.h>
+#include <kernel/block.h>
+#include <kernel/klog.h>
+#include <arch/bsp/emmc.h>
+#include <lib/primfunc.h>
+
+#define NONE        -1
+#define HASH(lba)   ((lba) & (BCACHE_HASH - 1))
+
+struct buf_t {
+    uint32_t lba;
+    uint8_t valid;
+    uint8_t dirty;
+    uint8_t ahead;      // read ahead and not requested yet
+    int16_t hnext;      // hash chain
+    int16_t prev;       // LRU list, the head is the most recently used
+    int16_t next;
+};
+
+__attribute__((aligned(4))) uint8_t buf_data[BCACHE_BUFFERS][BLOCK_SIZE];
+struct buf_t bufs[BCACHE_BUFFERS];
+int16_t hash_heads[BCACHE_HASH];
+int16_t lru_head;
+int16_t lru_tail;
+uint32_t n_dirty;
+uint8_t block_dev_ok;
+
+uint32_t next_seq_lba;  // block after the previous read request
+uint32_t ra_window;
+
+struct block_stats_t bstats;
+
+void lru_unlink(int16_t i)
+{
+    if (bufs[i].prev != NONE)
+        bufs[bufs[i].prev].next = bufs[i].next;
+    else
+        lru_head = bufs[i].next;
+    if (bufs[i].next != NONE)
+        bufs[bufs[i].next].prev = bufs[i].prev;
+    else
+        lru_tail = bufs[i].prev;
+}
+
+/* marks buffer i as most recently used */
+void lru_touch(int16_t i)
+{
+    if (lru_head == i)
+        return;
+    lru_unlink(i);
+    bufs[i].prev = NONE;
+    bufs[i].next = lru_head;
+    bufs[lru_head].prev = i;
+    lru_head = i;
+}
+
+int16_t lookup(uint32_t lba)
+{
+    for (int16_t i=hash_heads[HASH(lba)]; i!=NONE; i=bufs[i].hnext) {
+        if (bufs[i].lba == lba)
+            return i;
+    }
+    return NONE;
+}
+
+void hash_remove(int16_t i)
+{
+    int16_t *link = &hash_heads[HASH(bufs[i].lba)];
+    while (*link != i)
+        link = &bufs[*link].hnext;
+    *link = bufs[i].hnext;
+}
+
+void hash_insert(int16_t i, uint32_t lba)
+{
+    bufs[i].lba = lba;
+    bufs[i].hnext = hash_heads[HASH(lba)];
+    hash_heads[HASH(lba)] = i;
+}
+
+/* writes a run of consecutive dirty buffers */
+int32_t write_run(int16_t *run, uint32_t n)
+{
+    uint8_t *data[BLOCK_BATCH_MAX];
+    for (uint32_t j=0; j<n; j++)
+        data[j] = buf_data[run[j]];
+
+    bstats.dev_writes++;
+    bstats.dev_write_blocks += n;
+    if (emmc_write_blocks(bufs[run[0]].lba, n, data))
+        return BLOCK_ERR_IO;
+
+    for (uint32_t j=0; j<n; j++)
+        bufs[run[j]].dirty = 0;
+    n_dirty -= n;
+    return 0;
+}
+
+int32_t writeback()
+{
+    int16_t sorted[BCACHE_BUFFERS];
+    uint32_t n = 0;
+
+    /* dirty buffers by block number (insertion sort) */
+    for (int16_t i=0; i<BCACHE_BUFFERS; i++) {
+        if (!bufs[i].dirty)
+            continue;
+        uint32_t j = n++;
+        while ((j > 0) && (bufs[sorted[j - 1]].lba > bufs[i].lba)) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = i;
+    }
+
+    int32_t ret = 0;
+    uint32_t start = 0;
+    for (uint32_t j=1; j<=n; j++) {
+        if ((j == n) || (j - start == BLOCK_BATCH_MAX)
+            || (bufs[sorted[j]].lba != bufs[sorted[j - 1]].lba + 1)) {
+            if (write_run(&sorted[start], j - start))
+                ret = BLOCK_ERR_IO;
+            start = j;
+        }
+    }
+    return ret;
+}
+
+/* takes the least recently used buffer; it is clean, invalid and the
+most recently used afterwards, so it is not taken again by the same
+request */
+int16_t evict()
+{
+    int16_t i = lru_tail;
+    if (bufs[i].dirty)
+        writeback();
+    if (bufs[i].dirty) {
+        /* the block can not be written; give up its data */
+        klog(KLOG_ERROR, "block: lost block %u", (unsigned int) bufs[i].lba);
+        bufs[i].dirty = 0;
+        n_dirty--;
+    }
+    if (bufs[i].valid)
+        hash_remove(i);
+    bufs[i].valid = 0;
+    lru_touch(i);
+    return i;
+}
+
+/* reads n uncached blocks from lba into buffers; the blocks from
+lba+ahead on are read ahead */
+int32_t fill(uint32_t lba, uint32_t n, uint32_t ahead)
+{
+    int16_t idx[BLOCK_BATCH_MAX];
+    uint8_t *data[BLOCK_BATCH_MAX];
+    for (uint32_t j=0; j<n; j++) {
+        idx[j] = evict();
+        data[j] = buf_data[idx[j]];
+    }
+
+    bstats.dev_reads++;
+    bstats.dev_read_blocks += n;
+    if (emmc_read_blocks(lba, n, data))
+        return BLOCK_ERR_IO;
+
+    for (uint32_t j=0; j<n; j++) {
+        bufs[idx[j]].valid = 1;
+        bufs[idx[j]].ahead = (j >= ahead);
+        hash_insert(idx[j], lba + j);
+    }
+    if (n > ahead)
+        bstats.readahead += n - ahead;
+    return 0;
+}
+
+void block_init()
+{
+    for (uint32_t i=0; i<BCACHE_HASH; i++)
+        hash_heads[i] = NONE;
+    for (int16_t i=0; i<BCACHE_BUFFERS; i++) {
+        bufs[i].valid = 0;
+        bufs[i].dirty = 0;
+        bufs[i].prev = i - 1;
+        bufs[i].next = (i + 1 < BCACHE_BUFFERS) ? i + 1 : NONE;
+    }
+    lru_head = 0;
+    lru_tail = BCACHE_BUFFERS - 1;
+    n_dirty = 0;
+    ra_window = 0;
+
+    block_dev_ok = (emmc_init() == 0);
+    bstats.blocks = block_dev_ok ? emmc_block_count() : 0;
+}
+
+int32_t block_check(uint32_t lba, uint32_t count)
+{
+    if (!block_dev_ok)
+        return BLOCK_ERR_NODEV;
+    if ((lba >= bstats.blocks) || (count > bstats.blocks - lba))
+        return BLOCK_ERR_INVAL;
+    return 0;
+}
+
+int32_t block_read(uint32_t lba, uint32_t count, void *buf)
+{
+    int32_t err = block_check(lba, count);
+    if (err)
+        return err;
+
+    /* sequential requests grow the read-ahead window */
+    if ((lba == next_seq_lba) && (count > 0))
+        ra_window = ra_window ? ra_window * 2 : 4;
+    else
+        ra_window = 0;
+    if (ra_window > BLOCK_READAHEAD_MAX)
+        ra_window = BLOCK_READAHEAD_MAX;
+    next_seq_lba = lba + count;
+
+    uint32_t end = lba + count;
+    uint32_t ra_end = (bstats.blocks - end > ra_window) ? end + ra_window : bstats.blocks;
+
+    uint32_t missed_until = lba;   // blocks which were read for this request
+    for (uint32_t b=lba; b<end; b++) {
+        int16_t i = lookup(b);
+        if (i == NONE) {
+            uint32_t n = 1;
+            while ((b + n < ra_end) && (n < BLOCK_BATCH_MAX) && (lookup(b + n) == NONE))
+                n++;
+            err = fill(b, n, end - b);
+            if (err)
+                return err;
+            i = lookup(b);
+            missed_until = b + n;
+        }
+        if (b < missed_until) {
+            bstats.misses++;
+        }
+        else {
+            bstats.hits++;
+            if (bufs[i].ahead)
+                bstats.readahead_used++;
+        }
+        bufs[i].ahead = 0;
+        kmemcpy((uint8_t *) buf + (b - lba) * BLOCK_SIZE, buf_data[i], BLOCK_SIZE);
+        lru_touch(i);
+    }
+    bstats.read_blocks += count;
+    return count;
+}
+
+int32_t block_write(uint32_t lba, uint32_t count, const void *buf)
+{
+    int32_t err = block_check(lba, count);
+    if (err)
+        return err;
+
+    for (uint32_t b=lba; b<lba+count; b++) {
+        int16_t i = lookup(b);
+        if (i == NONE) {
+            /* whole blocks are written, nothing to read first */
+            i = evict();
+            bufs[i].valid = 1;
+            hash_insert(i, b);
+        }
+        kmemcpy(buf_data[i], (const uint8_t *) buf + (b - lba) * BLOCK_SIZE, BLOCK_SIZE);
+        bufs[i].ahead = 0;
+        if (!bufs[i].dirty) {
+            bufs[i].dirty = 1;
+            n_dirty++;
+        }
+        lru_touch(i);
+    }
+    bstats.write_blocks += count;
+
+    if (n_dirty >= BLOCK_DIRTY_MAX)
+        return writeback() ? BLOCK_ERR_IO : (int32_t) count;
+    return count;
+}
+
+int32_t block_sync()
+{
+    if (!block_dev_ok)
+        return BLOCK_ERR_NODEV;
+    return writeback();
+}
+
+void block_stats(struct block_stats_t *stats)
+{
+    kmemcpy(stats, &bstats, sizeof(bstats));
+}
\ No newline at end of file
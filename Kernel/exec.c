@@ -0,0 +1,293 @@
+#include <stdint.h>
+#include <kernel/exec.h>
+#include <kernel/elf.h>
+#include <kernel/tmpfs.h>
+#include <kernel/page.h>
+#include <kernel/thread.h>
+#include <kernel/klog.h>
+#include <arch/bsp/mmu.h>
+#include <lib/primfunc.h>
+
+#define PROG_END        (PROG_VADDR + L2_SIZE * L2_PAGE_SIZE)
+#define PAGE_INDEX(va)  (((va) - PROG_VADDR) >> PAGE_SHIFT)
+
+struct program_t {
+    char path[PROG_PATH_MAX];   // empty if the slot is free
+    uint32_t refs;              // processes running the program
+    uint8_t stale;              // the file changed; not used for new processes
+    uint32_t entry;
+    uint32_t ino;               // the ELF file in the tmpfs, referenced
+    uint32_t version;           // of the file when it was loaded
+    /* writable segment, loaded on demand */
+    uint32_t data_vaddr;
+    uint32_t data_filesz;
+    uint32_t data_memsz;
+    uint32_t data_offset;
+    /* L2 entries of the shared pages; copied into every process */
+    uint32_t text_map[L2_SIZE];
+    /* initial content of the data pages which hold file data, read at
+    load time; 0 for pages of the bss only */
+    uint32_t data_map[L2_SIZE];
+};
+
+struct program_t programs[MAX_PROGRAMS];
+
+/* program windows of the address spaces */
+__attribute__((aligned(0x400))) uint32_t prog_tables[MAX_THREADS][L2_SIZE];
+struct program_t *proc_program[MAX_THREADS];
+
+void str_copy(char *dest, const char *src, uint32_t max)
+{
+    uint32_t i = 0;
+    for (; (i < max - 1) && src[i]; i++)
+        dest[i] = src[i];
+    dest[i] = 0;
+}
+
+uint8_t path_equal(const char *a, const char *b)
+{
+    for (uint32_t i=0; i<PROG_PATH_MAX; i++) {
+        if (a[i] != b[i])
+            return 0;
+        if (a[i] == 0)
+            return 1;
+    }
+    return 1;
+}
+
+/* copies the part of the segment [seg_vaddr, seg_vaddr+filesz), which
+starts at offset in the file, that lies in the page at page_vaddr;
+the rest of the page is zero */
+void fill_page(uint32_t phys, uint32_t page_vaddr, uint32_t ino, uint32_t offset, uint32_t seg_vaddr, uint32_t filesz)
+{
+    kmemset((void *) phys, 0, PAGE_SIZE);
+
+    uint32_t lo = (page_vaddr > seg_vaddr) ? page_vaddr : seg_vaddr;
+    uint32_t hi = page_vaddr + PAGE_SIZE;
+    if (hi > seg_vaddr + filesz)
+        hi = seg_vaddr + filesz;
+    if (lo < hi)
+        tmpfs_read(ino, offset + (lo - seg_vaddr), (void *) (phys + (lo - page_vaddr)), hi - lo);
+}
+
+void unload(struct program_t *prog)
+{
+    for (uint32_t i=0; i<L2_SIZE; i++) {
+        if (prog->text_map[i])
+            page_free(prog->text_map[i] & ~(PAGE_SIZE - 1), 1);
+        if (prog->data_map[i])
+            page_free(prog->data_map[i], 1);
+        prog->text_map[i] = 0;
+        prog->data_map[i] = 0;
+    }
+    if (prog->path[0])
+        tmpfs_put(prog->ino);
+    prog->path[0] = 0;
+}
+
+/* checks the ELF file and loads its read-only segments */
+uint8_t load(struct program_t *prog, uint32_t ino)
+{
+    struct elf32_ehdr_t ehdr;
+    uint32_t size = tmpfs_size(ino);
+
+    if ((tmpfs_read(ino, 0, &ehdr, sizeof(ehdr)) != sizeof(ehdr)) || (ehdr.e_ident[0] != ELFMAG[0])
+        || (ehdr.e_ident[1] != ELFMAG[1]) || (ehdr.e_ident[2] != ELFMAG[2])
+        || (ehdr.e_ident[3] != ELFMAG[3]) || (ehdr.e_ident[4] != ELFCLASS32)
+        || (ehdr.e_ident[5] != ELFDATA2LSB) || (ehdr.e_type != ET_EXEC)
+        || (ehdr.e_machine != EM_ARM) || (ehdr.e_phentsize != sizeof(struct elf32_phdr_t))
+        || (ehdr.e_phoff + ehdr.e_phnum * sizeof(struct elf32_phdr_t) > size))
+        return 1;
+
+    prog->entry = ehdr.e_entry;
+    prog->data_memsz = 0;
+    for (uint32_t i=0; i<L2_SIZE; i++) {
+        prog->text_map[i] = 0;
+        prog->data_map[i] = 0;
+    }
+
+    for (uint32_t i=0; i<ehdr.e_phnum; i++) {
+        struct elf32_phdr_t phdr;
+        const struct elf32_phdr_t *ph = &phdr;
+        tmpfs_read(ino, ehdr.e_phoff + i * sizeof(phdr), &phdr, sizeof(phdr));
+        if ((ph->p_type != PT_LOAD) || (ph->p_memsz == 0))
+            continue;
+        if ((ph->p_vaddr < PROG_VADDR) || (ph->p_memsz > PROG_END - ph->p_vaddr)
+            || (ph->p_filesz > ph->p_memsz) || (ph->p_offset + ph->p_filesz > size))
+            return 1;
+
+        if (ph->p_flags & PF_W) {
+            if (prog->data_memsz)
+                return 1;   // one writable segment only
+            prog->data_vaddr = ph->p_vaddr;
+            prog->data_filesz = ph->p_filesz;
+            prog->data_memsz = ph->p_memsz;
+            prog->data_offset = ph->p_offset;
+            continue;
+        }
+
+        uint8_t xn = (ph->p_flags & PF_X) ? 0 : 1;
+        uint32_t first = PAGE_INDEX(ph->p_vaddr);
+        uint32_t last = PAGE_INDEX(ph->p_vaddr + ph->p_memsz - 1);
+        for (uint32_t p=first; p<=last; p++) {
+            uint32_t phys = page_alloc();
+            if ((phys == 0) || prog->text_map[p]) {
+                if (phys)
+                    page_free(phys, 1);
+                return 1;
+            }
+            fill_page(phys, PROG_VADDR + p * PAGE_SIZE, ino, ph->p_offset, ph->p_vaddr, ph->p_filesz);
+            prog->text_map[p] = L2_init(phys, RIGHT_BOTH_READ_ONLY, 0, xn);
+        }
+    }
+
+    /* the writable pages must not share a page with the text */
+    if (prog->data_memsz) {
+        uint32_t first = PAGE_INDEX(prog->data_vaddr);
+        uint32_t last = PAGE_INDEX(prog->data_vaddr + prog->data_memsz - 1);
+        for (uint32_t p=first; p<=last; p++) {
+            if (prog->text_map[p])
+                return 1;
+        }
+
+        /* the file may be rewritten while processes run: the data pages
+        are filled from this copy, not from the file */
+        for (uint32_t p=first; p<=last; p++) {
+            uint32_t page_vaddr = PROG_VADDR + p * PAGE_SIZE;
+            if (page_vaddr >= prog->data_vaddr + prog->data_filesz)
+                break;  // bss only
+            uint32_t phys = page_alloc();
+            if (phys == 0)
+                return 1;
+            fill_page(phys, page_vaddr, ino, prog->data_offset, prog->data_vaddr, prog->data_filesz);
+            prog->data_map[p] = phys;
+        }
+    }
+    return 0;
+}
+
+/* whether the file of prog was removed or rewritten since it was loaded */
+uint8_t changed(struct program_t *prog)
+{
+    return (tmpfs_lookup(prog->path) != (int32_t) prog->ino)
+        || (tmpfs_version(prog->ino) != prog->version);
+}
+
+struct program_t * exec_load(const char *path)
+{
+    struct program_t *free_slot = 0;
+
+    while (*path == '/')
+        path++;
+
+    for (uint32_t i=0; i<MAX_PROGRAMS; i++) {
+        struct program_t *prog = &programs[i];
+        if (prog->path[0] && !prog->stale && path_equal(prog->path, path) && changed(prog)) {
+            prog->stale = 1;
+            if (prog->refs == 0)
+                unload(prog);
+        }
+
+        if (prog->path[0] == 0) {
+            if (!free_slot)
+                free_slot = prog;
+        }
+        else if (!prog->stale && path_equal(prog->path, path)) {
+            return prog;
+        }
+    }
+
+    /* not cached: replace an unused program if all slots are taken */
+    for (uint32_t i=0; (i<MAX_PROGRAMS) && !free_slot; i++) {
+        if (programs[i].refs == 0) {
+            unload(&programs[i]);
+            free_slot = &programs[i];
+        }
+    }
+    if (!free_slot)
+        return 0;
+
+    int32_t ino = tmpfs_lookup(path);
+    if (ino < 0) {
+        klog(KLOG_WARN, "exec: %s not found", path);
+        return 0;
+    }
+
+    if (load(free_slot, ino)) {
+        klog(KLOG_WARN, "exec: %s is no valid program", path);
+        unload(free_slot);
+        return 0;
+    }
+    tmpfs_get(ino);
+    str_copy(free_slot->path, path, PROG_PATH_MAX);
+    free_slot->ino = ino;
+    free_slot->version = tmpfs_version(ino);
+    free_slot->stale = 0;
+    free_slot->refs = 0;
+    return free_slot;
+}
+
+uint32_t exec_entry(struct program_t *prog)
+{
+    return prog->entry;
+}
+
+void exec_map(struct program_t *prog, uint32_t proc)
+{
+    kmemcpy(prog_tables[proc], prog->text_map, sizeof(prog->text_map));
+    proc_program[proc] = prog;
+    prog->refs++;
+}
+
+void exec_release(uint32_t proc)
+{
+    struct program_t *prog = proc_program[proc];
+    if (!prog)
+        return;
+
+    if (prog->data_memsz) {
+        uint32_t first = PAGE_INDEX(prog->data_vaddr);
+        uint32_t last = PAGE_INDEX(prog->data_vaddr + prog->data_memsz - 1);
+        for (uint32_t p=first; p<=last; p++) {
+            if (prog_tables[proc][p])
+                page_free(prog_tables[proc][p] & ~(PAGE_SIZE - 1), 1);
+        }
+    }
+    for (uint32_t i=0; i<L2_SIZE; i++)
+        prog_tables[proc][i] = 0;
+
+    prog->refs--;
+    proc_program[proc] = 0;
+    if (prog->stale && (prog->refs == 0))
+        unload(prog);
+}
+
+uint32_t * exec_table(uint32_t proc)
+{
+    return proc_program[proc] ? prog_tables[proc] : 0;
+}
+
+uint8_t exec_fault(uint32_t proc, uint32_t addr)
+{
+    struct program_t *prog = proc_program[proc];
+    if (!prog || !prog->data_memsz || (addr < prog->data_vaddr)
+        || (addr - prog->data_vaddr >= prog->data_memsz))
+        return 0;
+
+    uint32_t p = PAGE_INDEX(addr);
+    if (prog_tables[proc][p])
+        return 0;   // mapped: a permission fault, not ours
+
+    uint32_t phys = page_alloc();
+    if (phys == 0) {
+        klog(KLOG_ERROR, "exec: out of memory for %s", prog->path);
+        return 0;
+    }
+    if (prog->data_map[p])
+        kmemcpy((void *) phys, (void *) prog->data_map[p], PAGE_SIZE);
+    else
+        kmemset((void *) phys, 0, PAGE_SIZE);
+    prog_tables[proc][p] = L2_init(phys, RIGHT_FULL_ACCESS, 0, 1);
+    mmu_tlb_flush_asid(PROC_ASID(proc));
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include <stdint.h>
+#include <kernel/file.h>
+#include <kernel/tmpfs.h>
+#include <kernel/thread.h>
+
+struct fd_t {
+    uint8_t open;
+    uint32_t ino;
+    uint32_t offset;
+    uint32_t flags;
+};
+
+struct fd_t fd_tables[MAX_THREADS][FILE_MAX_FDS];
+
+/* copies the user string path into name; returns 1 if it is too long */
+uint8_t copy_path(char *name, const char *path)
+{
+    for (uint32_t i=0; i<TMPFS_NAME_MAX; i++) {
+        name[i] = path[i];
+        if (name[i] == 0)
+            return 0;
+    }
+    return 1;
+}
+
+struct fd_t * get_fd(uint32_t proc, int32_t fd)
+{
+    if ((fd < 0) || (fd >= FILE_MAX_FDS) || !fd_tables[proc][fd].open)
+        return 0;
+    return &fd_tables[proc][fd];
+}
+
+int32_t file_open(uint32_t proc, const char *path, uint32_t flags)
+{
+    char name[TMPFS_NAME_MAX];
+    if (copy_path(name, path) || ((flags & O_ACCMODE) == O_ACCMODE))
+        return FILE_ERR_INVAL;
+
+    int32_t fd = 0;
+    while ((fd < FILE_MAX_FDS) && fd_tables[proc][fd].open)
+        fd++;
+    if (fd == FILE_MAX_FDS)
+        return FILE_ERR_MFILE;
+
+    int32_t ino = tmpfs_lookup(name);
+    if (ino < 0) {
+        if (!(flags & O_CREAT))
+            return FILE_ERR_NOENT;
+        ino = tmpfs_create(name);
+        if (ino < 0)
+            return ino;
+    }
+    else if ((flags & O_TRUNC) && ((flags & O_ACCMODE) != O_RDONLY)) {
+        tmpfs_truncate(ino);
+    }
+
+    tmpfs_get(ino);
+    fd_tables[proc][fd].open = 1;
+    fd_tables[proc][fd].ino = ino;
+    fd_tables[proc][fd].offset = 0;
+    fd_tables[proc][fd].flags = flags;
+    return fd;
+}
+
+int32_t file_read(uint32_t proc, int32_t fd, void *buf, uint32_t len)
+{
+    struct fd_t *f = get_fd(proc, fd);
+    if (!f || ((f->flags & O_ACCMODE) == O_WRONLY))
+        return FILE_ERR_BADF;
+
+    uint32_t n = tmpfs_read(f->ino, f->offset, buf, len);
+    f->offset += n;
+    return n;
+}
+
+int32_t file_write(uint32_t proc, int32_t fd, const void *buf, uint32_t len)
+{
+    struct fd_t *f = get_fd(proc, fd);
+    if (!f || ((f->flags & O_ACCMODE) == O_RDONLY))
+        return FILE_ERR_BADF;
+
+    if (f->flags & O_APPEND)
+        f->offset = tmpfs_size(f->ino);
+    uint32_t n = tmpfs_write(f->ino, f->offset, buf, len);
+    f->offset += n;
+    if ((n == 0) && (len > 0))
+        return FILE_ERR_NOSPC;
+    return n;
+}
+
+int32_t file_close(uint32_t proc, int32_t fd)
+{
+    struct fd_t *f = get_fd(proc, fd);
+    if (!f)
+        return FILE_ERR_BADF;
+
+    tmpfs_put(f->ino);
+    f->open = 0;
+    return 0;
+}
+
+int32_t file_unlink(const char *path)
+{
+    char name[TMPFS_NAME_MAX];
+    if (copy_path(name, path))
+        return FILE_ERR_NOENT;
+    return tmpfs_unlink(name);
+}
+
+int32_t file_inode(uint32_t proc, int32_t fd, uint32_t access)
+{
+    struct fd_t *f = get_fd(proc, fd);
+    if (!f)
+        return FILE_ERR_BADF;
+
+    uint32_t mode = f->flags & O_ACCMODE;
+    if ((mode == O_WRONLY) || ((access == O_RDWR) && (mode != O_RDWR)))
+        return FILE_ERR_BADF;
+    return f->ino;
+}
+
+void file_release(uint32_t proc)
+{
+    for (int32_t fd=0; fd<FILE_MAX_FDS; fd++) {
+        if (fd_tables[proc][fd].open)
+            file_close(proc, fd);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include <stdint.h>
+#include <kernel/initramfs.h>
+#include <kernel/debug.h>
+#include <kernel/klog.h>
+
+extern uint8_t _initramfs_start;
+extern uint8_t _initramfs_end;
+
+#define CPIO_MAGIC          "070701"
+#define CPIO_HEADER_SIZE    110
+#define CPIO_TRAILER        "TRAILER!!!"
+#define CPIO_MODE_TYPE      0170000
+#define CPIO_MODE_FILE      0100000
+
+/* field i of the header: 8 hex digits after the 6 chars of the magic */
+uint32_t cpio_field(const uint8_t *header, uint32_t i)
+{
+    const uint8_t *digits = header + 6 + i * 8;
+    uint32_t value = 0;
+
+    for (uint32_t j=0; j<8; j++) {
+        uint8_t c = digits[j];
+        uint32_t nibble = (c >= 'a') ? (c - 'a' + 10) : ((c >= 'A') ? (c - 'A' + 10) : (c - '0'));
+        value = (value << 4) | (nibble & 0xF);
+    }
+    return value;
+}
+
+#define CPIO_MODE       1
+#define CPIO_FILESIZE   6
+#define CPIO_NAMESIZE   11
+
+#define ALIGN4(x)       (((x) + 3) & ~3u)
+
+uint8_t str_equal(const char *a, const char *b)
+{
+    while (*a && (*a == *b)) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+uint8_t magic_ok(const uint8_t *header)
+{
+    const char *magic = CPIO_MAGIC;
+    for (uint32_t i=0; i<6; i++) {
+        if (header[i] != (uint8_t) magic[i])
+            return 0;
+    }
+    return 1;
+}
+
+void initramfs_foreach(void (*func)(const char *path, const uint8_t *data, uint32_t size))
+{
+    const uint8_t *pos = &_initramfs_start;
+    const uint8_t *end = &_initramfs_end;
+
+    while (pos + CPIO_HEADER_SIZE <= end) {
+        if (!magic_ok(pos)) {
+            WARN("initramfs: bad cpio header");
+            return;
+        }
+        uint32_t mode = cpio_field(pos, CPIO_MODE);
+        uint32_t filesize = cpio_field(pos, CPIO_FILESIZE);
+        uint32_t namesize = cpio_field(pos, CPIO_NAMESIZE);
+        const char *name = (const char *) (pos + CPIO_HEADER_SIZE);
+        const uint8_t *data = pos + ALIGN4(CPIO_HEADER_SIZE + namesize);
+
+        if (str_equal(name, CPIO_TRAILER))
+            return;
+        if ((data + filesize > end) || (name[namesize - 1] != 0)) {
+            WARN("initramfs: truncated archive");
+            return;
+        }
+        if ((mode & CPIO_MODE_TYPE) == CPIO_MODE_FILE)
+            func(name, data, filesize);
+
+        pos = data + ALIGN4(filesize);
+    }
+}
+
+/* result of the search of initramfs_find */
+const char *find_path;
+const uint8_t *find_data;
+uint32_t find_size;
+
+void find_cb(const char *path, const uint8_t *data, uint32_t size)
+{
+    if (!find_data && str_equal(path, find_path)) {
+        find_data = data;
+        find_size = size;
+    }
+}
+
+uint8_t initramfs_find(const char *path, const uint8_t **data, uint32_t *size)
+{
+    /* names in the archive have no leading slash */
+    while (*path == '/')
+        path++;
+
+    find_path = path;
+    find_data = 0;
+    initramfs_foreach(find_cb);
+    if (!find_data)
+        return 1;
+
+    *data = find_data;
+    *size = find_size;
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include <stdint.h>
+#include <stdarg.h>
+#include <kernel/klog.h>
+#include <kernel/kprintf.h>
+#include <arch/bsp/uart.h>
+#include <arch/cpu/atomic.h>
+#include <lib/time.h>
+#include <lib/math.h>
+
+/* record header inside the ring. Records are 8 byte aligned, so a
+header never wraps around the end of the buffer */
+struct klog_hdr_t {
+    uint16_t len;
+    uint8_t level;
+    volatile uint8_t committed;
+    uint32_t ts;
+};
+
+#define KLOG_HDR_SIZE       sizeof(struct klog_hdr_t)
+#define KLOG_REC_SIZE(len)  ((KLOG_HDR_SIZE + (len) + 7) & ~7)
+#define RING_IDX(pos)       ((pos) & (KLOG_RING_SIZE - 1))
+#define NO_RING             ((struct klog_ring_t *) 0)
+
+struct klog_ring_t {
+    volatile uint32_t head;     // end of reserved space (writers)
+    volatile uint32_t tail;     // oldest record (drain)
+    volatile uint32_t dropped;  // records lost because the ring was full
+    uint32_t drain_off;         // chars of the record at tail already sent
+    __attribute__((aligned(8))) char buf[KLOG_RING_SIZE];
+};
+
+struct klog_ring_t klog_rings[KLOG_N_CPUS];
+uint8_t klog_console_level = KLOG_INFO;
+volatile uint32_t klog_draining = 0;
+
+const char *klog_level_names[] = {"", "ERROR", "WARN", "INFO", "DEBUG"};
+
+void klog_drain_chars(uint32_t budget, uint8_t blocking);
+
+struct klog_ring_t * klog_this_ring()
+{
+    uint32_t mpidr;
+    asm("mrc p15, 0, %0, c0, c0, 5" : "=r" (mpidr));
+    uint32_t cpu = mpidr & 0x3;
+
+    if (cpu >= KLOG_N_CPUS)
+        cpu = 0;
+    return &klog_rings[cpu];
+}
+
+void klog_msg_init(struct klog_msg_t *msg, uint8_t level)
+{
+    msg->level = level;
+    msg->ts = (uint32_t) get_current_time();
+    msg->len = 0;
+}
+
+void klog_msg_putc(struct klog_msg_t *msg, char c)
+{
+    if (msg->len == KLOG_MAX_MSG) {
+        /* continue the message in a new record */
+        klog_msg_commit(msg);
+        msg->level = KLOG_PLAIN;
+    }
+    msg->buf[msg->len++] = c;
+}
+
+void klog_msg_puts(struct klog_msg_t *msg, const char *str)
+{
+    while (*str != '\0')
+        klog_msg_putc(msg, *str++);
+}
+
+void klog_kick()
+{
+    /* With DMA the end of a transfer starts the next one; an idle
+    channel gets the next chunk right away */
+    if (uart_dma_tx_enabled()) {
+        if (!uart_dma_tx_busy())
+            klog_drain_chars(UART_DMA_TX_MAX, 0);
+        return;
+    }
+
+    /* The transmit interrupt keeps the drain going once the UART has
+    sent something. If it is off, the UART is idle: enable it and
+    start with a single char, which never has to wait. */
+    if (!uart_tx_intr_enabled()) {
+        uart_tx_intr_enable(1);
+        klog_drain_chars(1, 0);
+    }
+}
+
+void klog_msg_commit(struct klog_msg_t *msg)
+{
+    if (msg->len == 0)
+        return;
+
+    struct klog_ring_t *ring = klog_this_ring();
+    uint32_t size = KLOG_REC_SIZE(msg->len);
+    uint32_t pos;
+
+    /* reserve space */
+    do {
+        pos = ring->head;
+        if (pos + size - ring->tail > KLOG_RING_SIZE) {
+            atomic_add_return(&ring->dropped, 1);
+            msg->len = 0;
+            return;
+        }
+    } while (atomic_cmpxchg(&ring->head, pos, pos + size) != pos);
+
+    /* fill record; the drain stops at a record which is not committed yet */
+    struct klog_hdr_t *hdr = (struct klog_hdr_t *) &ring->buf[RING_IDX(pos)];
+    hdr->len = msg->len;
+    hdr->level = msg->level;
+    hdr->ts = msg->ts;
+    for (uint32_t i=0; i<msg->len; i++)
+        ring->buf[RING_IDX(pos + KLOG_HDR_SIZE + i)] = msg->buf[i];
+    dmb();
+    hdr->committed = 1;
+
+    msg->len = 0;
+    klog_kick();
+}
+
+__attribute__((format(printf, 2, 3)))
+void klog(uint8_t level, char *fmt, ...)
+{
+    struct klog_msg_t msg;
+    klog_msg_init(&msg, level);
+
+    /* prefix: [seconds.micros] LEVEL: */
+    time_t now = get_current_time();
+    uint32_t secs = (uint32_t) divu64(now, 1000000);
+    uint32_t micros = (uint32_t) (now - (time_t) secs * 1000000);
+    kmsg_printf(&msg, "[%5u.%06u] ", (unsigned int) secs, (unsigned int) micros);
+    if (level < sizeof(klog_level_names)/sizeof(klog_level_names[0]) && level != KLOG_PLAIN) {
+        klog_msg_puts(&msg, klog_level_names[level]);
+        klog_msg_puts(&msg, ": ");
+    }
+
+    va_list argl;
+    va_start(argl, fmt);
+    kvprintf(&msg, fmt, argl);
+    va_end(argl);
+
+    if ((msg.len == 0) || (msg.buf[msg.len-1] != '\n'))
+        klog_msg_putc(&msg, '\n');
+    klog_msg_commit(&msg);
+}
+
+void klog_set_console_level(uint8_t level)
+{
+    klog_console_level = level;
+}
+
+/* returns the ring whose oldest record is the oldest of all rings */
+struct klog_ring_t * klog_oldest_ring()
+{
+    struct klog_ring_t *oldest = NO_RING;
+    uint32_t oldest_ts = 0;
+
+    for (uint32_t i=0; i<KLOG_N_CPUS; i++) {
+        struct klog_ring_t *ring = &klog_rings[i];
+        if (ring->tail == ring->head)
+            continue;
+
+        struct klog_hdr_t *hdr = (struct klog_hdr_t *) &ring->buf[RING_IDX(ring->tail)];
+        if (!hdr->committed)
+            continue;
+
+        if ((oldest == NO_RING) || ((int32_t) (hdr->ts - oldest_ts) < 0)) {
+            oldest = ring;
+            oldest_ts = hdr->ts;
+        }
+    }
+    return oldest;
+}
+
+void klog_consume(struct klog_ring_t *ring)
+{
+    struct klog_hdr_t *hdr = (struct klog_hdr_t *) &ring->buf[RING_IDX(ring->tail)];
+    uint32_t size = KLOG_REC_SIZE(hdr->len);
+
+    /* zero the record, so a header reserved later at this place
+    can not look committed before it is written */
+    for (uint32_t i=0; i<size; i++)
+        ring->buf[RING_IDX(ring->tail + i)] = 0;
+
+    ring->drain_off = 0;
+    dmb();
+    ring->tail += size;
+}
+
+void klog_drain_chars(uint32_t budget, uint8_t blocking)
+{
+    /* only one drain at a time; a drain interrupted by another one
+    simply continues afterwards */
+    if ((atomic_cmpxchg(&klog_draining, 0, 1) != 0) && !blocking)
+        return;
+
+    /* With DMA a whole chunk goes to the UART at once, the CPU only
+    collects it. The synchronous flush lets the running transfer
+    finish and polls, it may run with interrupts disabled */
+    uint8_t use_dma = uart_dma_tx_enabled() && !blocking;
+    char chunk[UART_DMA_TX_MAX];
+    uint32_t n = 0;
+    if (use_dma) {
+        if (uart_dma_tx_busy()) {
+            klog_draining = 0;
+            return;
+        }
+        budget = UART_DMA_TX_MAX;
+    }
+    else {
+        while (uart_dma_tx_busy())
+            continue;
+    }
+
+    /* report lost records; the warning goes out with this drain */
+    uint32_t dropped = 0;
+    for (uint32_t i=0; i<KLOG_N_CPUS; i++) {
+        uint32_t lost = klog_rings[i].dropped;
+        atomic_add_return(&klog_rings[i].dropped, -lost);
+        dropped += lost;
+    }
+    if (dropped)
+        klog(KLOG_WARN, "%u log records dropped", (unsigned int) dropped);
+
+    struct klog_ring_t *ring;
+    while ((budget > 0) && ((ring = klog_oldest_ring()) != NO_RING)) {
+        struct klog_hdr_t *hdr = (struct klog_hdr_t *) &ring->buf[RING_IDX(ring->tail)];
+
+        if (hdr->level <= klog_console_level) {
+            while ((ring->drain_off < hdr->len) && (budget > 0)) {
+                char c = ring->buf[RING_IDX(ring->tail + KLOG_HDR_SIZE + ring->drain_off)];
+                if (use_dma) {
+                    chunk[n++] = c;
+                }
+                else if (uart_tx_ready()) {
+                    uart_put_char(c);
+                }
+                else if (blocking) {
+                    continue;
+                }
+                else {
+                    klog_draining = 0;
+                    return;
+                }
+                ring->drain_off++;
+                budget--;
+            }
+            if (ring->drain_off < hdr->len)
+                break;
+        }
+
+        klog_consume(ring);
+    }
+
+    if (n > 0)
+        uart_dma_tx(chunk, n);
+
+    if (klog_oldest_ring() == NO_RING)
+        uart_tx_intr_enable(0);
+
+    klog_draining = 0;
+}
+
+void klog_drain()
+{
+    klog_drain_chars(KLOG_DRAIN_BUDGET, 0);
+}
+
+void klog_flush_sync()
+{
+    klog_drain_chars(~0, 1);
+}
+
+void klog_write_commit(struct klog_msg_t *msg)
+{
+    /* user output is never dropped: only a full ring waits for the UART */
+    struct klog_ring_t *ring = klog_this_ring();
+    if (ring->head + KLOG_REC_SIZE(msg->len) - ring->tail > KLOG_RING_SIZE)
+        klog_flush_sync();
+    klog_msg_commit(msg);
+}
+
+void klog_write(const char *buf, uint32_t len)
+{
+    struct klog_msg_t msg;
+    klog_msg_init(&msg, KLOG_PLAIN);
+
+    for (uint32_t i=0; i<len; i++) {
+        if (msg.len == KLOG_MAX_MSG)
+            klog_write_commit(&msg);
+        msg.buf[msg.len++] = buf[i];
+    }
+    klog_write_commit(&msg);
+}
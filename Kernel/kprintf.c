@@ -1,6 +1,6 @@
 #include <kernel/kprintf.h>
+#include <kernel/klog.h>
 
-#include <arch/bsp/uart.h>
 #include <lib/primfunc.h>
 #include <lib/math.h>
 
@@ -138,12 +138,8 @@ int32_t fieldwidth(char *str){
     return width;
 }
 
-__attribute__((format(printf, 1, 2)))
-void kprintf(char *fmt, ...)
+void kvprintf(struct klog_msg_t *msg, char *fmt, va_list argl)
 {
-    va_list argl;
-    va_start(argl,fmt);
-    
     const uint32_t buff_len = num_digits(__UINT32_MAX__, 2)+1;
     char int_buf[buff_len];
 
@@ -170,43 +166,67 @@ void kprintf(char *fmt, ...)
             /* apply replacement */
             switch(fmt[i]){
                 case 'c':
-                    uart_put_char(va_arg(argl,int));
+                    klog_msg_putc(msg, va_arg(argl,int));
                     break;
                 case 's':
-                    uart_put_str(va_arg(argl,char*));
+                    klog_msg_puts(msg, va_arg(argl,char*));
                     break;
                 case 'x':
                     hexakonv(int_buf, va_arg(argl, unsigned int), pwidth, paddingc);
-                    uart_put_str(int_buf);
+                    klog_msg_puts(msg, int_buf);
                     break;
                 case 'i':
                     intodec(int_buf, va_arg(argl,  int), pwidth, paddingc);
-                    uart_put_str(int_buf);
+                    klog_msg_puts(msg, int_buf);
                     break;
                 case 'u':
                     uintodec(int_buf, va_arg(argl, unsigned int), pwidth, paddingc);
-                    uart_put_str(int_buf);
+                    klog_msg_puts(msg, int_buf);
                     break;
                 case 'p':
                     hexakonv(int_buf, (unsigned int) va_arg(argl, void*), pwidth, ' ');
-                    uart_put_str("0x");
-                    uart_put_str(int_buf);
+                    klog_msg_puts(msg, "0x");
+                    klog_msg_puts(msg, int_buf);
                     break;
                 case '%':
-                    uart_put_char('%');
+                    klog_msg_putc(msg, '%');
                     break;
                 default:
-                    uart_put_str("error: invalid replacement format string: '");
-                    uart_put_str(fmt);
-                    uart_put_str("'\n");
+                    klog_msg_puts(msg, "error: invalid replacement format string: '");
+                    klog_msg_puts(msg, fmt);
+                    klog_msg_puts(msg, "'\n");
                     return;
             }
         }
         else {
-            uart_put_char(fmt[i]);
+            klog_msg_putc(msg, fmt[i]);
         }
 
         i++;
     }
+}
+
+__attribute__((format(printf, 2, 3)))
+void kmsg_printf(struct klog_msg_t *msg, char *fmt, ...)
+{
+    va_list argl;
+    va_start(argl,fmt);
+    kvprintf(msg, fmt, argl);
     va_end(argl);
 }
+
+__attribute__((format(printf, 1, 2)))
+void kprintf(char *fmt, ...)
+{
+    /* the message is only copied into the log ring here,
+    the UART is fed later by klog_drain() */
+    struct klog_msg_t msg;
+    klog_msg_init(&msg, KLOG_PLAIN);
+
+    va_list argl;
+    va_start(argl,fmt);
+    kvprintf(&msg, fmt, argl);
+    va_end(argl);
+
+    klog_msg_commit(&msg);
+}
@@ -0,0 +1,172 @@
+#include <stdint.h>
+#include <kernel/mmap.h>
+#include <kernel/file.h>
+#include <kernel/tmpfs.h>
+#include <kernel/page.h>
+#include <kernel/thread.h>
+#include <kernel/slab.h>
+#include <kernel/ring.h>
+#include <arch/bsp/mmu.h>
+#include <lib/primfunc.h>
+
+#define WINDOW_PAGES    (MMAP_WINDOW_MB * L2_SIZE)
+
+struct region_t {
+    struct region_t *next;  // regions of a process, sorted by first
+    uint32_t first;         // page index in the window
+    uint32_t pages;
+    uint32_t flags;
+    uint32_t ino;           // file mappings only
+    uint32_t pgoff;         // first page of the file
+};
+
+struct kmem_cache_t region_cache = KMEM_CACHE("mmap_region", sizeof(struct region_t));
+struct region_t *regions[MAX_THREADS];
+
+__attribute__((aligned(0x400))) uint32_t mmap_tables[MAX_THREADS][MMAP_WINDOW_MB][L2_SIZE];
+
+uint32_t * pte(uint32_t proc, uint32_t page)
+{
+    return &mmap_tables[proc][page / L2_SIZE][page % L2_SIZE];
+}
+
+/* first fit: the lowest gap of at least pages pages. Returns the
+link where a region at the gap is inserted and its first page in
+first, or 0 if there is no such gap */
+struct region_t ** find_gap(uint32_t proc, uint32_t pages, uint32_t *first)
+{
+    uint32_t start = 0;
+    struct region_t **link = &regions[proc];
+
+    for (; *link; link = &(*link)->next) {
+        if ((*link)->first - start >= pages)
+            break;
+        start = (*link)->first + (*link)->pages;
+    }
+    if (start + pages > WINDOW_PAGES)
+        return 0;
+    *first = start;
+    return link;
+}
+
+void * mmap_create(uint32_t proc, int32_t fd, uint32_t offset, uint32_t len, uint32_t flags)
+{
+    if ((len == 0) || (offset & (PAGE_SIZE - 1)) || !(flags & (PROT_READ | PROT_WRITE)))
+        return MAP_FAILED;
+
+    uint32_t pages = (len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    if (pages > WINDOW_PAGES)
+        return MAP_FAILED;
+    uint32_t first;
+    struct region_t **link = find_gap(proc, pages, &first);
+    if (!link)
+        return MAP_FAILED;
+
+    int32_t ino = 0;
+    if (!(flags & MAP_ANONYMOUS)) {
+        ino = file_inode(proc, fd, (flags & PROT_WRITE) ? O_RDWR : O_RDONLY);
+        if (ino < 0)
+            return MAP_FAILED;
+    }
+
+    struct region_t *r = kmem_cache_alloc(&region_cache);
+    if (!r)
+        return MAP_FAILED;
+    if (!(flags & MAP_ANONYMOUS)) {
+        tmpfs_get(ino);
+        tmpfs_pin(ino);
+        r->ino = ino;
+        r->pgoff = offset >> PAGE_SHIFT;
+    }
+    r->first = first;
+    r->pages = pages;
+    r->flags = flags;
+    r->next = *link;
+    *link = r;
+    return (void *) (MMAP_VADDR + (first << PAGE_SHIFT));
+}
+
+/* unmaps the region behind link and frees it */
+void unmap_region(uint32_t proc, struct region_t **link)
+{
+    struct region_t *r = *link;
+    for (uint32_t p=r->first; p<r->first+r->pages; p++) {
+        uint32_t *entry = pte(proc, p);
+        if (*entry && (r->flags & MAP_ANONYMOUS))
+            page_free(*entry & ~(PAGE_SIZE - 1), 1);
+        *entry = 0;
+    }
+    if (!(r->flags & MAP_ANONYMOUS)) {
+        tmpfs_unpin(r->ino);
+        tmpfs_put(r->ino);
+    }
+    *link = r->next;
+    kmem_cache_free(&region_cache, r);
+}
+
+/* whether the registered rings still use a page of r; their
+completions and reads go to the physical pages */
+uint8_t region_busy(uint32_t proc, struct region_t *r)
+{
+    for (uint32_t p=r->first; p<r->first+r->pages; p++) {
+        uint32_t *entry = pte(proc, p);
+        if (*entry && kring_uses_page(*entry & ~(PAGE_SIZE - 1)))
+            return 1;
+    }
+    return 0;
+}
+
+uint8_t mmap_remove(uint32_t proc, uint32_t addr)
+{
+    for (struct region_t **link = &regions[proc]; *link; link = &(*link)->next) {
+        if (addr == MMAP_VADDR + ((*link)->first << PAGE_SHIFT)) {
+            if (region_busy(proc, *link))
+                return MMAP_ERR_BUSY;
+            unmap_region(proc, link);
+            mmu_tlb_flush_asid(PROC_ASID(proc));
+            return 0;
+        }
+    }
+    return MMAP_ERR_NOENT;
+}
+
+void mmap_release(uint32_t proc)
+{
+    while (regions[proc])
+        unmap_region(proc, &regions[proc]);
+}
+
+uint32_t * mmap_table(uint32_t proc, uint32_t i)
+{
+    return mmap_tables[proc][i];
+}
+
+uint8_t mmap_fault(uint32_t proc, uint32_t addr)
+{
+    if ((addr < MMAP_VADDR) || (addr - MMAP_VADDR >= (WINDOW_PAGES << PAGE_SHIFT)))
+        return 0;
+
+    uint32_t page = (addr - MMAP_VADDR) >> PAGE_SHIFT;
+    struct region_t *r = regions[proc];
+    while (r && (page >= r->first + r->pages))
+        r = r->next;
+    if (!r || (page < r->first) || *pte(proc, page))
+        return 0;
+
+    uint32_t phys;
+    if (r->flags & MAP_ANONYMOUS) {
+        phys = page_alloc();
+        if (phys)
+            kmemset((void *) phys, 0, PAGE_SIZE);
+    }
+    else {
+        phys = tmpfs_page(r->ino, r->pgoff + page - r->first);
+    }
+    if (phys == 0)
+        return 0;
+
+    uint32_t right = (r->flags & PROT_WRITE) ? RIGHT_FULL_ACCESS : RIGHT_BOTH_READ_ONLY;
+    *pte(proc, page) = L2_init(phys, right, 0, 1);
+    mmu_tlb_flush_asid(PROC_ASID(proc));
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include <stdint.h>
+#include <kernel/page.h>
+#include <kernel/thread.h>
+#include <kernel/debug.h>
+#include <kernel/klog.h>
+#include <arch/bsp/mmu.h>
+#include <arch/cpu/arm.h>
+
+extern uint32_t L1_PAGE_SIZE;
+extern uint32_t _phys_ram_user_start;
+extern uint32_t _phys_ram_user_end;
+
+#define MAX_PAGES       0x10000     // 256 MiB
+#define BITMAP_WORDS    (MAX_PAGES / 32)
+
+uint32_t page_bitmap[BITMAP_WORDS];   // bit set: page is used
+uint32_t page_base;     // physical address of page 0
+uint32_t n_pages;
+uint32_t n_free;
+uint32_t next_fit;      // page index where the next search starts
+
+uint8_t page_used(uint32_t i)
+{
+    return (page_bitmap[i / 32] >> (i % 32)) & 0x1;
+}
+
+void page_mark(uint32_t i, uint8_t used)
+{
+    if (used)
+        page_bitmap[i / 32] |= (1u << (i % 32));
+    else
+        page_bitmap[i / 32] &= ~(1u << (i % 32));
+}
+
+void page_init()
+{
+    page_base = LINKER2VAL(_phys_ram_user_start) + MAX_THREADS * LINKER2VAL(L1_PAGE_SIZE);
+    n_pages = (LINKER2VAL(_phys_ram_user_end) - page_base) >> PAGE_SHIFT;
+    if (n_pages > MAX_PAGES)
+        n_pages = MAX_PAGES;
+    n_free = n_pages;
+    next_fit = 0;
+
+    for (uint32_t i=0; i<BITMAP_WORDS; i++)
+        page_bitmap[i] = 0;
+
+    klog(KLOG_INFO, "page allocator: %u pages at 0x%08x", (unsigned int) n_pages, (unsigned int) page_base);
+}
+
+uint32_t page_alloc()
+{
+    uint32_t got;
+    return page_alloc_run(1, &got);
+}
+
+uint32_t page_alloc_run(uint32_t want, uint32_t *got)
+{
+    *got = 0;
+    if (want == 0)
+        return 0;
+
+    uint32_t cpsr = irq_save();
+    if (n_free == 0) {
+        irq_restore(cpsr);
+        return 0;
+    }
+
+    /* first run of want free pages from next_fit on, wrapping around
+    once (a run does not wrap). Without such a run the longest one
+    is taken */
+    uint32_t start = 0, len = 0;        // longest run so far
+    uint32_t run = 0, run_len = 0;      // current run
+    uint32_t i = next_fit;
+    for (uint32_t n=0; (n < n_pages) && (len < want); ) {
+        if ((run_len == 0) && (page_bitmap[i / 32] == 0xFFFFFFFF)) {
+            /* skip the rest of a full word */
+            n += 32 - (i % 32);
+            i = (i | 31) + 1;
+        }
+        else {
+            if (page_used(i)) {
+                run_len = 0;
+            }
+            else {
+                if (run_len++ == 0)
+                    run = i;
+                if (run_len > len) {
+                    start = run;
+                    len = run_len;
+                }
+            }
+            n++;
+            i++;
+        }
+        if (i >= n_pages) {
+            i = 0;
+            run_len = 0;
+        }
+    }
+
+    for (uint32_t j=start; j<start+len; j++)
+        page_mark(j, 1);
+
+    n_free -= len;
+    next_fit = (start + len < n_pages) ? start + len : 0;
+    irq_restore(cpsr);
+
+    *got = len;
+    return (len > 0) ? page_base + (start << PAGE_SHIFT) : 0;
+}
+
+void page_free(uint32_t phys, uint32_t n)
+{
+    uint32_t first = (phys - page_base) >> PAGE_SHIFT;
+
+    uint32_t cpsr = irq_save();
+    for (uint32_t i=first; i<first+n; i++) {
+        if ((i >= n_pages) || !page_used(i)) {
+            WARN("page_free: page is not allocated");
+            continue;
+        }
+        page_mark(i, 0);
+        n_free++;
+    }
+    irq_restore(cpsr);
+}
+
+uint32_t page_free_count()
+{
+    return n_free;
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include <stdint.h>
+#include <kernel/prof.h>
+#include <kernel/trace.h>
+#include <kernel/kprintf.h>
+#include <kernel/klog.h>
+#include <arch/bsp/timer.h>
+#include <arch/bsp/intr.h>
+#include <arch/cpu/arm.h>
+
+#define PROF_FLUSH_LINES    32  // lines printed before the log ring is flushed
+
+struct prof_sample_t prof_buf[PROF_BUF_SIZE];
+uint32_t prof_n_samples = 0;
+uint32_t prof_dropped = 0;
+uint32_t prof_hz = 0;       // 0 while stopped
+
+void prof_sample(void *arg)
+{
+    struct registers_t *reg = (struct registers_t *) arg;
+    if ((prof_hz == 0) || (reg == NO_REGISTERS))
+        return;
+
+    if (prof_n_samples == PROF_BUF_SIZE) {
+        prof_dropped++;
+        return;
+    }
+
+    /* the trap frame holds the cpsr and lr of the interrupted context */
+    struct trap_frame_t *frame = TRAP_FRAME(reg);
+    uint8_t mode = frame->spsr & PSR_MODE_MASK;
+
+    struct mode_registers mreg = {0, 0, 0};
+    switch (mode) {
+        case PSR_USR:
+        case PSR_SYS: mreg.lr = frame->usr_lr; break;
+        case PSR_SUP: mreg.lr = frame->svc_lr; break;
+        case PSR_ABT: _get_regs_abt(&mreg); break;
+        case PSR_UND: _get_regs_und(&mreg); break;
+        default: break;
+    }
+
+    struct prof_sample_t *sample = &prof_buf[prof_n_samples++];
+    sample->pc = reg->lr;
+    sample->lr = mreg.lr;
+    sample->tid = trace_current_tid();
+    sample->mode = mode;
+    sample->reserved = 0;
+}
+
+void prof_start(uint32_t hz)
+{
+    if (hz == 0)
+        hz = PROF_DEFAULT_HZ;
+    if (hz > PROF_MAX_HZ)
+        hz = PROF_MAX_HZ;
+
+    prof_n_samples = 0;
+    prof_dropped = 0;
+    prof_hz = hz;
+    setup_timer(PROF_TIMER, 1000000 / hz, &prof_sample);
+}
+
+void prof_stop()
+{
+    prof_hz = 0;
+    interrupt_disable(IRQ_TIMER_BASE + PROF_TIMER, 0);
+}
+
+void prof_dump()
+{
+    /* the dump is a debugging action, so it is fine to wait for the UART */
+    uint32_t hz = prof_hz;
+    prof_hz = 0;
+
+    klog_flush_sync();
+    kprintf("PROF_BEGIN %u %u %u\n", (unsigned int) prof_n_samples,
+        (unsigned int) (hz ? hz : PROF_DEFAULT_HZ), (unsigned int) prof_dropped);
+    for (uint32_t i=0; i<prof_n_samples; i++) {
+        struct prof_sample_t *sample = &prof_buf[i];
+        kprintf("P %08x %08x %u %x\n", (unsigned int) sample->pc, (unsigned int) sample->lr,
+            (unsigned int) sample->tid, (unsigned int) sample->mode);
+
+        if ((i % PROF_FLUSH_LINES) == 0)
+            klog_flush_sync();
+    }
+    kprintf("PROF_END\n");
+    klog_flush_sync();
+
+    prof_hz = hz;
+}
\ No newline at end of file
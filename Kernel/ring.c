@@ -0,0 +1,311 @@
+#include <stdint.h>
+#include <kernel/ring.h>
+#include <kernel/thread.h>
+#include <kernel/klog.h>
+#include <kernel/page.h>
+#include <arch/cpu/arm.h>
+#include <arch/cpu/atomic.h>
+#include <arch/bsp/uart.h>
+
+#define MAX_RINGS   8
+
+/* an operation which waits for input or time */
+struct ring_pending_t {
+    uint8_t used;
+    struct ring_sqe_t sqe;
+    uint32_t phys;      // buffer of RING_OP_READ
+    uint32_t done;      // chars read so far
+    time_t wake_at;     // end of RING_OP_SLEEP
+};
+
+struct kring_t {
+    struct ring_t *ring;    // physical address; 0 if unused
+    uint16_t tid;
+    uint8_t waiting;        // the owner blocks in ring_enter()
+    uint32_t wait_min;
+    uint32_t n_pending;
+    struct ring_pending_t pending[RING_MAX_PENDING];
+};
+
+struct kring_t krings[MAX_RINGS];
+
+struct kring_t * ring_of(uint16_t tid)
+{
+    for (uint32_t i=0; i<MAX_RINGS; i++) {
+        if (krings[i].ring && krings[i].tid == tid)
+            return &krings[i];
+    }
+    return 0;
+}
+
+uint32_t cq_used(struct kring_t *kr)
+{
+    return kr->ring->cq_tail - kr->ring->cq_head;
+}
+
+/* completions which are posted or promised to the consumed submissions */
+uint32_t cq_reserved(struct kring_t *kr)
+{
+    return cq_used(kr) + kr->n_pending;
+}
+
+void wake_waiter(struct kring_t *kr)
+{
+    if (kr->waiting && (cq_used(kr) >= kr->wait_min)) {
+        kr->waiting = 0;
+        thread_ring_wakeup(kr->tid);
+    }
+}
+
+void cq_post(struct kring_t *kr, uint32_t user_data, int32_t res, uint32_t op)
+{
+    struct ring_t *ring = kr->ring;
+    uint32_t tail = ring->cq_tail;
+    struct ring_cqe_t *cqe = &ring->cq[tail % RING_ENTRIES];
+
+    cqe->user_data = user_data;
+    cqe->res = res;
+    cqe->op = op;
+    dmb();  // the entry is visible before the new tail
+    ring->cq_tail = tail + 1;
+
+    wake_waiter(kr);
+}
+
+void pending_complete(struct kring_t *kr, struct ring_pending_t *p, int32_t res)
+{
+    p->used = 0;
+    kr->n_pending--;
+    cq_post(kr, p->sqe.user_data, res, p->sqe.op);
+}
+
+struct ring_pending_t * pending_add(struct kring_t *kr, struct ring_sqe_t *sqe)
+{
+    for (uint32_t i=0; i<RING_MAX_PENDING; i++) {
+        struct ring_pending_t *p = &kr->pending[i];
+        if (!p->used) {
+            p->used = 1;
+            p->sqe = *sqe;
+            p->done = 0;
+            kr->n_pending++;
+            return p;
+        }
+    }
+    return 0;
+}
+
+uint8_t kring_setup(uint16_t tid, struct ring_t *ring)
+{
+    if (ring_of(tid))
+        return 1;
+
+    for (uint32_t i=0; i<MAX_RINGS; i++) {
+        struct kring_t *kr = &krings[i];
+        if (kr->ring == 0) {
+            kr->tid = tid;
+            kr->waiting = 0;
+            kr->n_pending = 0;
+            for (uint32_t j=0; j<RING_MAX_PENDING; j++)
+                kr->pending[j].used = 0;
+            ring->sq_head = ring->sq_tail = 0;
+            ring->cq_head = ring->cq_tail = 0;
+            kr->ring = ring;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void kring_release(uint16_t tid)
+{
+    struct kring_t *kr = ring_of(tid);
+    if (kr)
+        kr->ring = 0;
+}
+
+/* whether [addr, addr+len) overlaps the page at page */
+uint8_t in_page(uint32_t addr, uint32_t len, uint32_t page)
+{
+    return (addr < page + PAGE_SIZE) && (addr + len > page);
+}
+
+uint8_t kring_uses_page(uint32_t phys)
+{
+    for (uint32_t i=0; i<MAX_RINGS; i++) {
+        struct kring_t *kr = &krings[i];
+        if (kr->ring == 0)
+            continue;
+        if (in_page((uint32_t) kr->ring, sizeof(struct ring_t), phys))
+            return 1;
+        for (uint32_t j=0; j<RING_MAX_PENDING; j++) {
+            struct ring_pending_t *p = &kr->pending[j];
+            if (p->used && (p->sqe.op == RING_OP_READ) && in_page(p->phys, p->sqe.len, phys))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/* copies chars of the console input into the buffers of pending reads */
+void ring_read(struct kring_t *kr, struct ring_pending_t *p)
+{
+    char *buf = (char *) p->phys;
+
+    while ((p->done < p->sqe.len) && uart_char_available()) {
+        /* the UART top half writes the input buffer as well */
+        uint32_t cpsr = irq_save();
+        buf[p->done++] = uart_get_char();
+        irq_restore(cpsr);
+    }
+    if (p->done > 0)
+        pending_complete(kr, p, p->done);
+}
+
+void ring_send_msg(struct kring_t *kr, struct ring_sqe_t *sqe)
+{
+    struct kring_t *target = ring_of((uint16_t) sqe->arg);
+
+    if (target == 0) {
+        cq_post(kr, sqe->user_data, RING_ERR_NOENT, sqe->op);
+    }
+    else if (cq_reserved(target) >= RING_ENTRIES) {
+        cq_post(kr, sqe->user_data, RING_ERR_AGAIN, sqe->op);
+    }
+    else {
+        cq_post(target, sqe->len, kr->tid, RING_OP_MSG);
+        cq_post(kr, sqe->user_data, 0, sqe->op);
+    }
+}
+
+void ring_start(struct kring_t *kr, struct ring_sqe_t *sqe, time_t now)
+{
+    struct ring_pending_t *p;
+    uint32_t phys;
+
+    switch (sqe->op) {
+    case RING_OP_NOP:
+        cq_post(kr, sqe->user_data, 0, sqe->op);
+        break;
+    case RING_OP_WRITE:
+        phys = thread_user_to_phys(kr->tid, sqe->addr, sqe->len, 0);
+        if (phys == 0) {
+            cq_post(kr, sqe->user_data, RING_ERR_INVAL, sqe->op);
+            break;
+        }
+        klog_write((char *) phys, sqe->len);
+        cq_post(kr, sqe->user_data, sqe->len, sqe->op);
+        break;
+    case RING_OP_READ:
+        phys = thread_user_to_phys(kr->tid, sqe->addr, sqe->len, 1);
+        if ((phys == 0) || (sqe->len == 0)) {
+            cq_post(kr, sqe->user_data, RING_ERR_INVAL, sqe->op);
+            break;
+        }
+        p = pending_add(kr, sqe);
+        p->phys = phys;
+        ring_read(kr, p);
+        break;
+    case RING_OP_SLEEP:
+        if (sqe->arg == 0) {
+            cq_post(kr, sqe->user_data, 0, sqe->op);
+            break;
+        }
+        p = pending_add(kr, sqe);
+        p->wake_at = now + (time_t) sqe->arg * 1000;
+        break;
+    case RING_OP_MSG:
+        ring_send_msg(kr, sqe);
+        break;
+    default:
+        cq_post(kr, sqe->user_data, RING_ERR_INVAL, sqe->op);
+        break;
+    }
+}
+
+uint32_t kring_submit(uint16_t tid, time_t now)
+{
+    struct kring_t *kr = ring_of(tid);
+    if (kr == 0)
+        return 0;
+
+    struct ring_t *ring = kr->ring;
+    uint32_t n = 0;
+    uint32_t tail = ring->sq_tail;
+    dmb();  // read the entries after the tail
+
+    while (ring->sq_head != tail) {
+        /* copy: the user may change the entry while it is processed */
+        struct ring_sqe_t sqe = ring->sq[ring->sq_head % RING_ENTRIES];
+
+        /* stop if the completion or the pending slot would not fit */
+        if (cq_reserved(kr) >= RING_ENTRIES)
+            break;
+        if (((sqe.op == RING_OP_READ) || (sqe.op == RING_OP_SLEEP))
+            && (kr->n_pending >= RING_MAX_PENDING))
+            break;
+
+        ring->sq_head++;
+        n++;
+        ring_start(kr, &sqe, now);
+    }
+    return n;
+}
+
+uint8_t kring_wait(uint16_t tid, uint32_t min_complete)
+{
+    struct kring_t *kr = ring_of(tid);
+    if ((kr == 0) || (cq_used(kr) >= min_complete))
+        return 1;
+
+    kr->waiting = 1;
+    kr->wait_min = (min_complete > RING_ENTRIES) ? RING_ENTRIES : min_complete;
+    return 0;
+}
+
+void kring_uart_rx()
+{
+    for (uint32_t i=0; (i<MAX_RINGS) && uart_char_available(); i++) {
+        struct kring_t *kr = &krings[i];
+        if (kr->ring == 0)
+            continue;
+        for (uint32_t j=0; j<RING_MAX_PENDING; j++) {
+            struct ring_pending_t *p = &kr->pending[j];
+            if (p->used && (p->sqe.op == RING_OP_READ))
+                ring_read(kr, p);
+        }
+    }
+}
+
+void kring_timer(time_t now)
+{
+    for (uint32_t i=0; i<MAX_RINGS; i++) {
+        struct kring_t *kr = &krings[i];
+        if (kr->ring == 0)
+            continue;
+        for (uint32_t j=0; j<RING_MAX_PENDING; j++) {
+            struct ring_pending_t *p = &kr->pending[j];
+            if (p->used && (p->sqe.op == RING_OP_SLEEP) && (p->wake_at <= now))
+                pending_complete(kr, p, 0);
+        }
+    }
+}
+
+time_t kring_next_timeout(time_t now, time_t max)
+{
+    time_t timeout = max;
+
+    for (uint32_t i=0; i<MAX_RINGS; i++) {
+        struct kring_t *kr = &krings[i];
+        if (kr->ring == 0)
+            continue;
+        for (uint32_t j=0; j<RING_MAX_PENDING; j++) {
+            struct ring_pending_t *p = &kr->pending[j];
+            if (p->used && (p->sqe.op == RING_OP_SLEEP)) {
+                time_t left = (p->wake_at > now) ? (p->wake_at - now) : 1;
+                if (left < timeout)
+                    timeout = left;
+            }
+        }
+    }
+    return timeout;
+}
\ No newline at end of file
@@ -0,0 +1,549 @@
+#include <stdint.h>
+#include <kernel/sched.h>
+#include <lib/math.h>
+#include <lib/rbtree.h>
+
+uint32_t sched_policy = SCHED_POLICY_DEFAULT;
+
+/* the ordinary thread which runs next if there is no current one */
+volatile struct sched_node_t * volatile runqueue = NO_NODE;
+volatile struct sched_node_t * volatile current = NO_NODE;
+volatile struct sched_node_t * volatile sleepqueue = NO_NODE;
+volatile struct sched_node_t * volatile dl_queue = NO_NODE;   // ready deadline threads, earliest first
+uint32_t dl_total_density = 0;
+time_t account_at = 0;
+
+/* fair class */
+struct rb_tree_t fair_groups = RB_TREE_INIT;    // groups with queued threads
+struct sched_group_t default_group;             // threads without a group of their own
+time_t fair_min_vruntime = 0;                   // monotonic lower bound of the groups
+uint32_t fair_queued = 0;                       // ready and running threads
+
+#define GROUP_OF_RB(n)  ((struct sched_group_t *) ((char *) (n) - __builtin_offsetof(struct sched_group_t, se.rb)))
+#define NODE_OF_RB(n)   ((volatile struct sched_node_t *) ((char *) (n) - __builtin_offsetof(struct sched_node_t, fair.se.rb)))
+#define FAIR_RB(node)   ((struct rb_node_t *) &(node)->fair.se.rb)
+
+/* weights of the nice levels -20..19; a level is worth about 10 % CPU
+time against a thread one level apart (the table of Linux) */
+const uint32_t nice_weights[SCHED_NICE_MAX - SCHED_NICE_MIN + 1] = {
+    88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+     9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+     1024,   820,   655,   526,   423,   335,   272,   215,   172,   137,
+      110,    87,    70,    56,    45,    36,    29,    23,    18,    15,
+};
+
+void sched_init()
+{
+    runqueue = NO_NODE;
+    current = NO_NODE;
+    sleepqueue = NO_NODE;
+    dl_queue = NO_NODE;
+    dl_total_density = 0;
+    account_at = 0;
+
+    fair_groups.root = 0;
+    fair_groups.leftmost = 0;
+    sched_group_init(&default_group);
+    fair_min_vruntime = 0;
+    fair_queued = 0;
+}
+
+void sched_group_init(struct sched_group_t *group)
+{
+    group->se.vruntime = 0;
+    group->se.weight = SCHED_NICE0_WEIGHT;
+    group->threads.root = 0;
+    group->threads.leftmost = 0;
+    group->nr_queued = 0;
+    group->min_vruntime = 0;
+}
+
+void sched_set_group(volatile struct sched_node_t *node, struct sched_group_t *group)
+{
+    node->fair.group = group;
+    node->fair.se.vruntime = 0;
+    node->fair.se.weight = SCHED_NICE0_WEIGHT;
+    node->fair.nice = 0;
+}
+
+uint8_t sched_set_nice(volatile struct sched_node_t *node, int32_t nice)
+{
+    if ((nice < SCHED_NICE_MIN) || (nice > SCHED_NICE_MAX))
+        return 1;
+    /* the weight only changes how fast the virtual runtime grows from
+    now on, the position in the tree stays valid */
+    node->fair.nice = nice;
+    node->fair.se.weight = nice_weights[nice - SCHED_NICE_MIN];
+    return 0;
+}
+
+volatile struct sched_node_t * sched_current()
+{
+    return current;
+}
+
+/* the current thread if it is part of the round robin ring */
+volatile struct sched_node_t * ring_current()
+{
+    if ((current != NO_NODE) && !current->dl.active && !(sched_policy & SCHED_FAIR))
+        return current;
+    return NO_NODE;
+}
+
+/* inserts node into the ring before pos */
+void ring_insert_before(volatile struct sched_node_t *node, volatile struct sched_node_t *pos)
+{
+    node->next = pos;
+    node->prev = pos->prev;
+    pos->prev->next = node;
+    pos->prev = node;
+}
+
+/* inserts node into the deadline queue; equal deadlines keep their order */
+void dl_insert(volatile struct sched_node_t *node)
+{
+    volatile struct sched_node_t *prev = NO_NODE;
+    volatile struct sched_node_t *pos = dl_queue;
+
+    while ((pos != NO_NODE) && (pos->dl.abs_deadline <= node->dl.abs_deadline)) {
+        prev = pos;
+        pos = pos->next;
+    }
+
+    node->prev = prev;
+    node->next = pos;
+    if (prev == NO_NODE)
+        dl_queue = node;
+    else
+        prev->next = node;
+    if (pos != NO_NODE)
+        pos->prev = node;
+}
+
+void dl_unlink(volatile struct sched_node_t *node)
+{
+    if (node->prev == NO_NODE)
+        dl_queue = node->next;
+    else
+        node->prev->next = node->next;
+    if (node->next != NO_NODE)
+        node->next->prev = node->prev;
+}
+
+struct sched_group_t * fair_group(volatile struct sched_node_t *node)
+{
+    return node->fair.group ? node->fair.group : &default_group;
+}
+
+/* an entity that was not queued starts at most SCHED_FAIR_WAKEUP_BONUS
+behind the others, so a sleeper can not collect CPU time */
+void fair_place(volatile struct sched_entity_t *se, time_t min_vruntime)
+{
+    if (min_vruntime > SCHED_FAIR_WAKEUP_BONUS) {
+        time_t floor = min_vruntime - SCHED_FAIR_WAKEUP_BONUS;
+        if (se->vruntime < floor)
+            se->vruntime = floor;
+    }
+    se->rb.key = se->vruntime;
+}
+
+/* raises the lower bounds to the smallest queued virtual runtime */
+void fair_update_min(struct sched_group_t *group)
+{
+    if (group->threads.leftmost && (group->threads.leftmost->key > group->min_vruntime))
+        group->min_vruntime = group->threads.leftmost->key;
+    if (fair_groups.leftmost && (fair_groups.leftmost->key > fair_min_vruntime))
+        fair_min_vruntime = fair_groups.leftmost->key;
+}
+
+void fair_enqueue(volatile struct sched_node_t *node)
+{
+    struct sched_group_t *group = fair_group(node);
+
+    if (group->nr_queued == 0) {
+        fair_place(&group->se, fair_min_vruntime);
+        rb_insert(&fair_groups, &group->se.rb);
+    }
+    fair_place(&node->fair.se, group->min_vruntime);
+    rb_insert(&group->threads, FAIR_RB(node));
+    group->nr_queued++;
+    fair_queued++;
+}
+
+void fair_dequeue(volatile struct sched_node_t *node)
+{
+    struct sched_group_t *group = fair_group(node);
+
+    rb_erase(&group->threads, FAIR_RB(node));
+    group->nr_queued--;
+    fair_queued--;
+    if (group->nr_queued == 0)
+        rb_erase(&fair_groups, &group->se.rb);
+}
+
+/* virtual runtime of delta us at the given weight */
+time_t fair_scale(time_t delta, uint32_t weight)
+{
+    if (weight == SCHED_NICE0_WEIGHT)
+        return delta;
+    return divu64(delta * SCHED_NICE0_WEIGHT, weight);
+}
+
+/* charges delta us to the current thread and its group; both move
+to their new position in the trees */
+void fair_charge(time_t delta)
+{
+    volatile struct sched_node_t *node = current;
+    struct sched_group_t *group = fair_group(node);
+
+    rb_erase(&group->threads, FAIR_RB(node));
+    node->fair.se.vruntime += fair_scale(delta, node->fair.se.weight);
+    node->fair.se.rb.key = node->fair.se.vruntime;
+    rb_insert(&group->threads, FAIR_RB(node));
+
+    rb_erase(&fair_groups, &group->se.rb);
+    group->se.vruntime += fair_scale(delta, group->se.weight);
+    group->se.rb.key = group->se.vruntime;
+    rb_insert(&fair_groups, &group->se.rb);
+
+    fair_update_min(group);
+}
+
+/* next thread of the fair class: the first thread of the first group */
+volatile struct sched_node_t * fair_first()
+{
+    if (!fair_groups.leftmost)
+        return NO_NODE;
+    return NODE_OF_RB(GROUP_OF_RB(fair_groups.leftmost)->threads.leftmost);
+}
+
+void sched_yield()
+{
+    if (!(sched_policy & SCHED_FAIR) || (current == NO_NODE) || current->dl.active)
+        return;
+
+    struct sched_group_t *group = fair_group(current);
+    struct rb_node_t *last = rb_last(&group->threads);
+    if (last == FAIR_RB(current))
+        return;
+
+    rb_erase(&group->threads, FAIR_RB(current));
+    current->fair.se.vruntime = last->key;
+    current->fair.se.rb.key = last->key;
+    rb_insert(&group->threads, FAIR_RB(current));   // behind last: equal keys keep their order
+    fair_update_min(group);
+}
+
+void sched_add_ready(volatile struct sched_node_t *node)
+{
+    node->state = READY;
+
+    if (node->dl.active) {
+        dl_insert(node);
+        return;
+    }
+    if (sched_policy & SCHED_FAIR) {
+        fair_enqueue(node);
+        return;
+    }
+
+    volatile struct sched_node_t *ring_cur = ring_current();
+    if (runqueue == NO_NODE) {
+        node->prev = node;
+        node->next = node;
+        runqueue = node;
+    }
+    else if (sched_policy & SCHED_INSERT_TAIL) {
+        /* the current thread runs last in the ring order; without one
+        the ring starts at runqueue */
+        ring_insert_before(node, (ring_cur != NO_NODE) ? ring_cur : runqueue);
+    }
+    else {
+        /* run next */
+        if (ring_cur != NO_NODE) {
+            ring_insert_before(node, ring_cur->next);
+        }
+        else {
+            ring_insert_before(node, runqueue);
+            runqueue = node;
+        }
+    }
+}
+
+void sched_remove(volatile struct sched_node_t *node)
+{
+    if (node->dl.active) {
+        dl_unlink(node);
+    }
+    else if (sched_policy & SCHED_FAIR) {
+        fair_dequeue(node);
+    }
+    else if (node->next == node) {  // is true if its the only thread on the runqueue
+        runqueue = NO_NODE;
+    }
+    else {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        /* the successor runs next */
+        if ((runqueue == node) || (current == node))
+            runqueue = node->next;
+    }
+
+    if (current == node)
+        current = NO_NODE;
+    node->prev = NO_NODE;
+    node->next = NO_NODE;
+}
+
+volatile struct sched_node_t * sched_pick_next()
+{
+    volatile struct sched_node_t *ring_next = runqueue;
+    volatile struct sched_node_t *ring_cur = ring_current();
+
+    if (current != NO_NODE)
+        current->state = READY;
+    if (ring_cur != NO_NODE)
+        ring_next = ring_cur->next;
+
+    if (sched_policy & SCHED_FAIR) {
+        current = (dl_queue != NO_NODE) ? dl_queue : fair_first();
+        if (current == NO_NODE)
+            return NO_NODE;
+    }
+    else if (dl_queue != NO_NODE) {
+        /* deadline threads first; a preempted ordinary thread
+        continues afterwards */
+        if (ring_cur != NO_NODE)
+            runqueue = ring_cur;
+        current = dl_queue;
+    }
+    else if (ring_next == NO_NODE) {
+        current = NO_NODE;
+        return NO_NODE;
+    }
+    else {
+        runqueue = ring_next;
+        current = runqueue;
+    }
+
+    current->state = RUNNING;
+    return current;
+}
+
+void sched_switch_to(volatile struct sched_node_t *node)
+{
+    volatile struct sched_node_t *ring_cur = ring_current();
+
+    if (current != NO_NODE)
+        current->state = READY;
+
+    if (node->dl.active) {
+        if (ring_cur != NO_NODE)
+            runqueue = ring_cur;
+        dl_insert(node);
+    }
+    else if (sched_policy & SCHED_FAIR) {
+        fair_enqueue(node);
+    }
+    else {
+        if (runqueue == NO_NODE) {
+            node->prev = node;
+            node->next = node;
+        }
+        else {
+            ring_insert_before(node, (ring_cur != NO_NODE) ? ring_cur->next : runqueue);
+        }
+        runqueue = node;
+    }
+    current = node;
+    node->state = RUNNING;
+}
+
+void sched_sleep(volatile struct sched_node_t *node, time_t wake_at)
+{
+    sched_remove(node);
+    node->state = WAITING;
+    node->wake_at = wake_at;
+
+    /* keep the sleepqueue sorted; threads with the same wake-up time
+    stay in the order they went to sleep */
+    volatile struct sched_node_t * volatile *pos = &sleepqueue;
+    while ((*pos != NO_NODE) && ((*pos)->wake_at <= wake_at))
+        pos = &(*pos)->next_sleeping;
+    node->next_sleeping = *pos;
+    *pos = node;
+}
+
+void sched_wake(time_t now, sched_wake_hook_t hook)
+{
+    while ((sleepqueue != NO_NODE) && (sleepqueue->wake_at <= now)) {
+        volatile struct sched_node_t *node = sleepqueue;
+        sleepqueue = node->next_sleeping;
+        node->next_sleeping = NO_NODE;
+
+        sched_add_ready(node);
+        if (hook)
+            hook(node, now);
+        node->wake_at = 0;
+    }
+}
+
+time_t sched_next_wakeup()
+{
+    /* the queue is sorted by wake_at, so no sleeper after the first
+    one with wake_at >= latest can lower the bound */
+    time_t latest = 0;
+    for (volatile struct sched_node_t *node = sleepqueue; node != NO_NODE; node = node->next_sleeping) {
+        if (latest && (node->wake_at >= latest))
+            break;
+        time_t bound = node->wake_at + (node->dl.active ? 0 : node->slack);
+        if (!latest || (bound < latest))
+            latest = bound;
+    }
+    return latest;
+}
+
+time_t sched_timer_interval(time_t now, time_t tick)
+{
+    /* scheduler timing rule:
+    - usually: the tick
+    - a deadline thread runs: at the latest when its runtime is used up
+    - a thread of the fair class runs and others are ready: after its
+      share of SCHED_FAIR_LATENCY
+    - no thread is ready, deadline threads exist or SCHED_TIMER_WAKEUP:
+      at the latest when the next thread has to wake up (its slack
+      included, see sched_next_wakeup)
+    */
+    time_t interval = tick;
+
+    if ((current != NO_NODE) && current->dl.active) {
+        time_t left = (current->dl.used < current->dl.runtime) ? (current->dl.runtime - current->dl.used) : 1;
+        if (left < interval)
+            interval = left;
+    }
+
+    if ((current != NO_NODE) && !current->dl.active && (fair_queued > 1)) {
+        time_t slice = SCHED_FAIR_LATENCY / fair_queued;
+        if (slice < SCHED_FAIR_MIN_SLICE)
+            slice = SCHED_FAIR_MIN_SLICE;
+        if (slice < interval)
+            interval = slice;
+    }
+
+    uint8_t idle = (runqueue == NO_NODE) && (fair_queued == 0) && (dl_queue == NO_NODE);
+    if ((sleepqueue != NO_NODE) && (idle || (dl_total_density > 0) || (sched_policy & SCHED_TIMER_WAKEUP))) {
+        time_t wakeup = sched_next_wakeup();
+        time_t until_wakeup = (wakeup > now) ? (wakeup - now) : 1;
+        if (until_wakeup < interval)
+            interval = until_wakeup;
+    }
+    return interval;
+}
+
+void sched_account(time_t now)
+{
+    if ((current != NO_NODE) && (now > account_at)) {
+        if (current->dl.active)
+            current->dl.used += now - account_at;
+        else if (sched_policy & SCHED_FAIR)
+            fair_charge(now - account_at);
+    }
+    account_at = now;
+}
+
+uint8_t sched_setdeadline(volatile struct sched_node_t *node, time_t runtime, time_t period,
+    time_t deadline, time_t now)
+{
+    uint32_t density = 0;
+
+    if (runtime != 0) {
+        if ((runtime > deadline) || (deadline > period) || (period > 0xFFFFFFFF))
+            return 1;
+
+        density = (uint32_t) divu64(runtime << SCHED_DL_SHIFT, (uint32_t) deadline);
+        uint32_t others = dl_total_density - (node->dl.active ? node->dl.density : 0);
+        if (others + density > SCHED_DL_MAX_DENSITY)
+            return 1;
+    }
+    else if (!node->dl.active) {
+        return 0;
+    }
+
+    /* change the queue of a ready thread */
+    uint8_t queued = (node->state == READY) || (node->state == RUNNING);
+    uint8_t was_current = (node == current);
+    if (queued)
+        sched_remove(node);
+
+    sched_release(node);
+    if (runtime != 0) {
+        node->dl.active = 1;
+        node->dl.runtime = runtime;
+        node->dl.period = period;
+        node->dl.deadline = deadline;
+        node->dl.period_start = now;
+        node->dl.abs_deadline = now + deadline;
+        node->dl.used = 0;
+        node->dl.density = density;
+        dl_total_density += density;
+    }
+
+    if (queued) {
+        sched_add_ready(node);
+        if (was_current) {
+            current = node;
+            node->state = RUNNING;
+        }
+    }
+    return 0;
+}
+
+void sched_release(volatile struct sched_node_t *node)
+{
+    if (node->dl.active) {
+        dl_total_density -= node->dl.density;
+        node->dl.active = 0;
+        node->dl.density = 0;
+    }
+}
+
+/* starts the next job of a deadline thread; periods which are over
+already are skipped */
+void dl_next_job(volatile struct sched_node_t *node, time_t now)
+{
+    node->dl.period_start += node->dl.period;
+    while (node->dl.period_start + node->dl.period <= now)
+        node->dl.period_start += node->dl.period;
+
+    node->dl.abs_deadline = node->dl.period_start + node->dl.deadline;
+    node->dl.used = 0;
+
+    if (node->dl.period_start > now) {
+        sched_sleep(node, node->dl.period_start);
+    }
+    else {
+        /* the period has begun already: new position in the queue */
+        sched_remove(node);
+        sched_add_ready(node);
+    }
+}
+
+time_t sched_next_period(volatile struct sched_node_t *node, time_t now)
+{
+    if (!node->dl.active)
+        return 0;
+
+    time_t lateness = (now > node->dl.abs_deadline) ? (now - node->dl.abs_deadline) : 0;
+    dl_next_job(node, now);
+    return lateness;
+}
+
+volatile struct sched_node_t * sched_throttle(time_t now)
+{
+    volatile struct sched_node_t *node = current;
+    if ((node == NO_NODE) || !node->dl.active || (node->dl.used < node->dl.runtime))
+        return NO_NODE;
+
+    dl_next_job(node, now);
+    return node;
+}
\ No newline at end of file
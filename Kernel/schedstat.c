@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <kernel/schedstat.h>
+#include <lib/primfunc.h>
+#include <lib/math.h>
+
+#define LOADAVG_ONE     (1 << LOADAVG_SHIFT)
+
+/* exp(-5s/1min), exp(-5s/5min), exp(-5s/15min) as fixed point numbers */
+const uint32_t loadavg_exp[3] = {1884, 2014, 2037};
+
+struct schedstat_t schedstat_all;
+time_t loadavg_next = 0;    // time of the next sample
+
+void hist_add(struct lat_hist_t *hist, time_t us)
+{
+    uint32_t value = (us > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) us;
+    uint32_t bucket = 0;
+    while ((value >> (bucket + 1)) && (bucket < SCHEDSTAT_BUCKETS - 1))
+        bucket++;
+
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->sum_us += value;
+    if (value > hist->max_us)
+        hist->max_us = value;
+}
+
+void schedstat_wait(struct schedstat_t *thread, time_t us)
+{
+    hist_add(&thread->runq_wait, us);
+    hist_add(&schedstat_all.runq_wait, us);
+}
+
+void schedstat_wakeup(struct schedstat_t *thread, time_t us)
+{
+    hist_add(&thread->wake_late, us);
+    hist_add(&schedstat_all.wake_late, us);
+}
+
+void schedstat_slice(struct schedstat_t *thread, time_t us)
+{
+    hist_add(&thread->slice, us);
+    hist_add(&schedstat_all.slice, us);
+}
+
+void schedstat_irq(uint32_t us)
+{
+    hist_add(&schedstat_all.irq_late, us);
+}
+
+void schedstat_reset()
+{
+    kmemset(&schedstat_all.runq_wait, 0, sizeof(struct lat_hist_t));
+    kmemset(&schedstat_all.wake_late, 0, sizeof(struct lat_hist_t));
+    kmemset(&schedstat_all.slice, 0, sizeof(struct lat_hist_t));
+    kmemset(&schedstat_all.irq_late, 0, sizeof(struct lat_hist_t));
+    schedstat_all.nr_running_max = schedstat_all.nr_running;
+}
+
+void schedstat_tick(time_t now, uint32_t nr_running)
+{
+    schedstat_all.nr_running = nr_running;
+    if (nr_running > schedstat_all.nr_running_max)
+        schedstat_all.nr_running_max = nr_running;
+
+    if (loadavg_next == 0)
+        loadavg_next = now + LOADAVG_INTERVAL;
+
+    /* one sample per interval, also for the intervals without a tick */
+    while (now >= loadavg_next) {
+        for (uint32_t i=0; i<3; i++) {
+            uint32_t load = schedstat_all.loadavg[i];
+            schedstat_all.loadavg[i] = (load * loadavg_exp[i]
+                + nr_running * LOADAVG_ONE * (LOADAVG_ONE - loadavg_exp[i])) >> LOADAVG_SHIFT;
+        }
+        loadavg_next += LOADAVG_INTERVAL;
+    }
+}
+
+void hist_export(struct lat_hist_t *hist)
+{
+    hist->avg_us = hist->count ? (uint32_t) divu64(hist->sum_us, hist->count) : 0;
+}
+
+void schedstat_export(struct schedstat_t *dst, const struct schedstat_t *src)
+{
+    kmemcpy(dst, src ? src : &schedstat_all, sizeof(struct schedstat_t));
+    hist_export(&dst->runq_wait);
+    hist_export(&dst->wake_late);
+    hist_export(&dst->slice);
+    hist_export(&dst->irq_late);
+}
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include <stdint.h>
+#include <kernel/slab.h>
+#include <kernel/page.h>
+#include <kernel/klog.h>
+#include <arch/cpu/arm.h>
+#include <lib/primfunc.h>
+
+struct slab_t {
+    struct kmem_cache_t *cache; // 0: a large kmalloc() block
+    struct slab_t *next;
+    struct slab_t *prev;
+    void *free;                 // free objects, linked through their first word
+    uint32_t in_use;            // objects; pages of a large block
+};
+
+#define SLAB_HDR_SIZE   ((sizeof(struct slab_t) + 7) & ~7)
+#define SLAB_OF(obj)    ((struct slab_t *) ((uint32_t) (obj) & ~(PAGE_SIZE - 1)))
+
+struct kmem_cache_t kmalloc_caches[KMALLOC_CLASSES] = {
+    KMEM_CACHE("kmalloc-16", 16),
+    KMEM_CACHE("kmalloc-32", 32),
+    KMEM_CACHE("kmalloc-64", 64),
+    KMEM_CACHE("kmalloc-128", 128),
+    KMEM_CACHE("kmalloc-256", 256),
+    KMEM_CACHE("kmalloc-512", 512),
+    KMEM_CACHE("kmalloc-1024", 1024),
+    KMEM_CACHE("kmalloc-2048", 2048),
+};
+
+struct kmem_cache_t *kmem_caches = 0;   // caches with at least one allocation
+uint32_t kmalloc_large_blocks = 0;
+uint32_t kmalloc_large_pages = 0;
+
+void slab_push(struct slab_t **list, struct slab_t *slab)
+{
+    slab->prev = 0;
+    slab->next = *list;
+    if (*list)
+        (*list)->prev = slab;
+    *list = slab;
+}
+
+void slab_unlink(struct slab_t **list, struct slab_t *slab)
+{
+    if (slab->prev)
+        slab->prev->next = slab->next;
+    else
+        *list = slab->next;
+    if (slab->next)
+        slab->next->prev = slab->prev;
+}
+
+/* adds a new slab to the partial list; returns 0 if there is no page */
+struct slab_t * slab_grow(struct kmem_cache_t *cache)
+{
+    if (cache->per_slab == 0) {
+        cache->per_slab = (PAGE_SIZE - SLAB_HDR_SIZE) / cache->size;
+        cache->next = kmem_caches;
+        kmem_caches = cache;
+    }
+
+    struct slab_t *slab = (struct slab_t *) page_alloc();
+    if (!slab)
+        return 0;
+
+    slab->cache = cache;
+    slab->in_use = 0;
+    slab->free = 0;
+    uint8_t *obj = (uint8_t *) slab + SLAB_HDR_SIZE;
+    for (uint32_t i=0; i<cache->per_slab; i++, obj += cache->size) {
+        *(void **) obj = slab->free;
+        slab->free = obj;
+    }
+
+    slab_push(&cache->partial, slab);
+    cache->slabs++;
+    cache->empty_slabs++;
+    return slab;
+}
+
+void * kmem_cache_alloc(struct kmem_cache_t *cache)
+{
+    uint32_t cpsr = irq_save();
+
+    struct slab_t *slab = cache->partial;
+    if (!slab && !(slab = slab_grow(cache))) {
+        cache->failures++;
+        irq_restore(cpsr);
+        return 0;
+    }
+
+    void *obj = slab->free;
+    slab->free = *(void **) obj;
+    if (slab->in_use++ == 0)
+        cache->empty_slabs--;
+    if (!slab->free) {
+        slab_unlink(&cache->partial, slab);
+        slab_push(&cache->full, slab);
+    }
+
+    cache->in_use++;
+    cache->allocs++;
+    irq_restore(cpsr);
+    return obj;
+}
+
+void kmem_cache_free(struct kmem_cache_t *cache, void *obj)
+{
+    uint32_t cpsr = irq_save();
+    struct slab_t *slab = SLAB_OF(obj);
+
+    if (!slab->free) {
+        slab_unlink(&cache->full, slab);
+        slab_push(&cache->partial, slab);
+    }
+    *(void **) obj = slab->free;
+    slab->free = obj;
+    cache->in_use--;
+    cache->frees++;
+
+    /* keep one empty slab, so an alloc/free pair at the boundary does
+    not allocate and free a page every time */
+    if (--slab->in_use == 0) {
+        if (cache->empty_slabs > 0) {
+            slab_unlink(&cache->partial, slab);
+            page_free((uint32_t) slab, 1);
+            cache->slabs--;
+        }
+        else {
+            cache->empty_slabs++;
+        }
+    }
+    irq_restore(cpsr);
+}
+
+void * kmalloc(uint32_t size)
+{
+    if (size == 0)
+        return 0;
+
+    if (size <= KMALLOC_MAX) {
+        uint32_t i = 0;
+        while (((uint32_t) KMALLOC_MIN << i) < size)
+            i++;
+        return kmem_cache_alloc(&kmalloc_caches[i]);
+    }
+
+    /* large block: contiguous pages behind a slab header */
+    uint32_t pages = (size + SLAB_HDR_SIZE + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    uint32_t cpsr = irq_save();
+    uint32_t got;
+    uint32_t phys = page_alloc_run(pages, &got);
+    if (phys && (got < pages)) {
+        page_free(phys, got);
+        phys = 0;
+    }
+    if (!phys) {
+        irq_restore(cpsr);
+        return 0;
+    }
+
+    struct slab_t *slab = (struct slab_t *) phys;
+    slab->cache = 0;
+    slab->in_use = pages;
+    kmalloc_large_blocks++;
+    kmalloc_large_pages += pages;
+    irq_restore(cpsr);
+    return (uint8_t *) slab + SLAB_HDR_SIZE;
+}
+
+void * kzalloc(uint32_t size)
+{
+    void *ptr = kmalloc(size);
+    if (ptr)
+        kmemset(ptr, 0, size);
+    return ptr;
+}
+
+void kfree(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    struct slab_t *slab = SLAB_OF(ptr);
+    if (slab->cache) {
+        kmem_cache_free(slab->cache, ptr);
+        return;
+    }
+
+    uint32_t cpsr = irq_save();
+    kmalloc_large_blocks--;
+    kmalloc_large_pages -= slab->in_use;
+    page_free((uint32_t) slab, slab->in_use);
+    irq_restore(cpsr);
+}
+
+void kmem_print_stats()
+{
+    for (struct kmem_cache_t *c=kmem_caches; c; c=c->next) {
+        klog(KLOG_INFO, "kmem %s: size %u, %u in use, %u slabs, %u allocs, %u frees, %u failed",
+            c->name, (unsigned int) c->size, (unsigned int) c->in_use, (unsigned int) c->slabs,
+            (unsigned int) c->allocs, (unsigned int) c->frees, (unsigned int) c->failures);
+    }
+    klog(KLOG_INFO, "kmem large blocks: %u in %u pages", (unsigned int) kmalloc_large_blocks,
+        (unsigned int) kmalloc_large_pages);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include <stdint.h>
+#include <kernel/softirq.h>
+#include <kernel/debug.h>
+#include <arch/cpu/arm.h>
+#include <arch/cpu/atomic.h>
+
+void scheduler(void);
+
+void (*softirq_handlers[N_SOFTIRQS])(void);
+volatile uint32_t softirq_pending = 0;  // bit nr is set if softirq nr is pending
+volatile uint8_t softirq_running = 0;   // an irq_exit() is processing softirqs
+volatile uint8_t need_resched = 0;
+
+void softirq_register(uint32_t nr, void (*handler)(void))
+{
+    if (nr >= N_SOFTIRQS) {
+        WARN("Invalid softirq number.");
+        return;
+    }
+    softirq_handlers[nr] = handler;
+}
+
+void raise_softirq(uint32_t nr)
+{
+    atomic_or(&softirq_pending, 1u << nr);
+}
+
+void softirq_resched()
+{
+    need_resched = 1;
+}
+
+void resched_check()
+{
+    if (need_resched && !softirq_running) {
+        need_resched = 0;
+        scheduler();
+    }
+}
+
+void irq_exit()
+{
+    /* interrupted a softirq: that irq_exit() finishes the work and
+    the interrupted context is kernel code, which must not be switched */
+    if (softirq_running)
+        return;
+
+    softirq_running = 1;
+    uint32_t pending;
+    while ((pending = atomic_xchg(&softirq_pending, 0)) != 0) {
+        for (uint32_t nr=0; nr<N_SOFTIRQS; nr++) {
+            if ((pending & (1u << nr)) && softirq_handlers[nr])
+                _softirq_call(softirq_handlers[nr]);
+        }
+    }
+    softirq_running = 0;
+
+    /* interrupts are disabled again; a top half which comes now is
+    handled after the return to the thread. The interrupted context
+    may be a preemptible syscall: its state is on its kernel stack */
+    resched_check();
+}
\ No newline at end of file
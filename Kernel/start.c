@@ -5,6 +5,14 @@
 #include <user/userthread.h>
 #include <config.h>
 #include <arch/bsp/mmu.h>
+#include <kernel/timepage.h>
+#include <arch/cpu/pmu.h>
+#include <kernel/klog.h>
+#include <kernel/softirq.h>
+#include <kernel/page.h>
+#include <kernel/tmpfs.h>
+#include <kernel/block.h>
+#include <arch/bsp/dma.h>
 
 void _leave_kernel();
 
@@ -12,15 +20,22 @@ void start_kernel()
 {
 	kprintf("Starting practOS ...\n");
 
+	dma_init();
 	uart_enable();
 	SWITCH_PROC_MODE(PSR_SYS);
 	asm("cpsie if"); // enable interrupts
 	SWITCH_PROC_MODE(PSR_SUP);
 	
 	mmu_init();
+	timepage_init();
+	page_init();
+	tmpfs_init();
+	block_init();
+	pmu_init();
 
+	softirq_register(SOFTIRQ_KLOG, klog_drain);
 	init_threads();
-	kthread_create(NO_REGISTERS, main, 0, 0, 1);
+	kthread_create(main, 0, 0, 1);
 	kprintf("practOS ready.\n");
 
 	start_scheduling();    
@@ -3,14 +3,47 @@
 #include <kernel/thread.h>
 #include <arch/cpu/arm.h>
 #include <arch/cpu/mm.h>
+#include <arch/cpu/pmu.h>
 #include <arch/bsp/uart.h>
+#include <arch/bsp/power.h>
 #include <kernel/debug.h>
+#include <kernel/kprintf.h>
+#include <kernel/trace.h>
+#include <kernel/prof.h>
+#include <kernel/file.h>
+#include <kernel/tmpfs.h>
+#include <kernel/mmap.h>
+#include <kernel/block.h>
+#include <kernel/slab.h>
 
 void handle_exit(struct registers_t *reg);
 void handle_kthread_create(struct registers_t *reg);
 void handle_sleep(struct registers_t *reg);
 void handle_read_char(struct registers_t *reg);
 void handle_write_char(struct registers_t *reg);
+void handle_trace_mark(struct registers_t *reg);
+void handle_trace_ctl(struct registers_t *reg);
+void handle_getrusage(struct registers_t *reg);
+void handle_yield(struct registers_t *reg);
+void handle_shutdown(struct registers_t *reg);
+void handle_prof_ctl(struct registers_t *reg);
+void handle_set_deadline(struct registers_t *reg);
+void handle_next_period(struct registers_t *reg);
+void handle_ring_setup(struct registers_t *reg);
+void handle_ring_enter(struct registers_t *reg);
+void handle_spawn(struct registers_t *reg);
+void handle_open(struct registers_t *reg);
+void handle_read(struct registers_t *reg);
+void handle_write(struct registers_t *reg);
+void handle_close(struct registers_t *reg);
+void handle_unlink(struct registers_t *reg);
+void handle_mmap(struct registers_t *reg);
+void handle_munmap(struct registers_t *reg);
+void handle_block_io(struct registers_t *reg);
+void handle_sched_stats(struct registers_t *reg);
+void handle_sleep_until(struct registers_t *reg);
+void handle_set_timer_slack(struct registers_t *reg);
+void handle_set_nice(struct registers_t *reg);
 
 void (*syscall_callbacks[])(struct registers_t *reg) =
 {
@@ -18,7 +51,63 @@ void (*syscall_callbacks[])(struct registers_t *reg) =
     handle_kthread_create,
     handle_sleep,
     handle_read_char,
-    handle_write_char
+    handle_write_char,
+    handle_trace_mark,
+    handle_trace_ctl,
+    handle_getrusage,
+    handle_yield,
+    handle_shutdown,
+    handle_prof_ctl,
+    handle_set_deadline,
+    handle_next_period,
+    handle_ring_setup,
+    handle_ring_enter,
+    handle_spawn,
+    handle_open,
+    handle_read,
+    handle_write,
+    handle_close,
+    handle_unlink,
+    handle_mmap,
+    handle_munmap,
+    handle_block_io,
+    handle_sched_stats,
+    handle_sleep_until,
+    handle_set_timer_slack,
+    handle_set_nice
+};
+
+/* 1: the syscall runs with interrupts enabled and the kernel lock held */
+const uint8_t syscall_preemptible[] =
+{
+    1,  // exit: releases the process
+    1,  // thread_create: copies the globals
+    0,  // sleep
+    0,  // read_char
+    0,  // write_char
+    0,  // trace_mark
+    1,  // trace_ctl: dump
+    0,  // getrusage
+    0,  // yield
+    0,  // shutdown
+    1,  // prof_ctl: dump
+    0,  // set_deadline
+    0,  // next_period
+    0,  // ring_setup
+    0,  // ring_enter
+    1,  // spawn: loads the program
+    1,  // open
+    1,  // read
+    1,  // write
+    1,  // close
+    1,  // unlink
+    1,  // mmap
+    1,  // munmap
+    1,  // block_io: waits for the card
+    0,  // sched_stats
+    0,  // sleep_until
+    0,  // set_timer_slack
+    0   // set_nice
 };
 
 uint8_t process_svc_code(uint32_t svc_code, struct registers_t *reg)
@@ -31,7 +120,16 @@ uint8_t process_svc_code(uint32_t svc_code, struct registers_t *reg)
     if (svc_code>=N_SYSCALL_CODES)
         return 1;
 
-    syscall_callbacks[svc_code](reg);
+    if (syscall_preemptible[svc_code]) {
+        kernel_lock();
+        IRQ_ENABLE();
+        syscall_callbacks[svc_code](reg);
+        IRQ_DISABLE();
+        kernel_unlock();
+    }
+    else {
+        syscall_callbacks[svc_code](reg);
+    }
 
     return 0;
 }
@@ -39,7 +137,8 @@ uint8_t process_svc_code(uint32_t svc_code, struct registers_t *reg)
 
 void handle_exit(struct registers_t *reg)
 {
-    terminate_current_thread(reg);
+    (void) reg;
+    terminate_current_thread();
 }
 
 void handle_kthread_create(struct registers_t *reg)
@@ -49,12 +148,30 @@ void handle_kthread_create(struct registers_t *reg)
     uint32_t args_size = (uint32_t) reg->base_registers[2];
     uint8_t is_proc = (uint32_t) reg->base_registers[3];
 
-    kthread_create(reg, func_handle, args, args_size, is_proc);
+    if (thread_user_access(args, args_size, 0))
+        kthread_create(func_handle, args, args_size, is_proc);
 }
 
 void handle_sleep(struct registers_t *reg) {
     uint32_t millis_to_sleep = reg->base_registers[0];
-    thread_make_sleep_current(reg, millis_to_sleep);
+    thread_make_sleep_current(millis_to_sleep);
+}
+
+void handle_sleep_until(struct registers_t *reg)
+{
+    // 64 bit argument: low word in r0, high word in r1
+    time_t wake_at = ((time_t) reg->base_registers[1] << 32) | reg->base_registers[0];
+    thread_sleep_until(wake_at);
+}
+
+void handle_set_timer_slack(struct registers_t *reg)
+{
+    reg->base_registers[0] = thread_set_timer_slack(reg->base_registers[0]);
+}
+
+void handle_set_nice(struct registers_t *reg)
+{
+    reg->base_registers[0] = thread_set_nice((int32_t) reg->base_registers[0]);
 }
 
 void handle_read_char(struct registers_t *reg)
@@ -63,19 +180,254 @@ void handle_read_char(struct registers_t *reg)
     char *c = (char*) reg->base_registers[0];
     uint8_t ret_val;
 
+    // the char is written to c in user mode, or later by the kernel
+    if (!thread_user_access(c, 1, 1)) {
+        ret_val = 1;
+    }
     // deliver char if available
-    if (uart_char_available()) {
+    else if (uart_char_available()) {
         *c = uart_get_char();
         ret_val = 0;
     }
     // otherwise let thread wait for char
     else {
-        ret_val = thread_wait_for_char(reg);
+        ret_val = thread_wait_for_char(c);
     }
     
     reg->base_registers[0] = ret_val;   // this is the return value of the user function
 }
 
 void handle_write_char(struct registers_t *reg) {
-    uart_put_char((char) reg->base_registers[0]);
+    char c = (char) reg->base_registers[0];
+    klog_write(&c, 1);
+}
+
+void handle_trace_mark(struct registers_t *reg)
+{
+    uint32_t id = reg->base_registers[0];
+    uint32_t value = reg->base_registers[1];
+    trace_event(TRACE_USER_MARK, trace_current_tid(), id, value);
+}
+
+void handle_trace_ctl(struct registers_t *reg)
+{
+    switch (reg->base_registers[0]) {
+        case TRACE_CTL_STOP:
+            trace_enable(0);
+            break;
+        case TRACE_CTL_START:
+            trace_enable(1);
+            break;
+        case TRACE_CTL_DUMP:
+            trace_dump();
+            break;
+        default:
+            break;
+    }
+}
+
+void handle_getrusage(struct registers_t *reg)
+{
+    int32_t tid = (int32_t) reg->base_registers[0];
+    struct rusage_t *usage = (struct rusage_t *) reg->base_registers[1];
+
+    if (!thread_user_access(usage, sizeof(struct rusage_t), 1))
+        reg->base_registers[0] = 1;
+    else
+        reg->base_registers[0] = thread_getrusage(tid, usage);
+}
+
+void handle_sched_stats(struct registers_t *reg)
+{
+    int32_t tid = (int32_t) reg->base_registers[0];
+    struct schedstat_t *stats = (struct schedstat_t *) reg->base_registers[1];
+
+    /* checked before: the export runs with interrupts disabled */
+    if (!thread_user_access(stats, sizeof(struct schedstat_t), 1))
+        reg->base_registers[0] = 1;
+    else
+        reg->base_registers[0] = thread_schedstat(tid, stats);
+}
+
+void handle_yield(struct registers_t *reg)
+{
+    (void) reg;
+    thread_yield();
+}
+
+void handle_shutdown(struct registers_t *reg)
+{
+    (void) reg;
+    if (!thread_in_init()) {
+        klog(KLOG_WARN, "shutdown refused: thread %u is not in the init process",
+            (unsigned int) trace_current_tid());
+        return;
+    }
+    kmem_print_stats();
+    kprintf("practOS shutting down.\n");
+    power_reset();
+}
+
+void handle_prof_ctl(struct registers_t *reg)
+{
+    uint32_t op = reg->base_registers[0];
+    uint32_t hz = reg->base_registers[1];
+
+    switch (op) {
+        case PROF_CTL_STOP:
+            prof_stop();
+            break;
+        case PROF_CTL_START:
+            prof_start(hz);
+            break;
+        case PROF_CTL_DUMP:
+            prof_dump();
+            break;
+        case PROF_CTL_PMU_USER:
+            if (!thread_in_init()) {
+                klog(KLOG_WARN, "PMU access refused: thread %u is not in the init process",
+                    (unsigned int) trace_current_tid());
+                break;
+            }
+            pmu_user_access(1);
+            break;
+        default:
+            break;
+    }
+}
+
+void handle_set_deadline(struct registers_t *reg)
+{
+    uint32_t runtime = reg->base_registers[0];
+    uint32_t period = reg->base_registers[1];
+    uint32_t deadline = reg->base_registers[2];
+
+    reg->base_registers[0] = thread_setdeadline(runtime, period, deadline);
+}
+
+void handle_next_period(struct registers_t *reg)
+{
+    reg->base_registers[0] = thread_next_period();
+}
+
+void handle_ring_setup(struct registers_t *reg)
+{
+    reg->base_registers[0] = thread_ring_setup(reg->base_registers[0]);
+}
+
+void handle_ring_enter(struct registers_t *reg)
+{
+    reg->base_registers[0] = thread_ring_enter(reg->base_registers[0]);
+}
+
+void handle_spawn(struct registers_t *reg)
+{
+    const char *path = (const char *) reg->base_registers[0];
+    const void *args = (const void *) reg->base_registers[1];
+    uint32_t args_size = reg->base_registers[2];
+
+    reg->base_registers[0] = thread_spawn(path, args, args_size);
+}
+
+void handle_open(struct registers_t *reg)
+{
+    const char *path = (const char *) reg->base_registers[0];
+    uint32_t flags = reg->base_registers[1];
+
+    if (!thread_user_string(path, TMPFS_NAME_MAX))
+        reg->base_registers[0] = FILE_ERR_FAULT;
+    else
+        reg->base_registers[0] = file_open(thread_current_proc(), path, flags);
+}
+
+void handle_read(struct registers_t *reg)
+{
+    int32_t fd = (int32_t) reg->base_registers[0];
+    void *buf = (void *) reg->base_registers[1];
+    uint32_t len = reg->base_registers[2];
+
+    if (!thread_user_access(buf, len, 1))
+        reg->base_registers[0] = FILE_ERR_FAULT;
+    else
+        reg->base_registers[0] = file_read(thread_current_proc(), fd, buf, len);
+}
+
+void handle_write(struct registers_t *reg)
+{
+    int32_t fd = (int32_t) reg->base_registers[0];
+    const void *buf = (const void *) reg->base_registers[1];
+    uint32_t len = reg->base_registers[2];
+
+    if (!thread_user_access(buf, len, 0))
+        reg->base_registers[0] = FILE_ERR_FAULT;
+    else
+        reg->base_registers[0] = file_write(thread_current_proc(), fd, buf, len);
+}
+
+void handle_close(struct registers_t *reg)
+{
+    reg->base_registers[0] = file_close(thread_current_proc(), (int32_t) reg->base_registers[0]);
+}
+
+void handle_unlink(struct registers_t *reg)
+{
+    const char *path = (const char *) reg->base_registers[0];
+
+    if (!thread_user_string(path, TMPFS_NAME_MAX))
+        reg->base_registers[0] = FILE_ERR_FAULT;
+    else
+        reg->base_registers[0] = file_unlink(path);
+}
+
+void handle_mmap(struct registers_t *reg)
+{
+    int32_t fd = (int32_t) reg->base_registers[0];
+    uint32_t offset = reg->base_registers[1];
+    uint32_t len = reg->base_registers[2];
+    uint32_t flags = reg->base_registers[3];
+
+    reg->base_registers[0] = (uint32_t) mmap_create(thread_current_proc(), fd, offset, len, flags);
+}
+
+void handle_munmap(struct registers_t *reg)
+{
+    reg->base_registers[0] = mmap_remove(thread_current_proc(), reg->base_registers[0]);
+}
+
+void handle_block_io(struct registers_t *reg)
+{
+    uint32_t op = reg->base_registers[0];
+    uint32_t lba = reg->base_registers[1];
+    void *buf = (void *) reg->base_registers[2];
+    uint32_t count = reg->base_registers[3];
+    int32_t ret;
+
+    /* block_read() and block_write() bound lba + count by the card */
+    uint8_t buf_ok = (count <= 0xFFFFFFFF / BLOCK_SIZE)
+        && thread_user_access(buf, count * BLOCK_SIZE, op == BLOCK_OP_READ);
+
+    switch (op) {
+        case BLOCK_OP_READ:
+            ret = buf_ok ? block_read(lba, count, buf) : BLOCK_ERR_FAULT;
+            break;
+        case BLOCK_OP_WRITE:
+            ret = buf_ok ? block_write(lba, count, buf) : BLOCK_ERR_FAULT;
+            break;
+        case BLOCK_OP_SYNC:
+            ret = block_sync();
+            break;
+        case BLOCK_OP_STATS:
+            if (thread_user_access(buf, sizeof(struct block_stats_t), 1)) {
+                block_stats((struct block_stats_t *) buf);
+                ret = 0;
+            }
+            else {
+                ret = BLOCK_ERR_FAULT;
+            }
+            break;
+        default:
+            ret = BLOCK_ERR_INVAL;
+            break;
+    }
+    reg->base_registers[0] = ret;
 }
\ No newline at end of file
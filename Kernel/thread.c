@@ -1,7 +1,21 @@
 #include <stdint.h>
 #include <config.h>
 #include <kernel/thread.h>
+#include <kernel/sched.h>
 #include <kernel/debug.h>
+#include <kernel/timepage.h>
+#include <kernel/klog.h>
+#include <kernel/trace.h>
+#include <kernel/rusage.h>
+#include <kernel/schedstat.h>
+#include <kernel/softirq.h>
+#include <kernel/tls.h>
+#include <kernel/ring.h>
+#include <kernel/exec.h>
+#include <kernel/file.h>
+#include <kernel/mmap.h>
+#include <kernel/page.h>
+#include <arch/cpu/pmu.h>
 #include <arch/cpu/arm.h>
 #include <arch/cpu/exceptions.h>
 #include <arch/cpu/mm.h>
@@ -9,6 +23,7 @@
 #include <arch/bsp/regcheck.h>
 #include <arch/bsp/uart.h>
 #include <arch/bsp/mmu.h>
+#include <arch/bsp/dma.h>
 #include <lib/primfunc.h>
 #include <lib/time.h>
 #include <user/sys.h>
@@ -21,94 +36,86 @@ extern uint32_t _data_user_end;
 extern uint32_t _ram_user_start;
 extern uint32_t _ram_user_end;
 extern uint32_t _phys_ram_user_start;
+extern uint32_t _text_user_start;
+extern uint32_t _text_user_end;
 
-#define MAX_THREADS     32
 #define N_L2_TABLES     MAX_THREADS
 
 #define USR_DEFAULT_CPSR  PSR_USR
-#define NO_THREAD   ((volatile struct list_elem_t *) 0)
 #define NO_TCB      ((volatile struct tcb_t *) 0)
 #define NO_CONTEXT   ((struct registers_t *) 0)
-
-enum thread_state_t {READY, RUNNING, WAITING, TERMINATED};
-
-struct list_elem_t {
-    volatile struct list_elem_t *prev;
-    volatile struct list_elem_t *next;
-};
+#define TCB_ID(tcb)  ((uint16_t) ((tcb) - tcbs))
+#define TCB_OF(node) ((struct tcb_t *) (node))   // sched is the first member of tcb_t
 
 struct tcb_t {
-    struct  list_elem_t rq;
-    struct  context_t context;
-    enum    thread_state_t state;
-    volatile struct  tcb_t * next_sleeping;
-    time_t  wake_at;
+    struct  sched_node_t sched;
+    uint32_t kstack;        // base of the kernel stack, kept when the tcb is reused
+    uint32_t ksp;           // kernel sp while the thread is switched out
+    uint8_t klock_wait;     // blocked in kernel_lock()
     int32_t stack_i;
     int32_t L2_table_i;
+    uint32_t tls;           // virtual address of the TLS block, loaded into TPIDRURO
+    struct  rusage_t usage;
+    struct  pmu_counts_t pmu_in;    // counters when the thread was switched in
+    time_t  running_since;
+    time_t  slice_start;    // switch in
+    time_t  ready_since;    // 0 if the thread does not wait for the CPU
+    struct  schedstat_t stats;
 };
 
 volatile struct tcb_t tcbs[MAX_THREADS];
-volatile struct list_elem_t * volatile runqueue = NO_THREAD;
-volatile struct tcb_t * volatile sleepqueue = NO_TCB;
+volatile struct tcb_t * volatile running = NO_TCB;  // owner of the kernel stack in use; NO_TCB: idle loop
+uint32_t idle_ksp;      // kernel sp of the idle loop (boot stack) while a thread runs
 volatile struct tcb_t * volatile char_thread = NO_TCB;  // this thread will get the incoming char
+uint32_t char_dest;     // where the char goes, virtual address of char_thread
+volatile struct tcb_t * volatile klock_owner = NO_TCB;
+uint32_t klock_depth = 0;
+volatile struct tcb_t * accounted_tcb = NO_TCB;  // thread the CPU time is currently charged to
+struct rusage_t idle_usage;
 
 /* L2 tables must be 1024(=0x400) Byte aligned in order to store
 the L2 pointers in L1 table */
 __attribute__((aligned(0x400))) uint32_t L2_Tables[N_L2_TABLES][L2_SIZE];
 uint32_t L2_Table_references[N_L2_TABLES]; // stores number of references on L2 table
 
+/* TTBR0 table of each process, see arch/bsp/mmu.h; it runs with
+PROC_ASID() of its L2 table */
+__attribute__((aligned(MMU_PROC_L1_ALIGN))) uint32_t proc_L1[N_L2_TABLES][MMU_PROC_L1_SIZE];
+int32_t loaded_proc = -1;   // process whose table is in TTBR0; -1: the global table
+int32_t init_proc = -1;     // process started at boot; -1 once it has exited
+struct sched_group_t proc_groups[N_L2_TABLES]; // fair share group of each process
+
 /*
 Private function declarations
 */
-void scheduler(void * arg);
-void wake_threads(void);
+void scheduler(void);
+void scheduler_tick(void * arg);
+void thread_timer_softirq(void);
+void thread_deliver_char(void);
+void thread_uart_softirq(void);
+uint32_t user_page(uint32_t proc, uint32_t vaddr, uint8_t write, uint8_t populate);
 
 void init_threads()
 {
     for (uint32_t i=0; i<MAX_THREADS; i++) {
         volatile struct tcb_t *tcb = &(tcbs[i]);
 
-        tcb->state = TERMINATED;
+        tcb->sched.state = TERMINATED;
     }
+    sched_init();
+    softirq_register(SOFTIRQ_TIMER, thread_timer_softirq);
+    softirq_register(SOFTIRQ_UART_RX, thread_uart_softirq);
 }
 
 void start_scheduling()
 {
-    setup_timer(SCHEDULER_TIMER, TIMER_INTERVAL, &scheduler);
-}
-
-void add_tcb_to_runqueue(volatile struct tcb_t * tcb)
-{
-    if (runqueue == NO_THREAD) {
-        runqueue = &(tcb->rq);
-        tcb->rq.prev = &(tcb->rq);
-        tcb->rq.next = &(tcb->rq);
-    }
-    else {
-        tcb->rq.prev = runqueue;
-        tcb->rq.next = runqueue->next;
-
-        runqueue->next->prev = &(tcb->rq);
-        runqueue->next = &(tcb->rq);
-    }
-}
-
-void remove_tcb_from_runqueue(volatile struct tcb_t * tcb)
-{
-    /* remove from runqueue */
-    if (tcb->rq.prev == &(tcb->rq)) {   // is true if its the only task on runque
-        runqueue = NO_THREAD;
-    }
-    else {
-        tcb->rq.prev->next = tcb->rq.next;
-        tcb->rq.next->prev = tcb->rq.prev;
-    }
+    setup_timer(SCHEDULER_TIMER, TIMER_INTERVAL, &scheduler_tick);
 }
 
 int32_t get_terminated_thread()
 {
     for (uint32_t i=0; i<MAX_THREADS; i++) {
-        if (tcbs[i].state == TERMINATED)
+        if (tcbs[i].sched.state == TERMINATED)
             return i;
     }
     return -1;
@@ -125,36 +132,165 @@ int32_t get_free_L2_table()
 
 struct tcb_t * get_current_thread()
 {
-    return (struct tcb_t*) runqueue;
+    return (struct tcb_t *) running;
 }
 
-void terminate_thread(struct tcb_t * tcb, struct registers_t *reg)
+/* difference of a 32 bit counter, correct across one overflow; 0 if
+it is above max, because user mode with PMU access (PROF_CTL_PMU_USER)
+may have reset or written the counter */
+uint32_t counter_delta(uint32_t now, uint32_t since, uint64_t max)
 {
-    remove_tcb_from_runqueue(tcb);
-    tcb->state = TERMINATED;
-    L2_Table_references[tcb->L2_table_i]--;
-    L2_Tables[tcb->L2_table_i][tcb->stack_i] = 0;
-    scheduler(reg);
+    uint32_t delta = now - since;
+    return (delta <= max) ? delta : 0;
 }
 
-void terminate_current_thread(struct registers_t *reg)
+/* charges the time since the last switch to the accounted thread */
+void account_update(volatile struct rusage_t *usage, volatile struct pmu_counts_t *since, time_t *running_since)
 {
-    struct tcb_t *current_thread = get_current_thread();
-    terminate_thread(current_thread, reg);
+    struct pmu_counts_t now;
+    time_t now_us = get_current_time();
+    pmu_read(&now);
+
+    uint64_t max_cycles = (uint64_t) (now_us - *running_since + 1) * PMU_MAX_CYCLES_PER_US;
+    uint64_t max_events = max_cycles * PMU_MAX_EVENTS_PER_CYCLE;
+    usage->cycles += counter_delta(now.cycles, since->cycles, max_cycles);
+    usage->instructions += counter_delta(now.events[PMU_CNT_INSTRUCTIONS], since->events[PMU_CNT_INSTRUCTIONS], max_events);
+    usage->l1i_refills += counter_delta(now.events[PMU_CNT_L1I_REFILL], since->events[PMU_CNT_L1I_REFILL], max_events);
+    usage->l1d_refills += counter_delta(now.events[PMU_CNT_L1D_REFILL], since->events[PMU_CNT_L1D_REFILL], max_events);
+    usage->l1d_accesses += counter_delta(now.events[PMU_CNT_L1D_ACCESS], since->events[PMU_CNT_L1D_ACCESS], max_events);
+    usage->cpu_time += now_us - *running_since;
+
+    *since = now;
+    *running_since = now_us;
+}
+
+struct pmu_counts_t idle_pmu_in;
+time_t idle_running_since;
+
+/* closes the accounting slice of the previous thread and opens one for tcb
+(NO_TCB means idle) */
+void account_switch(volatile struct tcb_t *tcb)
+{
+    if (tcb == accounted_tcb)
+        return;
+
+    time_t now = get_current_time();
+    if (accounted_tcb == NO_TCB) {
+        account_update(&idle_usage, &idle_pmu_in, &idle_running_since);
+    }
+    else {
+        account_update(&accounted_tcb->usage, &accounted_tcb->pmu_in, (time_t *) &accounted_tcb->running_since);
+        schedstat_slice((struct schedstat_t *) &accounted_tcb->stats, now - accounted_tcb->slice_start);
+        // preempted: it waits for the CPU again
+        if (accounted_tcb->sched.state == READY)
+            accounted_tcb->ready_since = now;
+    }
+
+    if (tcb == NO_TCB) {
+        pmu_read(&idle_pmu_in);
+        idle_running_since = now;
+        idle_usage.n_switches++;
+        trace_switch(TRACE_IDLE_TID, 0);
+    }
+    else {
+        pmu_read((struct pmu_counts_t *) &tcb->pmu_in);
+        tcb->running_since = now;
+        tcb->slice_start = now;
+        if (tcb->ready_since) {
+            schedstat_wait((struct schedstat_t *) &tcb->stats, now - tcb->ready_since);
+            tcb->ready_since = 0;
+        }
+        tcb->usage.n_switches++;
+        trace_switch(TCB_ID(tcb), tcb->L2_table_i);
+    }
+    accounted_tcb = tcb;
+}
+
+/* puts tcb on the runqueue; its wait for the CPU starts now */
+void thread_make_ready(volatile struct tcb_t *tcb)
+{
+    uint32_t cpsr = irq_save();     // preemptible syscalls create threads
+    tcb->ready_since = get_current_time();
+    sched_add_ready(&tcb->sched);
+    irq_restore(cpsr);
+}
+
+uint8_t thread_getrusage(int32_t tid, struct rusage_t *usage)
+{
+    volatile struct tcb_t *tcb;
+    if (tid == RUSAGE_SELF)
+        tcb = get_current_thread();
+    else if ((tid >= 0) && (tid < MAX_THREADS) && (tcbs[tid].sched.state != TERMINATED))
+        tcb = &tcbs[tid];
+    else
+        return 1;
+
+    /* include the slice which is still running */
+    if (tcb == accounted_tcb)
+        account_update(&tcb->usage, &tcb->pmu_in, (time_t *) &tcb->running_since);
+
+    kmemcpy(usage, (const void *) &tcb->usage, sizeof(struct rusage_t));
+    return 0;
 }
 
-void L1_table_update(uint32_t *L2_table)
+void terminate_current_thread()
 {
+    struct tcb_t *tcb = get_current_thread();
+
+    /* the resources of the process are released with the kernel lock
+    of the exit syscall held, preemptible like the syscall */
+    /* the ring may lie in pages which are freed below */
+    kring_release(TCB_ID(tcb));
+    L2_Table_references[tcb->L2_table_i]--;
+    L2_Tables[tcb->L2_table_i][tcb->stack_i] = 0;
+    mmu_tlb_flush_asid(PROC_ASID(tcb->L2_table_i));
+    if (L2_Table_references[tcb->L2_table_i] == 0) {
+        if (tcb->L2_table_i == init_proc)
+            init_proc = -1;
+        exec_release(tcb->L2_table_i);
+        mmap_release(tcb->L2_table_i);
+        file_release(tcb->L2_table_i);
+    }
+
+    irq_save();     // the thread is not continued
+    if (tcb == accounted_tcb)
+        account_update(&tcb->usage, &tcb->pmu_in, &tcb->running_since);
+    klog(KLOG_DEBUG, "thread %u exited after %u us: cpu %u us, %u cycles, %u instructions, %u switches",
+        (unsigned int) TCB_ID(tcb), (unsigned int) (get_current_time() - tcb->usage.created_at),
+        (unsigned int) tcb->usage.cpu_time, (unsigned int) tcb->usage.cycles,
+        (unsigned int) tcb->usage.instructions, (unsigned int) tcb->usage.n_switches);
+
+    sched_account(get_current_time());
+    sched_remove(&tcb->sched);
+    sched_release(&tcb->sched);
+    tcb->sched.state = TERMINATED;
+    kernel_unlock();
+    scheduler();
+}
+
+/* builds the TTBR0 table of a new process once; the windows point to
+its L2 tables, so later page changes need no update here */
+void proc_table_build(int32_t L2_table_i)
+{
+    uint32_t *table = proc_L1[L2_table_i];
+    mmu_proc_table_init(table);
+
     uint8_t L1_xn[] = {1,1}; // Stacks shall never be executed
-    L1_init((uint32_t) L2_table, LINKER2VAL(_ram_user_start), 0, 1, L1_xn); // Pointer to L2 in L1 table
+    L1_set(table, (uint32_t) L2_Tables[L2_table_i], LINKER2VAL(_ram_user_start), 0, 1, L1_xn); // Pointer to L2 in L1 table
+
+    /* program window: the L2 table of the program; no access (as in
+    the global table) without one */
+    uint32_t *prog_table = exec_table(L2_table_i);
+    uint8_t prog_xn[] = {0,1};
+    if (prog_table)
+        L1_set(table, (uint32_t) prog_table, PROG_VADDR, 0, 1, prog_xn);
+
+    /* mmap window: pages are entered on the first access */
+    for (uint32_t i=0; i<MMAP_WINDOW_MB; i++)
+        L1_set(table, (uint32_t) mmap_table(L2_table_i, i), MMAP_VADDR + i * LINKER2VAL(L1_PAGE_SIZE), 0, 1, L1_xn);
 
-    asm("DSB"); // ensures visibility of the data cleaned from the D Cache
-    asm("MCR p15,0,r5,c8,c3,0" ::: "r5"); // invalidate entire unified TLB Inner Shareable
-    asm("MCR p15,0,r5,c8,c5,0" ::: "r5"); // invalidate entire instruction TLB
-    asm("MCR p15,0,r5,c8,c6,0" ::: "r5"); // invalidate entire data TLB
-    asm("MCR p15,0,r5,c8,c7,0" ::: "r5"); // invalidate entire unified TLB
-    asm("DSB"); // ensure completion of the Invalidate TLB operation
-    asm("DSB"); // ensure taböe changes visible to instruction fetch
+    /* entries of the previous process with this ASID */
+    mmu_tlb_flush_asid(PROC_ASID(L2_table_i));
 }
 
 uint32_t* get_thread_ram_start(volatile struct tcb_t *tcb)
@@ -173,12 +309,39 @@ uint32_t virt2phys_adr(uint32_t virt_adr, volatile struct tcb_t *tcb)
     return (uint32_t)get_thread_ram_start(tcb) - LINKER2VAL(_ram_user_start) + virt_adr;
 }
 
-void copy_globals(volatile struct tcb_t *tcb)
+void thread_globals_copied(void *arg)
+{
+    volatile struct tcb_t *tcb = (volatile struct tcb_t *) arg;
+    thread_make_ready(tcb);
+    softirq_resched();
+}
+
+/* copies the initial values of the globals. A large copy runs on the
+DMA while other threads run; returns 1 if the thread is made ready by
+thread_globals_copied(). At boot there is no thread to overlap with,
+and a reschedule from the DMA interrupt must not leave start_kernel() */
+uint8_t copy_globals(volatile struct tcb_t *tcb)
 {
     uint32_t source = LINKER2VAL(_orig_globals_start);
     uint32_t dest = virt2phys_adr(LINKER2VAL(_bss_user_start), tcb);
     uint32_t size = ((int32_t) &_data_user_end - (int32_t) &_bss_user_start);
+
+    if ((size >= DMA_MIN_COPY) && (get_current_thread() != NO_TCB)) {
+        /* the DMA does not use the MMU: the window of the original
+        globals maps the image at _ram_user_start (see arch/bsp/mmu.c) */
+        uint32_t source_phys = LINKER2VAL(_ram_user_start);
+        tcb->sched.state = WAITING;
+        if (dma_memcpy((void*) dest, (void*) source_phys, size, thread_globals_copied, (void*) tcb))
+            return 1;
+    }
     kmemcpy((void*) dest, (void*) source, size);
+    return 0;
+}
+
+void map_globals(volatile struct tcb_t *tcb)
+{
+    uint32_t dest = virt2phys_adr(LINKER2VAL(_bss_user_start), tcb);
+    uint32_t size = ((int32_t) &_data_user_end - (int32_t) &_bss_user_start);
 
     // set L2 entries for globals
     uint32_t *L2_table = L2_Tables[tcb->L2_table_i];
@@ -223,27 +386,92 @@ uint32_t get_stack_base(volatile struct tcb_t *tcb)
         return stack_base;
 }
 
-void kthread_create(struct registers_t *reg, void(*func)(void*), const void *args, uint32_t args_size, uint8_t is_proc)
+/* the kernel stack of a tcb is allocated on its first use and kept
+for the threads which reuse the tcb; returns 0 if no pages are free */
+uint8_t alloc_kstack(volatile struct tcb_t *tcb)
+{
+    const uint32_t pages = STACK_SIZE_KERNEL / PAGE_SIZE;
+    if (tcb->kstack)
+        return 1;
+
+    uint32_t got;
+    uint32_t base = page_alloc_run(pages, &got);
+    if (base && (got < pages)) {
+        page_free(base, got);
+        base = 0;
+    }
+    tcb->kstack = base;
+    return base != 0;
+}
+
+/* gives the kernel stack of a tcb back if its thread could not be
+created */
+void free_kstack(volatile struct tcb_t *tcb)
+{
+    page_free(tcb->kstack, STACK_SIZE_KERNEL / PAGE_SIZE);
+    tcb->kstack = 0;
+}
+
+/* prepares the kernel stack of a new thread: the first switch to it
+returns to _trap_return, which enters func in user mode */
+void init_kstack(volatile struct tcb_t *tcb, uint32_t pc, uint32_t sp, uint32_t arg)
+{
+    struct trap_frame_t *frame = (struct trap_frame_t *) (tcb->kstack + STACK_SIZE_KERNEL) - 1;
+    kmemset(frame, 0, sizeof(struct trap_frame_t));
+    frame->usr_sp = sp;
+    frame->usr_lr = (uint32_t) &exit;
+    frame->reg.base_registers[0] = arg;    // argument of thread entry function
+    frame->reg.lr = pc;
+    frame->spsr = USR_DEFAULT_CPSR;
+
+    struct switch_frame_t *sw = (struct switch_frame_t *) frame - 1;
+    kmemset(sw, 0, sizeof(struct switch_frame_t));
+    sw->pc = (uint32_t) &_trap_return;
+    tcb->ksp = (uint32_t) sw;
+}
+
+/* creates a thread; with prog it runs the program in a new process.
+Returns the id of the thread or -1 */
+int32_t thread_new(void(*func)(void*), const void *args, uint32_t args_size, uint8_t is_proc,
+    struct program_t *prog)
 {
     /* get free tcb */
     int32_t tcb_num = get_terminated_thread();
     if (tcb_num == -1) {
         WARN("No terminated thread found. New thread will not be created.");
-        return;
+        return -1;
+    }
+    /* the args are copied below the TLS block into the stack page */
+    if (args_size > L2_PAGE_SIZE / 2) {
+        WARN("Arguments too large. New thread will not be created.");
+        return -1;
     }
     volatile struct tcb_t *tcb = &(tcbs[tcb_num]);
+    if (!alloc_kstack(tcb)) {
+        WARN("No pages for the kernel stack. New thread will not be created.");
+        return -1;
+    }
 
     /* get L2 table */
     if (is_proc) {
         tcb->L2_table_i = get_free_L2_table();
         if (tcb->L2_table_i == -1) {
             WARN("No free L2 table entry found. New Process will not be created.");
-            return;
+            free_kstack(tcb);
+            return -1;
         }
         L2_Table_references[tcb->L2_table_i] = 1;
+        if (get_current_thread() == NO_TCB)
+            init_proc = tcb->L2_table_i;    // created by start_kernel()
+        sched_group_init(&proc_groups[tcb->L2_table_i]);
         for (uint32_t i=0; i<L2_SIZE; i++)
             L2_Tables[tcb->L2_table_i][i] = 0;  // ensure all pages are set to guard pages
-        copy_globals(tcb);
+        timepage_map(L2_Tables[tcb->L2_table_i]);
+        if (prog)
+            exec_map(prog, tcb->L2_table_i);
+        else
+            map_globals(tcb);
+        proc_table_build(tcb->L2_table_i);
     }
     else {
         struct tcb_t *current_thread = get_current_thread();
@@ -252,223 +480,522 @@ void kthread_create(struct registers_t *reg, void(*func)(void*), const void *arg
     }
     
     uint32_t stack_base = get_stack_base(tcb);
+    if (stack_base == (uint32_t) -1) {
+        WARN("No free stack in the address space. New thread will not be created.");
+        if (--L2_Table_references[tcb->L2_table_i] == 0) {
+            if (tcb->L2_table_i == init_proc)
+                init_proc = -1;
+            exec_release(tcb->L2_table_i);
+            mmap_release(tcb->L2_table_i);
+            file_release(tcb->L2_table_i);
+        }
+        free_kstack(tcb);
+        return -1;
+    }
+
+    /* TLS block at the top of the stack */
+    struct tls_t *tls = (struct tls_t *) (stack_base - sizeof(struct tls_t));
+    kmemset(tls, 0, sizeof(struct tls_t));
+    tls->tid = TCB_ID(tcb);
+    tls->pid = tcb->L2_table_i;
+    tcb->tls = phys2virt_adr((uint32_t) tls, tcb);
     
-    /* put args at beginning of stack */
-    const uint32_t args_dest = stack_base - args_size;
+    /* put args below the TLS block */
+    const uint32_t args_dest = (uint32_t) tls - args_size;
     kmemcpy((void*) args_dest, args, args_size);
     // previous operations with stack were done using the physical adress which
     // is only accessible to kernel. For the thread, it must be translated to virtual space.
     uint32_t sp = ALIGN_SP(phys2virt_adr(args_dest, tcb)); 
+    init_kstack(tcb, (uint32_t) func, sp, phys2virt_adr(args_dest, tcb));
+
+    /* start accounting */
+    kmemset((void *) &tcb->usage, 0, sizeof(struct rusage_t));
+    tcb->usage.created_at = get_current_time();
+    kmemset((void *) &tcb->stats, 0, sizeof(struct schedstat_t));
+
+    /* threads share the CPU time of their process; they inherit the
+    timer slack and nice level of their creator */
+    sched_set_group(&tcb->sched, &proc_groups[tcb->L2_table_i]);
+    tcb->sched.slack = (running != NO_TCB) ? running->sched.slack : 0;
+    sched_set_nice(&tcb->sched, (running != NO_TCB) ? running->sched.fair.nice : 0);
+
+    /* schedule thread; a new process may wait for its globals */
+    if (!is_proc || prog || !copy_globals(tcb))
+        thread_make_ready(tcb);
+    return tcb_num;
+}
 
-    tcb->context.base_registers[0] = phys2virt_adr(args_dest, tcb); // argument of thread entry function
-    tcb->context.sp = sp;
-
-    /* prepare rest of registers */
-    tcb->context.pc = (uint32_t) func;
-    tcb->context.lr = (uint32_t) &exit;
-    tcb->context.cpsr = USR_DEFAULT_CPSR;
-    tcb->state = READY;
+void kthread_create(void(*func)(void*), const void *args, uint32_t args_size, uint8_t is_proc)
+{
+    thread_new(func, args, args_size, is_proc, 0);
 
-    /* schedule thread */
-    add_tcb_to_runqueue(tcb);
-    if (reg != NO_REGISTERS)
-        scheduler(reg);
+    /* the new thread may run first; at boot start_scheduling() starts it */
+    if (running != NO_TCB)
+        softirq_resched();
 }
 
-void store_context(struct registers_t * reg)
+int32_t thread_spawn(const char *path, const void *args, uint32_t args_size)
 {
-    struct tcb_t *current_thread = get_current_thread();
-    if (current_thread != NO_TCB) {
-        struct mode_registers usr_registers;
-        uint32_t spsr_irq, cpsr;
-        _get_regs_usr(&usr_registers);
-        _get_cpsr_spsr(&cpsr, &spsr_irq);
-
-        current_thread->context.sp = usr_registers.sp;
-        current_thread->context.lr = usr_registers.lr;
-        current_thread->context.pc = reg->lr;
-        for (uint32_t i=0; i<NUM_REGISTERS; i++)
-            current_thread->context.base_registers[i] = reg->base_registers[i];
-        current_thread->context.cpsr = spsr_irq;
-
-        current_thread->state = READY;
-    }
+    if (!thread_user_string(path, PROG_PATH_MAX) || !thread_user_access(args, args_size, 0))
+        return -1;
+
+    char kpath[PROG_PATH_MAX];
+    uint32_t i = 0;
+    for (; (i < PROG_PATH_MAX - 1) && path[i]; i++)
+        kpath[i] = path[i];
+    kpath[i] = 0;
+
+    int32_t tid = -1;
+    struct program_t *prog = exec_load(kpath);
+    if (prog)
+        tid = thread_new((void(*)(void*)) exec_entry(prog), args, args_size, 1, prog);
+
+    if (tid >= 0)
+        softirq_resched();
+    return tid;
 }
 
-void load_context(struct registers_t * reg, volatile struct tcb_t * tcb)
+uint32_t thread_current_proc()
 {
-    _set_usr_sp_lr(tcb->context.sp, tcb->context.lr);
-    reg->lr = tcb->context.pc;
-    for (uint32_t i=0; i<NUM_REGISTERS; i++)
-        reg->base_registers[i] = tcb->context.base_registers[i];
-    L1_table_update(L2_Tables[tcb->L2_table_i]);
+    return get_current_thread()->L2_table_i;
 }
 
-void reset_scheduler_timer()
+uint8_t thread_in_init()
 {
-    /* scheduler timing rule:
-    - if thread is ready or no thread is sleeping: use usual timer interval
-    - if no thread is ready: start when next thread will wake up
-    */
-    if ((runqueue != NO_THREAD) || (sleepqueue == NO_TCB)) {
-        setup_timer(SCHEDULER_TIMER, TIMER_INTERVAL, &scheduler);
-    }
-    else {
-        uint32_t soonest = sleepqueue->wake_at;
-        volatile struct tcb_t *tcb = sleepqueue->next_sleeping; // traverse tcb
+    return get_current_thread()->L2_table_i == init_proc;
+}
 
-        while (tcb != NO_TCB) {
-            if (tcb->wake_at < soonest)
-                soonest = tcb->wake_at;
-            tcb = tcb->next_sleeping;
+/* continues next (NO_TCB: the idle loop) on its kernel stack; returns
+when the calling context is continued again */
+void switch_context(volatile struct tcb_t *next)
+{
+    volatile struct tcb_t *prev = running;
+    uint32_t *save_sp = (prev == NO_TCB) ? &idle_ksp : (uint32_t *) &prev->ksp;
+    uint32_t next_sp = idle_ksp;
+
+    if (next != NO_TCB) {
+        asm volatile("mcr p15, 0, %0, c13, c0, 3" :: "r" (next->tls));  // TPIDRURO
+        /* threads of one process and the idle loop in between keep the
+        table; other processes only change TTBR0 and the ASID */
+        if (next->L2_table_i != loaded_proc) {
+            mmu_switch(proc_L1[next->L2_table_i], PROC_ASID(next->L2_table_i));
+            loaded_proc = next->L2_table_i;
         }
-
-        uint32_t sleep_time = soonest - get_current_time();
-        setup_timer(SCHEDULER_TIMER, sleep_time, &scheduler);
+        next_sp = next->ksp;
     }
-        
+    running = next;
+    _switch_to(save_sp, next_sp);
 }
 
-void scheduler(void * arg)
+void reset_scheduler_timer()
 {
-    struct registers_t * reg = (struct registers_t *) arg;
-    wake_threads();
-    uint8_t only_one_ready_thread_exists = 0;
-    if (runqueue != NO_THREAD)
-        only_one_ready_thread_exists = (runqueue->next == runqueue);
-    struct tcb_t *current_thread;
-    current_thread = get_current_thread();
+    time_t now = get_current_time();
+    time_t interval = sched_timer_interval(now, TIMER_INTERVAL);
+    interval = kring_next_timeout(now, interval);
+    setup_timer(SCHEDULER_TIMER, (uint32_t) interval, &scheduler_tick);
+}
 
-    if (runqueue == NO_THREAD) {
-        /* "Idle Thread" */
+/* called for every sleeper sched_wake() makes ready */
+void account_wakeup(volatile struct sched_node_t *node, time_t now)
+{
+    volatile struct tcb_t *tcb = TCB_OF(node);
+    trace_event(TRACE_WAKEUP, TCB_ID(tcb), (uint32_t) (now - node->wake_at), TRACE_WAKE_TIMER);
+    schedstat_wakeup((struct schedstat_t *) &tcb->stats, now - node->wake_at);
+    tcb->ready_since = now;
+}
 
-        reg->lr = (uint32_t) &_infinite_loop;
-    }
-    else if(!only_one_ready_thread_exists || (current_thread->state == READY)) {
-        /* store context */
-        if (current_thread->state == RUNNING) {
-            store_context(reg);
-        }
+/* counts a deadline miss in the rusage of the thread and reports it */
+void report_deadline_miss(volatile struct tcb_t *tcb, time_t late_us)
+{
+    tcb->usage.deadline_misses++;
+    if (late_us)
+        klog(KLOG_WARN, "thread %u missed its deadline by %u us",
+            (unsigned int) TCB_ID(tcb), (unsigned int) late_us);
+    else
+        klog(KLOG_WARN, "thread %u used up its runtime of %u us, job continues in the next period",
+            (unsigned int) TCB_ID(tcb), (unsigned int) tcb->sched.dl.runtime);
+}
 
-        /* go to next task */
-        runqueue = runqueue->next;
+/* picks the next thread and switches to it. A thread which called it
+after leaving the runqueue returns when it runs again */
+void scheduler()
+{
+    uint32_t cpsr = irq_save();
+    time_t now = get_current_time();
+    timepage_update();
 
-        /* load new context */
-        current_thread = get_current_thread();
-        load_context(reg, current_thread);
-        current_thread->state = RUNNING;
-    }
+    sched_account(now);
+    struct tcb_t *throttled = TCB_OF(sched_throttle(now));
+    if (throttled != NO_TCB)
+        report_deadline_miss(throttled, 0);
+    sched_wake(now, account_wakeup);
 
+    struct tcb_t *next_thread = TCB_OF(sched_pick_next());
     reset_scheduler_timer();
+
+    account_switch(next_thread);
+    if (next_thread == NO_TCB)
+        klog_drain();   // "Idle Thread": nothing else to do, feed the console
+    if (next_thread != running)
+        switch_context(next_thread);
+    irq_restore(cpsr);
+}
+
+uint32_t thread_count_running()
+{
+    uint32_t n = 0;
+    for (uint32_t i=0; i<MAX_THREADS; i++) {
+        if ((tcbs[i].sched.state == READY) || (tcbs[i].sched.state == RUNNING))
+            n++;
+    }
+    return n;
 }
 
-uint8_t thread_wait_for_char(struct registers_t * reg)
+uint8_t thread_schedstat(int32_t tid, struct schedstat_t *stats)
 {
-    if (char_thread == NO_TCB) {
-        store_context(reg);
-        char_thread = get_current_thread();
-        remove_tcb_from_runqueue(char_thread);
-        char_thread->state = WAITING;
-        scheduler(reg);
-        
+    if ((tid == SCHEDSTAT_ALL) || (tid == SCHEDSTAT_RESET)) {
+        uint32_t cpsr = irq_save();     // timer interrupts add to the histograms
+        schedstat_export(stats, 0);
+        if (tid == SCHEDSTAT_RESET)
+            schedstat_reset();
+        irq_restore(cpsr);
         return 0;
     }
-    else {
+
+    volatile struct tcb_t *tcb;
+    if (tid == SCHEDSTAT_SELF)
+        tcb = get_current_thread();
+    else if ((tid >= 0) && (tid < MAX_THREADS) && (tcbs[tid].sched.state != TERMINATED))
+        tcb = &tcbs[tid];
+    else
         return 1;
-    }
+
+    schedstat_export(stats, (const struct schedstat_t *) &tcb->stats);
+    return 0;
 }
 
-void thread_process_char_received(struct registers_t * reg)
+/* top half of the scheduler timer */
+void scheduler_tick(void * arg)
 {
-    if (char_thread != NO_TCB) {
-        store_context(reg);        
+    (void) arg;
+    raise_softirq(SOFTIRQ_TIMER);
+}
 
-        // write character to desired memory location
-        char *ret_addr_virt = (char*) char_thread->context.base_registers[0];
-        char *ret_addr_phy = (char*) virt2phys_adr((uint32_t) ret_addr_virt, char_thread);
-        *ret_addr_phy = uart_get_char();
-        // L2 table of current thread does not need to be loaded because char_thread is
-        // instantly scheduled (see below)
+/* bottom half of the scheduler timer: wakes the sleepers, the switch
+itself is done by scheduler() in irq_exit() */
+void thread_timer_softirq()
+{
+    time_t now = get_current_time();
+    timepage_update();
+    sched_wake(now, account_wakeup);
+    kring_timer(now);
+    schedstat_tick(now, thread_count_running());
+    softirq_resched();
+}
 
-        // return 0 which means successful read
-        char_thread->context.base_registers[0] = 0;
+void thread_yield()
+{
+    uint32_t cpsr = irq_save();
+    sched_account(get_current_time());
+    sched_yield();
+    irq_restore(cpsr);
+    scheduler();
+}
 
-        // reschedule thread
-        char_thread->state = RUNNING;
-        add_tcb_to_runqueue(char_thread);
-        load_context(reg, char_thread);
-        reset_scheduler_timer();
+/* takes the current thread off the runqueue; it continues in
+scheduler() once another context makes it ready */
+void block_current(volatile struct tcb_t *tcb)
+{
+    sched_account(get_current_time());
+    sched_remove(&tcb->sched);
+    tcb->sched.state = WAITING;
+    scheduler();
+}
+
+uint8_t thread_wait_for_char(char *c)
+{
+    if (char_thread != NO_TCB)
+        return 1;
+
+    char_thread = get_current_thread();
+    char_dest = (uint32_t) c;
+    block_current(char_thread);
+    return 0;
+}
 
-        char_thread = NO_TCB;
+void thread_deliver_char()
+{
+    if ((char_thread == NO_TCB) || !uart_char_available())
+        return;
+
+    /* the destination was checked by the syscall, but the page may have
+    been unmapped since; then the char stays in the buffer */
+    char *ret_addr_phy = (char*) user_page(char_thread->L2_table_i, char_dest, 1, 0);
+    if (ret_addr_phy) {
+        /* the top half only moves the head of the ring, no lock needed */
+        *ret_addr_phy = uart_get_char();
     }
+
+    // the reader runs next: it was waiting for I/O
+    trace_event(TRACE_WAKEUP, TCB_ID(char_thread), 0, TRACE_WAKE_UART);
+    thread_make_ready(char_thread);
+    char_thread = NO_TCB;
+    softirq_resched();
+}
+
+/* bottom half of the UART receiver: the blocking reader first, then
+the reads of the rings */
+void thread_uart_softirq()
+{
+    thread_deliver_char();
+    kring_uart_rx();
 }
 
-void thread_make_sleep_current(struct registers_t * reg, uint32_t millis)
+void thread_make_sleep_current(uint32_t millis)
 {
     if (millis == 0) {
         return;
     }
     else {
-        store_context(reg);
-
-        struct tcb_t *current_thread = get_current_thread();
-        current_thread->state = WAITING;
-        current_thread->wake_at = get_current_time() + millis*1000;  // timer works on microseconds
-        remove_tcb_from_runqueue(current_thread);
-        // add to sleepqueue
-        current_thread->next_sleeping = sleepqueue;
-        sleepqueue = current_thread;
-
-        scheduler(reg);
+        thread_sleep_until(get_current_time() + millis*1000);  // timer works on microseconds
     }
 }
 
-void wake_threads()
+void thread_sleep_until(time_t wake_at)
 {
-    volatile struct tcb_t *tcb = sleepqueue; // traverse tcb
-    volatile struct tcb_t *prior_tcb = NO_TCB; // tcb that is prior to tcb in the sleepqueue
-    time_t current_time = get_current_time();
+    struct tcb_t *current_thread = get_current_thread();
+    time_t now = get_current_time();
+    if (wake_at <= now)
+        return;
 
-    while (tcb != NO_TCB) {
-        if (tcb->wake_at <= current_time) {
-            // remove from sleepqueue
-            if (prior_tcb == NO_TCB) // true if this is first tcb in queue
-                sleepqueue = tcb->next_sleeping;
-            else
-                prior_tcb->next_sleeping = tcb->next_sleeping;
+    sched_account(now);
+    sched_sleep(&current_thread->sched, wake_at);
+    scheduler();
+}
 
-            tcb->state = READY;
-            tcb->wake_at = 0;
-            add_tcb_to_runqueue(tcb);
+uint8_t thread_set_timer_slack(uint32_t slack_us)
+{
+    if (slack_us > SCHED_SLACK_MAX)
+        return 1;
+    get_current_thread()->sched.slack = slack_us;
+    return 0;
+}
+
+uint8_t thread_set_nice(int32_t nice)
+{
+    struct tcb_t *current_thread = get_current_thread();
 
-            tcb = tcb->next_sleeping;
+    sched_account(get_current_time());  // the time so far at the old weight
+    return sched_set_nice(&current_thread->sched, nice);
+}
+
+uint8_t thread_setdeadline(uint32_t runtime_us, uint32_t period_us, uint32_t deadline_us)
+{
+    struct tcb_t *current_thread = get_current_thread();
+    time_t now = get_current_time();
+
+    sched_account(now);
+    uint8_t ret = sched_setdeadline(&current_thread->sched, runtime_us, period_us, deadline_us, now);
+    if (ret)
+        klog(KLOG_WARN, "thread %u: deadline parameters %u/%u/%u us rejected",
+            (unsigned int) TCB_ID(current_thread), (unsigned int) runtime_us,
+            (unsigned int) period_us, (unsigned int) deadline_us);
+    else
+        scheduler(); // the thread may have to give way to an earlier deadline
+    return ret;
+}
+
+uint8_t thread_next_period()
+{
+    struct tcb_t *current_thread = get_current_thread();
+    if (!current_thread->sched.dl.active)
+        return 1;
+
+    time_t now = get_current_time();
+    sched_account(now);
+
+    time_t late_us = sched_next_period(&current_thread->sched, now);
+    if (late_us)
+        report_deadline_miss(current_thread, late_us);
+
+    scheduler();
+    return 0;
+}
+
+/* slot of the L2 entry of the page at vaddr in address space proc; 0
+if vaddr lies outside of the windows of the process */
+uint32_t * user_pte(uint32_t proc, uint32_t vaddr)
+{
+    const uint32_t mb = LINKER2VAL(L1_PAGE_SIZE);
+    const uint32_t flat = LINKER2VAL(_ram_user_start);
+    uint32_t *prog_table = exec_table(proc);
+
+    if (vaddr - flat < mb)
+        return &L2_Tables[proc][(vaddr - flat) >> PAGE_SHIFT];
+    if (prog_table && (vaddr - PROG_VADDR < mb))
+        return &prog_table[(vaddr - PROG_VADDR) >> PAGE_SHIFT];
+    if (vaddr - MMAP_VADDR < MMAP_WINDOW_MB * mb)
+        return &mmap_table(proc, (vaddr - MMAP_VADDR) / mb)[((vaddr - MMAP_VADDR) % mb) >> PAGE_SHIFT];
+    return 0;
+}
+
+/* physical address of vaddr in address space proc if user mode may
+access it (with write: write to it), 0 otherwise. With populate, a
+page which is entered on demand is populated first; the caller holds
+the kernel lock */
+uint32_t user_page(uint32_t proc, uint32_t vaddr, uint8_t write, uint8_t populate)
+{
+    /* the user text of the kernel image is identity mapped */
+    if (!write && (vaddr >= LINKER2VAL(_text_user_start)) && (vaddr < LINKER2VAL(_text_user_end)))
+        return vaddr;
+
+    uint32_t *pte = user_pte(proc, vaddr);
+    if (!pte)
+        return 0;
+    if ((*pte == 0) && populate && !exec_fault(proc, vaddr))
+        mmap_fault(proc, vaddr);
+    if (!L2_user_access(*pte, write))
+        return 0;
+    return L2_phys(*pte) + (vaddr & (PAGE_SIZE - 1));
+}
+
+/* checks [vaddr, vaddr+len) page by page; returns the physical address
+of vaddr or 0 if user mode may not access the whole buffer or, with
+contiguous, if it is not contiguous in physical memory */
+uint32_t user_range(uint32_t proc, uint32_t vaddr, uint32_t len, uint8_t write, uint8_t contiguous)
+{
+    uint32_t last = vaddr + (len ? len - 1 : 0);
+    if (last < vaddr)
+        return 0;
+
+    kernel_lock();
+    uint32_t phys = user_page(proc, vaddr, write, 1);
+    uint32_t page = vaddr & ~(PAGE_SIZE - 1);
+    while (phys && (page != (last & ~(PAGE_SIZE - 1)))) {
+        page += PAGE_SIZE;
+        uint32_t next = user_page(proc, page, write, 1);
+        if ((next == 0) || (contiguous && (next != phys + (page - vaddr))))
+            phys = 0;
+    }
+    kernel_unlock();
+    return phys;
+}
+
+uint8_t thread_user_access(const void *buf, uint32_t len, uint8_t write)
+{
+    if (len == 0)
+        return 1;   // nothing is accessed, e.g. thread_create(f, 0, 0, 0)
+    return user_range(thread_current_proc(), (uint32_t) buf, len, write, 0) != 0;
+}
+
+uint8_t thread_user_string(const char *str, uint32_t max)
+{
+    uint32_t proc = thread_current_proc();
+    uint8_t ok = 0;
+
+    kernel_lock();
+    for (uint32_t i=0; i<max; i++) {
+        uint32_t vaddr = (uint32_t) str + i;
+        if (((i == 0) || ((vaddr & (PAGE_SIZE - 1)) == 0)) && !user_page(proc, vaddr, 0, 1))
+            break;
+        if ((str[i] == 0) || (i == max - 1)) {
+            ok = 1;
+            break;
         }
-        else {
-            prior_tcb = tcb;
-            tcb = tcb->next_sleeping;
+    }
+    kernel_unlock();
+    return ok;
+}
+
+uint32_t thread_user_to_phys(uint16_t tid, uint32_t vaddr, uint32_t len, uint8_t write)
+{
+    if (tid >= MAX_THREADS)
+        return 0;
+    return user_range(tcbs[tid].L2_table_i, vaddr, len, write, 1);
+}
+
+uint8_t thread_ring_setup(uint32_t ring_vaddr)
+{
+    struct tcb_t *current_thread = get_current_thread();
+    uint16_t tid = TCB_ID(current_thread);
+    uint32_t phys = thread_user_to_phys(tid, ring_vaddr, sizeof(struct ring_t), 1);
+
+    if ((phys == 0) || (ring_vaddr & 0x3))
+        return 1;
+    return kring_setup(tid, (struct ring_t *) phys);
+}
+
+uint32_t thread_ring_enter(uint32_t min_complete)
+{
+    struct tcb_t *current_thread = get_current_thread();
+    uint16_t tid = TCB_ID(current_thread);
+
+    uint32_t consumed = kring_submit(tid, get_current_time());
+
+    /* block until enough completions arrived, see thread_ring_wakeup() */
+    if (!kring_wait(tid, min_complete))
+        block_current(current_thread);
+    return consumed;
+}
+
+void thread_ring_wakeup(uint16_t tid)
+{
+    volatile struct tcb_t *tcb = &tcbs[tid];
+    if (tcb->sched.state != WAITING)
+        return;
+
+    trace_event(TRACE_WAKEUP, tid, 0, TRACE_WAKE_RING);
+    thread_make_ready(tcb);
+    softirq_resched();
+}
+
+uint8_t thread_page_fault(uint32_t addr)
+{
+    struct tcb_t *current_thread = get_current_thread();
+    if (current_thread == NO_TCB)
+        return 0;
+    return exec_fault(current_thread->L2_table_i, addr)
+        || mmap_fault(current_thread->L2_table_i, addr);
+}
+
+void kernel_lock()
+{
+    uint32_t cpsr = irq_save();
+    volatile struct tcb_t *self = running;
+
+    if (self == NO_TCB) {
+        // boot and idle loop run no syscalls
+    }
+    else if (klock_owner == self) {
+        klock_depth++;
+    }
+    else {
+        /* woken by kernel_unlock(); a thread which took the lock in
+        the meantime wins, the waiter blocks again */
+        while (klock_owner != NO_TCB) {
+            self->klock_wait = 1;
+            block_current(self);
         }
+        klock_owner = self;
+        klock_depth = 1;
+    }
+    irq_restore(cpsr);
+}
 
-        if (tcb == sleepqueue) {
-            /* Something went wrong, so the sleepqueue contains a loop.
-            This appeared multiple times during testing. In this block,
-            the queue is repaired and prepared to be traversed again */
-            sleepqueue = NO_TCB;
-            tcb = NO_TCB;
-
-            for (uint32_t i=0; i<MAX_THREADS; i++) {
-                volatile struct tcb_t *repair_tcb = &(tcbs[i]);
-                if ((repair_tcb->state == WAITING) && (repair_tcb->wake_at > 0)) {
-                    if (sleepqueue == NO_TCB) {
-                        sleepqueue = repair_tcb;
-                        tcb = repair_tcb;
-                    }
-                    else {
-                        tcb->next_sleeping = repair_tcb;
-                        repair_tcb->next_sleeping = NO_TCB;
-                    }
-                }
-            }
-            tcb = sleepqueue;
+void kernel_unlock()
+{
+    uint32_t cpsr = irq_save();
+    if ((running != NO_TCB) && (klock_owner == running) && (--klock_depth == 0)) {
+        klock_owner = NO_TCB;
+        for (uint32_t i=0; i<MAX_THREADS; i++) {
+            volatile struct tcb_t *tcb = &tcbs[i];
+            if (!tcb->klock_wait)
+                continue;
+            tcb->klock_wait = 0;
+            if (tcb->sched.state == WAITING)    // not woken otherwise yet
+                thread_make_ready(tcb);
+            softirq_resched();
         }
     }
+    irq_restore(cpsr);
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include <stdint.h>
+#include <kernel/timepage.h>
+#include <arch/bsp/mmu.h>
+#include <lib/time.h>
+#include <lib/math.h>
+
+#define CNTKCTL_PL0VCTEN    1
+#define REBASE_CNT          0x100000000ULL  // counts after which the base moves on
+
+/* the time page must not share its page with other kernel data,
+because the whole page is readable by every process */
+__attribute__((aligned(L2_PAGE_SIZE))) uint32_t time_page_mem[L2_PAGE_SIZE/4];
+volatile struct time_page_t *time_page = (volatile struct time_page_t *) time_page_mem;
+
+void timepage_init()
+{
+    uint32_t freq, cntkctl;
+    asm volatile("mrc p15, 0, %0, c14, c0, 0" : "=r" (freq));
+
+    time_page->seq = 0;
+    time_page->cnt_freq = freq;
+    time_page->cnt_valid = (freq != 0);
+    if (time_page->cnt_valid) {
+        /* allow user mode to read CNTVCT */
+        asm volatile("mrc p15, 0, %0, c14, c1, 0" : "=r" (cntkctl));
+        cntkctl |= (1 << CNTKCTL_PL0VCTEN);
+        asm volatile("mcr p15, 0, %0, c14, c1, 0" :: "r" (cntkctl));
+
+        time_page->mult = (uint32_t) divu64((uint64_t) 1000000 << TIME_SHIFT, freq);
+    }
+
+    /* the only point where both timers are read together */
+    time_page->base_us = get_current_time();
+    time_page->base_cnt = time_page->cnt_valid ? read_cntvct() : 0;
+}
+
+void timepage_update()
+{
+    time_t now;
+    uint64_t cnt = 0;
+
+    if (time_page->cnt_valid) {
+        /* the time page follows CNTVCT alone, so readings never go
+        back. The base only moves on before delta * mult could
+        overflow, calculated like the readers do; each move loses
+        less than 1 us */
+        cnt = read_cntvct();
+        uint64_t delta = cnt - time_page->base_cnt;
+        if (delta < REBASE_CNT)
+            return;
+        now = time_page->base_us + ((delta * time_page->mult) >> TIME_SHIFT);
+    }
+    else {
+        now = get_current_time();
+    }
+
+    time_page->seq++;
+    asm volatile("dmb" ::: "memory");
+
+    time_page->base_us = now;
+    time_page->base_cnt = cnt;
+
+    asm volatile("dmb" ::: "memory");
+    time_page->seq++;
+}
+
+void timepage_map(uint32_t *L2_table)
+{
+    uint8_t L2_xn = 1; // time page shall not be executed
+    L2_table[TIME_PAGE_L2_INDEX] = L2_init((uint32_t) time_page_mem, RIGHT_BOTH_READ_ONLY, 0, L2_xn);
+}
@@ -0,0 +1,303 @@
+#include <stdint.h>
+#include <kernel/tmpfs.h>
+#include <kernel/file.h>
+#include <kernel/page.h>
+#include <kernel/initramfs.h>
+#include <kernel/debug.h>
+#include <kernel/klog.h>
+#include <lib/primfunc.h>
+
+struct extent_t {
+    uint32_t phys;      // first page
+    uint32_t pages;
+};
+
+struct inode_t {
+    char name[TMPFS_NAME_MAX];  // empty if unlinked
+    uint8_t used;
+    uint32_t refs;              // the name counts as one reference
+    uint32_t pins;              // mappings of the file
+    uint32_t size;
+    uint32_t version;
+    uint32_t n_extents;
+    struct extent_t extents[TMPFS_MAX_EXTENTS];
+};
+
+struct inode_t inodes[TMPFS_MAX_FILES];
+
+const char * strip_slashes(const char *name)
+{
+    while (*name == '/')
+        name++;
+    return name;
+}
+
+uint8_t name_equal(const char *a, const char *b)
+{
+    for (uint32_t i=0; i<TMPFS_NAME_MAX; i++) {
+        if (a[i] != b[i])
+            return 0;
+        if (a[i] == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* bytes the extents of inode can hold */
+uint32_t capacity(struct inode_t *inode)
+{
+    uint32_t pages = 0;
+    for (uint32_t i=0; i<inode->n_extents; i++)
+        pages += inode->extents[i].pages;
+    return pages << PAGE_SHIFT;
+}
+
+void free_extents(struct inode_t *inode)
+{
+    for (uint32_t i=0; i<inode->n_extents; i++)
+        page_free(inode->extents[i].phys, inode->extents[i].pages);
+    inode->n_extents = 0;
+    inode->size = 0;
+}
+
+/* adds extents until the file can hold size bytes; returns the
+capacity, which is smaller than size if memory runs out */
+uint32_t grow(struct inode_t *inode, uint32_t size)
+{
+    uint32_t cap = capacity(inode);
+
+    while (cap < size) {
+        uint32_t want = (size - cap + PAGE_SIZE - 1) >> PAGE_SHIFT;
+        uint32_t got;
+        uint32_t phys = page_alloc_run(want, &got);
+        if (phys == 0)
+            break;
+
+        struct extent_t *last = inode->n_extents ? &inode->extents[inode->n_extents - 1] : 0;
+        if (last && (last->phys + (last->pages << PAGE_SHIFT) == phys)) {
+            last->pages += got;
+        }
+        else if (inode->n_extents < TMPFS_MAX_EXTENTS) {
+            inode->extents[inode->n_extents].phys = phys;
+            inode->extents[inode->n_extents].pages = got;
+            inode->n_extents++;
+        }
+        else {
+            page_free(phys, got);
+            break;
+        }
+        cap += got << PAGE_SHIFT;
+    }
+    return cap;
+}
+
+/* copies between buf and the range [offset, offset+len) of the file,
+one contiguous piece per extent. The range must lie inside the
+extents */
+void walk(struct inode_t *inode, uint32_t offset, uint32_t len, uint8_t *buf, uint8_t to_file)
+{
+    uint32_t start = 0;   // file offset of the current extent
+
+    for (uint32_t i=0; (i<inode->n_extents) && len; i++) {
+        uint32_t bytes = inode->extents[i].pages << PAGE_SHIFT;
+        if (offset < start + bytes) {
+            uint32_t in_ext = offset - start;
+            uint32_t n = bytes - in_ext;
+            if (n > len)
+                n = len;
+            uint8_t *data = (uint8_t *) (inode->extents[i].phys + in_ext);
+            if (to_file)
+                kmemcpy(data, buf, n);
+            else
+                kmemcpy(buf, data, n);
+            buf += n;
+            offset += n;
+            len -= n;
+        }
+        start += bytes;
+    }
+}
+
+void zero_range(struct inode_t *inode, uint32_t offset, uint32_t len)
+{
+    uint32_t start = 0;
+
+    for (uint32_t i=0; (i<inode->n_extents) && len; i++) {
+        uint32_t bytes = inode->extents[i].pages << PAGE_SHIFT;
+        if (offset < start + bytes) {
+            uint32_t in_ext = offset - start;
+            uint32_t n = bytes - in_ext;
+            if (n > len)
+                n = len;
+            kmemset((void *) (inode->extents[i].phys + in_ext), 0, n);
+            offset += n;
+            len -= n;
+        }
+        start += bytes;
+    }
+}
+
+void unpack_file(const char *path, const uint8_t *data, uint32_t size)
+{
+    int32_t ino = tmpfs_create(path);
+    if (ino < 0) {
+        klog(KLOG_WARN, "tmpfs: can not create %s", path);
+        return;
+    }
+    if (tmpfs_write(ino, 0, data, size) != size)
+        klog(KLOG_WARN, "tmpfs: %s truncated, out of memory", path);
+}
+
+void tmpfs_init()
+{
+    for (uint32_t i=0; i<TMPFS_MAX_FILES; i++)
+        inodes[i].used = 0;
+
+    initramfs_foreach(unpack_file);
+    klog(KLOG_INFO, "tmpfs: %u pages free after unpacking the initramfs",
+        (unsigned int) page_free_count());
+}
+
+int32_t tmpfs_lookup(const char *name)
+{
+    name = strip_slashes(name);
+    for (uint32_t i=0; i<TMPFS_MAX_FILES; i++) {
+        if (inodes[i].used && inodes[i].name[0] && name_equal(inodes[i].name, name))
+            return i;
+    }
+    return -1;
+}
+
+int32_t tmpfs_create(const char *name)
+{
+    name = strip_slashes(name);
+    uint32_t len = 0;
+    while ((len < TMPFS_NAME_MAX) && name[len])
+        len++;
+    if ((len == 0) || (len == TMPFS_NAME_MAX))
+        return FILE_ERR_INVAL;
+
+    for (uint32_t i=0; i<TMPFS_MAX_FILES; i++) {
+        struct inode_t *inode = &inodes[i];
+        if (inode->used)
+            continue;
+        kmemcpy(inode->name, name, len + 1);
+        inode->used = 1;
+        inode->refs = 1;
+        inode->pins = 0;
+        inode->size = 0;
+        inode->version = 0;
+        inode->n_extents = 0;
+        return i;
+    }
+    return FILE_ERR_NOSPC;
+}
+
+int32_t tmpfs_unlink(const char *name)
+{
+    int32_t ino = tmpfs_lookup(name);
+    if (ino < 0)
+        return FILE_ERR_NOENT;
+
+    inodes[ino].name[0] = 0;
+    tmpfs_put(ino);
+    return 0;
+}
+
+void tmpfs_get(uint32_t ino)
+{
+    inodes[ino].refs++;
+}
+
+void tmpfs_put(uint32_t ino)
+{
+    struct inode_t *inode = &inodes[ino];
+
+    if (inode->refs == 0) {
+        WARN("tmpfs_put: inode is not referenced");
+        return;
+    }
+    if (--inode->refs == 0) {
+        free_extents(inode);
+        inode->used = 0;
+    }
+}
+
+uint32_t tmpfs_size(uint32_t ino)
+{
+    return inodes[ino].size;
+}
+
+uint32_t tmpfs_version(uint32_t ino)
+{
+    return inodes[ino].version;
+}
+
+uint32_t tmpfs_read(uint32_t ino, uint32_t offset, void *buf, uint32_t len)
+{
+    struct inode_t *inode = &inodes[ino];
+
+    if (offset >= inode->size)
+        return 0;
+    if (len > inode->size - offset)
+        len = inode->size - offset;
+
+    walk(inode, offset, len, buf, 0);
+    return len;
+}
+
+uint32_t tmpfs_write(uint32_t ino, uint32_t offset, const void *buf, uint32_t len)
+{
+    struct inode_t *inode = &inodes[ino];
+
+    if (offset + len < offset)
+        len = -offset;  // end of the file at 4 GiB
+    uint32_t cap = grow(inode, offset + len);
+    if (offset >= cap)
+        return 0;
+    if (len > cap - offset)
+        len = cap - offset;
+
+    /* pages from the allocator are not cleared */
+    if (offset > inode->size)
+        zero_range(inode, inode->size, offset - inode->size);
+
+    walk(inode, offset, len, (uint8_t *) buf, 1);
+    if (offset + len > inode->size)
+        inode->size = offset + len;
+    inode->version++;
+    return len;
+}
+
+void tmpfs_truncate(uint32_t ino)
+{
+    if (inodes[ino].pins)
+        inodes[ino].size = 0;
+    else
+        free_extents(&inodes[ino]);
+    inodes[ino].version++;
+}
+
+void tmpfs_pin(uint32_t ino)
+{
+    inodes[ino].pins++;
+}
+
+void tmpfs_unpin(uint32_t ino)
+{
+    inodes[ino].pins--;
+}
+
+uint32_t tmpfs_page(uint32_t ino, uint32_t index)
+{
+    struct inode_t *inode = &inodes[ino];
+
+    if (index >= ((inode->size + PAGE_SIZE - 1) >> PAGE_SHIFT))
+        return 0;
+    for (uint32_t i=0; i<inode->n_extents; i++) {
+        if (index < inode->extents[i].pages)
+            return inode->extents[i].phys + (index << PAGE_SHIFT);
+        index -= inode->extents[i].pages;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include <stdint.h>
+#include <kernel/trace.h>
+#include <kernel/kprintf.h>
+#include <kernel/klog.h>
+#include <arch/cpu/atomic.h>
+#include <lib/time.h>
+
+#define TRACE_FLUSH_LINES   32  // lines printed before the log ring is flushed
+
+struct trace_entry_t trace_buf[TRACE_BUF_SIZE];
+volatile uint32_t trace_pos = 0;
+uint8_t trace_enabled = 1;
+uint16_t trace_running_tid = TRACE_IDLE_TID;
+
+void trace_event(uint16_t type, uint16_t tid, uint32_t arg0, uint32_t arg1)
+{
+    if (!trace_enabled)
+        return;
+
+    uint32_t pos = atomic_add_return(&trace_pos, 1) - 1;
+    struct trace_entry_t *entry = &trace_buf[pos & (TRACE_BUF_SIZE - 1)];
+
+    entry->ts = (uint32_t) get_current_time();
+    entry->type = type;
+    entry->tid = tid;
+    entry->arg0 = arg0;
+    entry->arg1 = arg1;
+}
+
+void trace_switch(uint16_t tid, uint32_t proc)
+{
+    if (tid == trace_running_tid)
+        return;
+
+    trace_event(TRACE_SWITCH_OUT, trace_running_tid, tid, 0);
+    trace_event(TRACE_SWITCH_IN, tid, trace_running_tid, proc);
+    trace_running_tid = tid;
+}
+
+uint16_t trace_current_tid()
+{
+    return trace_running_tid;
+}
+
+void trace_enable(uint8_t enable)
+{
+    trace_enabled = enable;
+}
+
+void trace_dump()
+{
+    /* the dump is a debugging action, so it is fine to wait for the UART */
+    uint8_t was_enabled = trace_enabled;
+    trace_enabled = 0;
+
+    uint32_t end = trace_pos;
+    uint32_t n = (end < TRACE_BUF_SIZE) ? end : TRACE_BUF_SIZE;
+
+    klog_flush_sync();
+    kprintf("TRACE_BEGIN %u\n", (unsigned int) n);
+    for (uint32_t i=end-n; i!=end; i++) {
+        struct trace_entry_t *entry = &trace_buf[i & (TRACE_BUF_SIZE - 1)];
+        kprintf("T %08x %u %u %08x %08x\n", (unsigned int) entry->ts, (unsigned int) entry->type,
+            (unsigned int) entry->tid, (unsigned int) entry->arg0, (unsigned int) entry->arg1);
+
+        if ((i % TRACE_FLUSH_LINES) == 0)
+            klog_flush_sync();
+    }
+    kprintf("TRACE_END\n");
+    klog_flush_sync();
+
+    trace_enabled = was_enabled;
+}
@@ -0,0 +1,621 @@
+#include <stdint.h>
+#include <user/sys.h>
+#include <user/clock.h>
+#include <user/print.h>
+#include <user/tls.h>
+#include <user/sync.h>
+#include <user/uring.h>
+#include <arch/cpu/pmu.h>
+#include <kernel/schedstat.h>
+#include <kernel/syscalls.h>
+
+/*
+Microbenchmarks of the kernel. Linked instead of main.c into
+build/kernel_bench.elf and started with "make bench".
+
+Every result is printed as one line
+    BENCH <name> unit=<unit> n=<samples> min=<> avg=<> max=<>
+and the run ends with BENCH_DONE. Cycles are read from the PMU cycle
+counter (enabled for user mode with PROF_CTL_PMU_USER), wall clock
+times from the time page.
+
+Sample counts are powers of two, so averages need a shift only
+(user code has no 64 bit division).
+*/
+
+#define LOG2_N_SYSCALL      8
+#define LOG2_N_SWITCH       7
+#define LOG2_N_CREATE       4
+#define LOG2_N_SLEEP        4
+#define LOG2_N_WRITE        3
+#define LOG2_N_READ         6
+#define LOG2_N_BURST        8       // chars of the bulk input benchmark, fit into the input ring
+#define LOG2_N_LOCK         10
+#define LOG2_N_FILE         4       // chunks of the file benchmark
+#define LOG2_N_BLOCK        6       // requests of the block benchmarks
+#define LOG2_LOCK_THREADS   2
+#define LOG2_N_SLACK_ROUNDS 5       // wake-ups per thread of the timer slack benchmark
+#define N_SLACK_THREADS     4
+#define SLACK_PERIOD_US     4000
+#define SLACK_STAGGER_US    200     // offset between the wake-ups of the threads
+
+#define WRITE_BLOCK         64      // chars per sample of the write benchmark
+#define LOG2_WRITE_BLOCK    6
+#define FILE_CHUNK          4096    // bytes per read/write of the file benchmark
+#define LOG2_FILE_CHUNK_KIB 2
+#define BLOCK_REQ           (FILE_CHUNK / BLOCK_SIZE)   // blocks per request
+#define BLOCK_BENCH_LBA     0x800   // region of the SD card used by the benchmarks
+#define BLOCK_WARM_REQS     4       // requests of the warm region; fits into the cache
+#define FREQ_WINDOW_US      100000
+#define SWITCH_PARTNER_EXTRA 8      // keeps the partner alive until the last sample
+
+struct bench_stats_t {
+    uint32_t n;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+};
+
+volatile uint32_t bench_done_threads;
+
+enum lock_kind_t { LOCK_SPIN, LOCK_MUTEX, LOCK_RW_WRITE, LOCK_RW_READ, LOCK_ATOMIC };
+
+struct spinlock_t bench_spin = SPINLOCK_INIT;
+struct mutex_t bench_mutex = MUTEX_INIT;
+struct rwlock_t bench_rwlock = RWLOCK_INIT;
+volatile uint32_t bench_counter;
+volatile uint32_t lock_kind;
+volatile uint32_t lock_threads_done;
+uint32_t lock_results[1u << LOG2_LOCK_THREADS];
+volatile uint32_t slack_threads_done;
+uint32_t slack_us;
+time_t slack_base;
+
+void stats_reset(struct bench_stats_t *stats)
+{
+    stats->n = 0;
+    stats->min = ~0;
+    stats->max = 0;
+    stats->sum = 0;
+}
+
+void stats_add(struct bench_stats_t *stats, uint32_t value)
+{
+    stats->n++;
+    stats->sum += value;
+    if (value < stats->min)
+        stats->min = value;
+    if (value > stats->max)
+        stats->max = value;
+}
+
+void stats_print(const char *name, const char *unit, struct bench_stats_t *stats, uint32_t log2_n)
+{
+    uprintf("BENCH %s unit=%s n=%u min=%u avg=%u max=%u\n", name, unit,
+            (unsigned int) stats->n, (unsigned int) stats->min,
+            (unsigned int) (stats->sum >> log2_n), (unsigned int) stats->max);
+}
+
+/* cost of a syscall which does nothing (sleep with 0 ms returns at once) */
+void bench_null_syscall()
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+
+    for (uint32_t i=0; i<(1u << LOG2_N_SYSCALL); i++) {
+        uint32_t start = pmu_read_cycles();
+        sleep(0);
+        stats_add(&stats, pmu_read_cycles() - start);
+    }
+    stats_print("null_syscall", "cycles", &stats, LOG2_N_SYSCALL);
+}
+
+/* reading the own thread id from the TLS block, for comparison with
+null_syscall */
+void bench_tls_read()
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+    volatile uint32_t tid;
+
+    for (uint32_t i=0; i<(1u << LOG2_N_SYSCALL); i++) {
+        uint32_t start = pmu_read_cycles();
+        tid = gettid();
+        stats_add(&stats, pmu_read_cycles() - start);
+    }
+    (void) tid;
+    stats_print("tls_read", "cycles", &stats, LOG2_N_SYSCALL);
+}
+
+/* partner of the switch benchmark: yields a fixed number of times */
+void switch_partner(void *x)
+{
+    (void) x;
+    for (uint32_t i=0; i<(1u << LOG2_N_SWITCH) + SWITCH_PARTNER_EXTRA; i++)
+        yield();
+}
+
+/* one sample is a round trip: to the partner and back again */
+void bench_switch(const char *name, uint8_t is_proc)
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+
+    thread_create(switch_partner, 0, 0, is_proc);
+    yield();    // let the partner start
+
+    uint32_t last = pmu_read_cycles();
+    for (uint32_t i=0; i<(1u << LOG2_N_SWITCH); i++) {
+        yield();
+        uint32_t now = pmu_read_cycles();
+        stats_add(&stats, now - last);
+        last = now;
+    }
+    stats_print(name, "cycles/roundtrip", &stats, LOG2_N_SWITCH);
+
+    // wait until the partner is gone
+    sleep(10);
+}
+
+void empty_thread(void *x)
+{
+    (void) x;
+    bench_done_threads++;
+}
+
+/* thread_create alone and together with running the new thread to its exit */
+void bench_thread_create()
+{
+    struct bench_stats_t create, spawn;
+    stats_reset(&create);
+    stats_reset(&spawn);
+
+    for (uint32_t i=0; i<(1u << LOG2_N_CREATE); i++) {
+        uint32_t done = bench_done_threads;
+        uint32_t start = pmu_read_cycles();
+        thread_create(empty_thread, 0, 0, 0);
+        uint32_t created = pmu_read_cycles();
+        while (bench_done_threads == done)
+            yield();
+        uint32_t end = pmu_read_cycles();
+
+        stats_add(&create, created - start);
+        stats_add(&spawn, end - start);
+    }
+    stats_print("thread_create", "cycles", &create, LOG2_N_CREATE);
+    stats_print("thread_spawn_exit", "cycles", &spawn, LOG2_N_CREATE);
+}
+
+/* how late sleep(1) returns */
+void bench_sleep_jitter()
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+
+    for (uint32_t i=0; i<(1u << LOG2_N_SLEEP); i++) {
+        time_t start = clock_us();
+        sleep(1);
+        uint32_t slept = (uint32_t) (clock_us() - start);
+        stats_add(&stats, (slept > 1000) ? (slept - 1000) : 0);
+    }
+    stats_print("sleep_1ms_late", "us", &stats, LOG2_N_SLEEP);
+}
+
+void bench_uart_write()
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+
+    for (uint32_t i=0; i<(1u << LOG2_N_WRITE); i++) {
+        uint32_t start = pmu_read_cycles();
+        for (uint32_t j=0; j<WRITE_BLOCK-1; j++)
+            write_char('.');
+        write_char('\n');
+        stats_add(&stats, (pmu_read_cycles() - start) >> LOG2_WRITE_BLOCK);
+    }
+    stats_print("uart_write", "cycles/char", &stats, LOG2_N_WRITE);
+}
+
+struct ring_t bench_ring;
+char ring_line[WRITE_BLOCK];
+
+/* a batch of RING_ENTRIES no-ops per ring_enter; per operation */
+void bench_ring_nop()
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+
+    for (uint32_t i=0; i<(1u << LOG2_N_SYSCALL); i++) {
+        uint32_t start = pmu_read_cycles();
+        struct ring_sqe_t *sqe;
+        while ((sqe = uring_get_sqe(&bench_ring)) != 0) {
+            uring_prep(sqe, RING_OP_NOP, 0, 0, 0, 0);
+            uring_push_sqe(&bench_ring);
+        }
+        ring_enter(RING_ENTRIES);
+        while (uring_peek_cqe(&bench_ring))
+            uring_cqe_seen(&bench_ring);
+        stats_add(&stats, (pmu_read_cycles() - start) / RING_ENTRIES);
+    }
+    stats_print("ring_nop_batch", "cycles/op", &stats, LOG2_N_SYSCALL);
+}
+
+/* same lines as bench_uart_write, one submission per line */
+void bench_ring_write()
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+
+    for (uint32_t j=0; j<WRITE_BLOCK-1; j++)
+        ring_line[j] = ':';
+    ring_line[WRITE_BLOCK-1] = '\n';
+
+    for (uint32_t i=0; i<(1u << LOG2_N_WRITE); i++) {
+        uint32_t start = pmu_read_cycles();
+        struct ring_sqe_t *sqe = uring_get_sqe(&bench_ring);
+        uring_prep(sqe, RING_OP_WRITE, 0, (uint32_t) ring_line, WRITE_BLOCK, i);
+        uring_push_sqe(&bench_ring);
+        ring_enter(1);
+        uring_cqe_seen(&bench_ring);
+        stats_add(&stats, (pmu_read_cycles() - start) >> LOG2_WRITE_BLOCK);
+    }
+    stats_print("uart_write_ring", "cycles/char", &stats, LOG2_N_WRITE);
+}
+
+uint32_t file_chunk[FILE_CHUNK / 4];
+
+volatile uint32_t file_sum;
+
+/* sequential writes of a new tmpfs file, then sequential reads of it,
+with read() and through a mapping (first touch of every page included) */
+void bench_file()
+{
+    struct bench_stats_t wstats, rstats, mstats;
+    stats_reset(&wstats);
+    stats_reset(&rstats);
+    stats_reset(&mstats);
+
+    int32_t fd = open("bench.dat", O_CREAT | O_TRUNC | O_WRONLY);
+    if (fd < 0)
+        return;
+    for (uint32_t i=0; i<(1u << LOG2_N_FILE); i++) {
+        uint32_t start = pmu_read_cycles();
+        write(fd, file_chunk, FILE_CHUNK);
+        stats_add(&wstats, (pmu_read_cycles() - start) >> LOG2_FILE_CHUNK_KIB);
+    }
+    close(fd);
+
+    fd = open("bench.dat", O_RDONLY);
+    for (uint32_t i=0; i<(1u << LOG2_N_FILE); i++) {
+        uint32_t start = pmu_read_cycles();
+        read(fd, file_chunk, FILE_CHUNK);
+        uint32_t sum = 0;
+        for (uint32_t j=0; j<FILE_CHUNK / 4; j++)
+            sum += file_chunk[j];
+        file_sum = sum;
+        stats_add(&rstats, (pmu_read_cycles() - start) >> LOG2_FILE_CHUNK_KIB);
+    }
+
+    const uint32_t *map = mmap(fd, 0, FILE_CHUNK << LOG2_N_FILE, PROT_READ);
+    if (map != MAP_FAILED) {
+        for (uint32_t i=0; i<(1u << LOG2_N_FILE); i++) {
+            uint32_t start = pmu_read_cycles();
+            uint32_t sum = 0;
+            for (uint32_t j=0; j<FILE_CHUNK / 4; j++)
+                sum += map[i * (FILE_CHUNK / 4) + j];
+            file_sum = sum;
+            stats_add(&mstats, (pmu_read_cycles() - start) >> LOG2_FILE_CHUNK_KIB);
+        }
+        munmap((void *) map);
+    }
+    close(fd);
+    unlink("bench.dat");
+
+    stats_print("file_write", "cycles/KiB", &wstats, LOG2_N_FILE);
+    stats_print("file_read_sum", "cycles/KiB", &rstats, LOG2_N_FILE);
+    stats_print("file_mmap_sum", "cycles/KiB", &mstats, LOG2_N_FILE);
+}
+
+void block_hit_rate(const char *name, struct block_stats_t *before)
+{
+    struct block_stats_t after;
+    block_io(BLOCK_OP_STATS, 0, &after, 0);
+    uint32_t hits = after.hits - before->hits;
+    uint32_t total = hits + after.misses - before->misses;
+    uint32_t rate = total ? (100 * hits) / total : 0;
+    uprintf("BENCH %s unit=%% n=%u min=%u avg=%u max=%u\n", name,
+            (unsigned int) total, (unsigned int) rate, (unsigned int) rate, (unsigned int) rate);
+}
+
+/* SD card through the buffer cache: sequential reads (cold, with
+read-ahead), reads of a region in the cache, random single blocks
+and writes with write-back. Needs the card of "make disk" */
+void bench_block()
+{
+    struct bench_stats_t stats;
+    struct block_stats_t before;
+    block_io(BLOCK_OP_STATS, 0, &before, 0);
+    if (before.blocks < BLOCK_BENCH_LBA + (BLOCK_REQ << (LOG2_N_BLOCK + 1))) {
+        uprintf("BENCH_SKIP block: no SD card\n");
+        return;
+    }
+
+    stats_reset(&stats);
+    for (uint32_t i=0; i<(1u << LOG2_N_BLOCK); i++) {
+        uint32_t start = pmu_read_cycles();
+        block_io(BLOCK_OP_READ, BLOCK_BENCH_LBA + i * BLOCK_REQ, file_chunk, BLOCK_REQ);
+        stats_add(&stats, (pmu_read_cycles() - start) >> LOG2_FILE_CHUNK_KIB);
+    }
+    stats_print("block_seq_read", "cycles/KiB", &stats, LOG2_N_BLOCK);
+    block_hit_rate("block_seq_read_hits", &before);
+
+    for (uint32_t i=0; i<BLOCK_WARM_REQS; i++)
+        block_io(BLOCK_OP_READ, i * BLOCK_REQ, file_chunk, BLOCK_REQ);
+    block_io(BLOCK_OP_STATS, 0, &before, 0);
+    stats_reset(&stats);
+    for (uint32_t i=0; i<(1u << LOG2_N_BLOCK); i++) {
+        uint32_t start = pmu_read_cycles();
+        block_io(BLOCK_OP_READ, (i % BLOCK_WARM_REQS) * BLOCK_REQ, file_chunk, BLOCK_REQ);
+        stats_add(&stats, (pmu_read_cycles() - start) >> LOG2_FILE_CHUNK_KIB);
+    }
+    stats_print("block_cached_read", "cycles/KiB", &stats, LOG2_N_BLOCK);
+    block_hit_rate("block_cached_read_hits", &before);
+
+    /* single blocks at pseudo random places (LCG) */
+    uint32_t seed = 1;
+    block_io(BLOCK_OP_STATS, 0, &before, 0);
+    stats_reset(&stats);
+    for (uint32_t i=0; i<(1u << LOG2_N_BLOCK); i++) {
+        seed = seed * 1664525 + 1013904223;
+        uint32_t lba = BLOCK_BENCH_LBA + ((seed >> 8) & ((BLOCK_REQ << LOG2_N_BLOCK) - 1));
+        uint32_t start = pmu_read_cycles();
+        block_io(BLOCK_OP_READ, lba, file_chunk, 1);
+        stats_add(&stats, pmu_read_cycles() - start);
+    }
+    stats_print("block_random_read", "cycles/block", &stats, LOG2_N_BLOCK);
+    block_hit_rate("block_random_read_hits", &before);
+
+    /* writes behind the read region; the write-back shows up in some
+    samples and in the final sync */
+    block_io(BLOCK_OP_STATS, 0, &before, 0);
+    stats_reset(&stats);
+    uint32_t lba = BLOCK_BENCH_LBA + (BLOCK_REQ << LOG2_N_BLOCK);
+    for (uint32_t i=0; i<(1u << LOG2_N_BLOCK); i++) {
+        uint32_t start = pmu_read_cycles();
+        block_io(BLOCK_OP_WRITE, lba + i * BLOCK_REQ, file_chunk, BLOCK_REQ);
+        stats_add(&stats, (pmu_read_cycles() - start) >> LOG2_FILE_CHUNK_KIB);
+    }
+    uint32_t start = pmu_read_cycles();
+    block_io(BLOCK_OP_SYNC, 0, 0, 0);
+    uint32_t sync = pmu_read_cycles() - start;
+    stats_print("block_write", "cycles/KiB", &stats, LOG2_N_BLOCK);
+    uprintf("BENCH block_sync unit=cycles n=1 min=%u avg=%u max=%u\n",
+            (unsigned int) sync, (unsigned int) sync, (unsigned int) sync);
+
+    struct block_stats_t after;
+    block_io(BLOCK_OP_STATS, 0, &after, 0);
+    uint32_t cmds = after.dev_writes - before.dev_writes;
+    uint32_t blocks = after.dev_write_blocks - before.dev_write_blocks;
+    uint32_t per_cmd = cmds ? blocks / cmds : 0;
+    uprintf("BENCH block_write_batch unit=blocks/cmd n=%u min=%u avg=%u max=%u\n",
+            (unsigned int) cmds, (unsigned int) per_cmd, (unsigned int) per_cmd, (unsigned int) per_cmd);
+}
+
+/* the runner (tools/qemu_run.py) answers the INPUT line with the
+requested number of chars */
+void bench_uart_read()
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+    char c;
+
+    uprintf("INPUT %u\n", (1u << LOG2_N_READ) + 1);
+    read_char(&c);  // first char: wait for the runner
+
+    for (uint32_t i=0; i<(1u << LOG2_N_READ); i++) {
+        uint32_t start = pmu_read_cycles();
+        read_char(&c);
+        stats_add(&stats, pmu_read_cycles() - start);
+    }
+    stats_print("uart_read", "cycles/char", &stats, LOG2_N_READ);
+}
+
+/* bulk input like a paste: the runner sends all chars at once, the
+FIFO is drained per interrupt and most reads find a char waiting */
+void bench_uart_read_burst()
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+    char c;
+
+    uprintf("INPUT %u\n", (1u << LOG2_N_BURST) + 1);
+    read_char(&c);
+
+    uint32_t start = pmu_read_cycles();
+    for (uint32_t i=0; i<(1u << LOG2_N_BURST); i++)
+        read_char(&c);
+    stats_add(&stats, (pmu_read_cycles() - start) >> LOG2_N_BURST);
+    stats_print("uart_read_burst", "cycles/char", &stats, 0);
+}
+
+void lock_op(uint32_t kind)
+{
+    switch (kind) {
+    case LOCK_SPIN:
+        spin_lock(&bench_spin);
+        bench_counter++;
+        spin_unlock(&bench_spin);
+        break;
+    case LOCK_MUTEX:
+        mutex_lock(&bench_mutex);
+        bench_counter++;
+        mutex_unlock(&bench_mutex);
+        break;
+    case LOCK_RW_WRITE:
+        write_lock(&bench_rwlock);
+        bench_counter++;
+        write_unlock(&bench_rwlock);
+        break;
+    case LOCK_RW_READ:
+        read_lock(&bench_rwlock);
+        (void) bench_counter;
+        read_unlock(&bench_rwlock);
+        break;
+    default:
+        atomic_inc(&bench_counter);
+        break;
+    }
+}
+
+/* cost of one lock/unlock pair (or atomic increment) without contention */
+void bench_lock_uncontended(const char *name, uint32_t kind)
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+
+    for (uint32_t i=0; i<(1u << LOG2_N_SYSCALL); i++) {
+        uint32_t start = pmu_read_cycles();
+        lock_op(kind);
+        stats_add(&stats, pmu_read_cycles() - start);
+    }
+    stats_print(name, "cycles", &stats, LOG2_N_SYSCALL);
+}
+
+void lock_worker(void *x)
+{
+    uint32_t id = *((uint32_t *) x);
+    uint32_t kind = lock_kind;
+
+    uint32_t start = pmu_read_cycles();
+    for (uint32_t i=0; i<(1u << LOG2_N_LOCK); i++)
+        lock_op(kind);
+    lock_results[id] = (pmu_read_cycles() - start) >> LOG2_N_LOCK;
+    atomic_inc(&lock_threads_done);
+}
+
+/* threads of one process hammer the same lock; one sample per
+thread: its cycles per operation, waiting included */
+void bench_lock_contended(const char *name, uint32_t kind)
+{
+    struct bench_stats_t stats;
+    stats_reset(&stats);
+    const uint32_t n = 1u << LOG2_LOCK_THREADS;
+
+    lock_kind = kind;
+    lock_threads_done = 0;
+    for (uint32_t i=0; i<n; i++)
+        thread_create(lock_worker, &i, sizeof(i), 0);
+    while (atomic_load_acq(&lock_threads_done) < n)
+        sleep(1);
+
+    for (uint32_t i=0; i<n; i++)
+        stats_add(&stats, lock_results[i]);
+    stats_print(name, "cycles/op", &stats, LOG2_LOCK_THREADS);
+}
+
+/* push and pop of one item on an empty queue */
+void bench_mpmc()
+{
+    struct bench_stats_t stats;
+    struct mpmc_cell_t cells[4];
+    struct mpmc_queue_t queue;
+    uint32_t value;
+    stats_reset(&stats);
+    mpmc_init(&queue, cells, 4);
+
+    for (uint32_t i=0; i<(1u << LOG2_N_SYSCALL); i++) {
+        uint32_t start = pmu_read_cycles();
+        mpmc_push(&queue, i);
+        mpmc_pop(&queue, &value);
+        stats_add(&stats, pmu_read_cycles() - start);
+    }
+    stats_print("mpmc_push_pop", "cycles", &stats, LOG2_N_SYSCALL);
+}
+
+void slack_worker(void *x)
+{
+    uint32_t id = *((uint32_t *) x);
+
+    set_timer_slack(slack_us);
+    for (uint32_t i=1; i<=(1u << LOG2_N_SLACK_ROUNDS); i++)
+        sleep_until(slack_base + i * SLACK_PERIOD_US + id * SLACK_STAGGER_US);
+    atomic_inc(&slack_threads_done);
+}
+
+/* timer interrupts while periodic threads with staggered wake-up
+times sleep; with enough slack they share one interrupt per period */
+void bench_timer_slack(const char *name, uint32_t slack)
+{
+    struct bench_stats_t stats;
+    struct schedstat_t sched;
+    stats_reset(&stats);
+
+    slack_us = slack;
+    slack_threads_done = 0;
+    slack_base = clock_us() + SLACK_PERIOD_US;
+    for (uint32_t i=0; i<N_SLACK_THREADS; i++)
+        thread_create(slack_worker, &i, sizeof(i), 0);
+
+    sched_stats(SCHEDSTAT_RESET, &sched);
+    sleep_until(slack_base + ((1u << LOG2_N_SLACK_ROUNDS) + 1) * SLACK_PERIOD_US);
+    sched_stats(SCHEDSTAT_ALL, &sched);
+    while (atomic_load_acq(&slack_threads_done) < N_SLACK_THREADS)
+        sleep(1);
+
+    stats_add(&stats, sched.irq_late.count);
+    stats_print(name, "irqs", &stats, 0);
+}
+
+/* relates the cycle counter to the wall clock */
+void bench_cpu_freq()
+{
+    time_t start_us = clock_us();
+    uint32_t start = pmu_read_cycles();
+    while (clock_us() - start_us < FREQ_WINDOW_US)
+        continue;
+    uint32_t cycles = pmu_read_cycles() - start;
+    uint32_t mhz = cycles / (uint32_t) (clock_us() - start_us);
+
+    uprintf("BENCH cpu_freq unit=MHz n=1 min=%u avg=%u max=%u\n",
+            (unsigned int) mhz, (unsigned int) mhz, (unsigned int) mhz);
+}
+
+void main(void *x)
+{
+    (void) x;
+
+    prof_ctl(PROF_CTL_PMU_USER, 0);
+    uprintf("BENCH_START\n");
+    bench_cpu_freq();
+    bench_null_syscall();
+    bench_tls_read();
+    bench_switch("ctx_switch_thread", 0);
+    bench_switch("ctx_switch_process", 1);
+    bench_thread_create();
+    bench_sleep_jitter();
+    bench_timer_slack("timer_irqs_slack0", 0);
+    bench_timer_slack("timer_irqs_slack1000", 1000);
+    bench_uart_write();
+    if (ring_setup(&bench_ring) == 0) {
+        bench_ring_nop();
+        bench_ring_write();
+    }
+    bench_uart_read();
+    bench_uart_read_burst();
+    bench_file();
+    bench_block();
+    bench_lock_uncontended("atomic_inc", LOCK_ATOMIC);
+    bench_lock_uncontended("spinlock", LOCK_SPIN);
+    bench_lock_uncontended("mutex", LOCK_MUTEX);
+    bench_lock_uncontended("rwlock_read", LOCK_RW_READ);
+    bench_lock_uncontended("rwlock_write", LOCK_RW_WRITE);
+    bench_mpmc();
+    bench_lock_contended("atomic_inc_contended", LOCK_ATOMIC);
+    bench_lock_contended("spinlock_contended", LOCK_SPIN);
+    bench_lock_contended("mutex_contended", LOCK_MUTEX);
+    bench_lock_contended("rwlock_read_contended", LOCK_RW_READ);
+    bench_lock_contended("rwlock_write_contended", LOCK_RW_WRITE);
+    uprintf("BENCH_DONE\n");
+
+    shutdown();
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include <stdint.h>
+#include <kernel/timepage.h>
+#include <user/clock.h>
+
+#define TIME_PAGE   ((volatile struct time_page_t *) TIME_PAGE_VADDR)
+
+time_t clock_us()
+{
+    uint32_t seq;
+    time_t now;
+
+    do {
+        seq = TIME_PAGE->seq;
+        asm volatile("dmb" ::: "memory");
+
+        now = TIME_PAGE->base_us;
+        if (TIME_PAGE->cnt_valid) {
+            uint64_t delta = read_cntvct() - TIME_PAGE->base_cnt;
+            now += (delta * TIME_PAGE->mult) >> TIME_SHIFT;
+        }
+
+        asm volatile("dmb" ::: "memory");
+    } while ((seq & 1) || (seq != TIME_PAGE->seq));
+
+    return now;
+}
@@ -0,0 +1,195 @@
+#include <stdint.h>
+#include <user/sys.h>
+#include <user/print.h>
+#include <user/clock.h>
+#include <user/sync.h>
+#include <kernel/file.h>
+#include <kernel/schedstat.h>
+
+/*
+Interrupt and wakeup latency test in the style of cyclictest. Linked
+instead of main.c into build/kernel_latency.elf and started with
+"make latency".
+
+A measuring thread wakes up every LAT_INTERVAL_US with sleep_until()
+and takes the difference between the requested and the actual time
+as its wakeup latency. Every phase has 2^LOG2_LAT_LOOPS wakeups:
+- idle: no other threads
+- load: spinning threads and threads doing file IO (preemptible
+  syscalls) run at the same time
+- load_dl: like load, but the measuring thread is a deadline thread
+
+The kernel records how late the timer interrupts run (irq_late, see
+kernel/schedstat.h); the histogram is cleared at the start of each
+phase. Every phase prints
+    LAT <phase>.wakeup unit=us n=.. min=.. avg=.. p50=.. p90=.. p99=.. p999=.. max=..
+    LAT <phase>.irq unit=us n=.. avg=.. p50=.. p99=.. max=..
+    HIST <phase>.wakeup <us> <count>    (one line per non-empty bucket)
+and the run ends with LATENCY_DONE. The wakeup histogram has 1 us
+buckets, the irq percentiles are the upper bounds of the power of two
+buckets of the kernel. tools/qemu_run.py --max compares the max= fields
+with the limits of the Makefile.
+*/
+
+#define LOG2_LAT_LOOPS      10
+#define LAT_INTERVAL_US     1000
+#define LAT_HIST_US         1000    // the last bucket counts everything above
+#define LAT_DL_RUNTIME_US   200
+#define N_SPINNERS          2
+#define N_IO_THREADS        2
+#define IO_CHUNK            1024
+
+uint32_t hist[LAT_HIST_US];
+uint32_t io_buffer[N_IO_THREADS][IO_CHUNK / 4];
+
+volatile uint32_t load_stop;
+volatile uint32_t load_done;
+
+void spinner(void *x)
+{
+    (void) x;
+    while (!atomic_load_acq(&load_stop))
+        continue;
+    atomic_inc(&load_done);
+}
+
+/* writes and reads back its own file until the phase ends */
+void io_worker(void *x)
+{
+    uint32_t id = *(uint32_t*) x;
+    char name[] = "lat0.dat";
+    name[3] = '0' + id;
+
+    while (!atomic_load_acq(&load_stop)) {
+        int32_t fd = open(name, O_CREAT | O_TRUNC | O_WRONLY);
+        if (fd < 0)
+            break;
+        write(fd, io_buffer[id], IO_CHUNK);
+        close(fd);
+
+        fd = open(name, O_RDONLY);
+        if (fd < 0)
+            break;
+        read(fd, io_buffer[id], IO_CHUNK);
+        close(fd);
+    }
+    unlink(name);
+    atomic_inc(&load_done);
+}
+
+void load_start()
+{
+    load_stop = 0;
+    load_done = 0;
+    for (uint32_t i=0; i<N_SPINNERS; i++)
+        thread_create(spinner, &i, sizeof(i), 0);
+    for (uint32_t i=0; i<N_IO_THREADS; i++)
+        thread_create(io_worker, &i, sizeof(i), 0);
+}
+
+void load_end()
+{
+    atomic_store_rel(&load_stop, 1);
+    while (atomic_load_acq(&load_done) < N_SPINNERS + N_IO_THREADS)
+        sleep(1);
+}
+
+/* smallest latency below which permille of the n values lie */
+uint32_t hist_percentile(uint32_t n, uint32_t permille)
+{
+    uint32_t want = n - (n * (1000 - permille)) / 1000;
+    uint32_t seen = 0;
+    for (uint32_t us=0; us<LAT_HIST_US; us++) {
+        seen += hist[us];
+        if (seen >= want)
+            return us;
+    }
+    return LAT_HIST_US - 1;
+}
+
+/* upper bound of the kernel bucket below which pct percent lie */
+uint32_t irq_percentile(const struct lat_hist_t *irq, uint32_t pct)
+{
+    if (irq->count == 0)
+        return 0;
+
+    uint32_t want = irq->count - (irq->count / 100) * (100 - pct);
+    uint32_t seen = 0;
+    for (uint32_t i=0; i<SCHEDSTAT_BUCKETS; i++) {
+        seen += irq->buckets[i];
+        if (seen >= want)
+            return (i < SCHEDSTAT_BUCKETS - 1) ? (2u << i) : irq->max_us;
+    }
+    return irq->max_us;
+}
+
+void measure(const char *phase)
+{
+    struct schedstat_t stats;
+    uint32_t n = 1u << LOG2_LAT_LOOPS;
+    uint32_t min = 0xFFFFFFFF;
+    uint32_t max = 0;
+    uint32_t sum = 0;
+
+    for (uint32_t us=0; us<LAT_HIST_US; us++)
+        hist[us] = 0;
+    sched_stats(SCHEDSTAT_RESET, &stats);
+
+    time_t next = clock_us();
+    for (uint32_t i=0; i<n; i++) {
+        next += LAT_INTERVAL_US;
+        sleep_until(next);
+        time_t now = clock_us();
+        uint32_t lat = (now > next) ? (uint32_t) (now - next) : 0;
+
+        hist[(lat < LAT_HIST_US) ? lat : LAT_HIST_US - 1]++;
+        sum += lat;
+        if (lat < min)
+            min = lat;
+        if (lat > max)
+            max = lat;
+        // a wakeup later than the interval skips the missed periods
+        if (now > next + LAT_INTERVAL_US)
+            next = now;
+    }
+
+    sched_stats(SCHEDSTAT_ALL, &stats);
+
+    uprintf("LAT %s.wakeup unit=us n=%u min=%u avg=%u p50=%u p90=%u p99=%u p999=%u max=%u\n",
+            phase, (unsigned int) n, (unsigned int) min, (unsigned int) (sum >> LOG2_LAT_LOOPS),
+            (unsigned int) hist_percentile(n, 500), (unsigned int) hist_percentile(n, 900),
+            (unsigned int) hist_percentile(n, 990), (unsigned int) hist_percentile(n, 999),
+            (unsigned int) max);
+    uprintf("LAT %s.irq unit=us n=%u avg=%u p50=%u p99=%u max=%u\n",
+            phase, (unsigned int) stats.irq_late.count, (unsigned int) stats.irq_late.avg_us,
+            (unsigned int) irq_percentile(&stats.irq_late, 50),
+            (unsigned int) irq_percentile(&stats.irq_late, 99),
+            (unsigned int) stats.irq_late.max_us);
+    for (uint32_t us=0; us<LAT_HIST_US; us++) {
+        if (hist[us])
+            uprintf("HIST %s.wakeup %u %u\n", phase, (unsigned int) us, (unsigned int) hist[us]);
+    }
+}
+
+void main(void *x)
+{
+    (void) x;
+
+    uprintf("LATENCY_START\n");
+    measure("idle");
+
+    load_start();
+    measure("load");
+
+    if (set_deadline(LAT_DL_RUNTIME_US, LAT_INTERVAL_US, LAT_INTERVAL_US) == 0) {
+        measure("load_dl");
+        set_deadline(0, 0, 0);
+    }
+    else {
+        uprintf("LAT load_dl FAIL set_deadline rejected\n");
+    }
+    load_end();
+
+    uprintf("LATENCY_DONE\n");
+    shutdown();
+}
\ No newline at end of file
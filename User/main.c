@@ -4,6 +4,7 @@
 #include <kernel/kprintf.h>
 #include <config.h>
 #include <lib/math.h>
+#include <user/sync.h>
 
 #define N_REPEAT_CHAR       10
 #define BUSY_WAIT_SCALER    50
@@ -16,13 +17,13 @@ void demo_thread(void *x){
     uint8_t id=*((uint8_t*)x);
     while(global<117) {
         local++;
-        global++;
+        uint32_t value = atomic_inc(&global);
 
         write_char(c_print);
         write_char(':');
-        write_char((char)(global/100)+'0');
-        write_char((char)((global/10)%10)+'0');
-        write_char((char)(global%10)+'0');
+        write_char((char)(value/100)+'0');
+        write_char((char)((value/10)%10)+'0');
+        write_char((char)(value%10)+'0');
         write_char(' ');
         write_char('(');
         write_char((char) id+'0');
@@ -62,7 +63,12 @@ void main(void *x) {
         uint8_t ret_val = 1;
         while (ret_val) {
             ret_val = read_char(&c);
-            thread_create(demo_process, &c, sizeof(c), 1);
+            if (c == '!')
+                spawn("bin/hello", &c, sizeof(c));
+            else if (c == '?')
+                spawn("bin/top", &c, sizeof(c));
+            else
+                thread_create(demo_process, &c, sizeof(c), 1);
         }
 
     }
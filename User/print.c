@@ -0,0 +1,78 @@
+#include <stdint.h>
+#include <stdarg.h>
+#include <user/print.h>
+#include <user/sys.h>
+
+void uputs(const char *str)
+{
+    while (*str != '\0')
+        write_char(*str++);
+}
+
+void uprint_num(uint32_t num, uint32_t base)
+{
+    char digits[10];
+    uint32_t n = 0;
+
+    do {
+        uint32_t digit = num % base;
+        digits[n++] = (digit < 10) ? ('0' + digit) : ('a' + digit - 10);
+        num /= base;
+    } while (num != 0);
+
+    while (n > 0)
+        write_char(digits[--n]);
+}
+
+void uprintf(const char *fmt, ...)
+{
+    va_list argl;
+    va_start(argl, fmt);
+
+    for (; *fmt != '\0'; fmt++) {
+        if (*fmt != '%') {
+            write_char(*fmt);
+            continue;
+        }
+
+        fmt++;
+        switch (*fmt)
+        {
+        case 'c':
+            write_char((char) va_arg(argl, int));
+            break;
+        case 's':
+            uputs(va_arg(argl, const char *));
+            break;
+        case 'u':
+            uprint_num(va_arg(argl, unsigned int), 10);
+            break;
+        case 'i': {
+            int32_t num = va_arg(argl, int);
+            if (num < 0) {
+                write_char('-');
+                uprint_num(-(uint32_t) num, 10);
+            }
+            else {
+                uprint_num(num, 10);
+            }
+            break;
+        }
+        case 'x':
+            uprint_num(va_arg(argl, unsigned int), 16);
+            break;
+        case '%':
+            write_char('%');
+            break;
+        case '\0':
+            fmt--;
+            break;
+        default:
+            write_char('%');
+            write_char(*fmt);
+            break;
+        }
+    }
+
+    va_end(argl);
+}
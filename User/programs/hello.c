@@ -0,0 +1,24 @@
+#include <stdint.h>
+#include <user/sys.h>
+#include <user/print.h>
+#include <user/tls.h>
+
+/*
+Sample program of the initramfs (bin/hello). Started by user/main.c
+with spawn("bin/hello", ...). The globals live in the lazily
+populated data pages of the process.
+*/
+
+uint32_t greeted = 3;   // .data
+uint32_t counter;       // .bss
+
+void main(void *x)
+{
+    char c = *((char *) x);
+
+    while (counter < greeted) {
+        counter++;
+        uprintf("hello %u/%u from thread %u (%c)\n", counter, greeted, gettid(), c);
+        sleep(200);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <user/sys.h>
+#include <user/print.h>
+#include <user/clock.h>
+#include <kernel/thread.h>
+
+/*
+Shows the scheduler statistics (bin/top). Started by user/main.c with
+'?'. Prints TOP_ROUNDS reports, one per TOP_INTERVAL_MS:
+
+- load averages and the number of ready and running threads
+- the system wide histograms (see kernel/schedstat.h): count, mean,
+  50th and 99th percentile and maximum in us. Percentiles are the
+  upper bounds of the power of two buckets
+- one line per thread: CPU share in the last interval, switches and
+  its own latencies
+*/
+
+#define TOP_ROUNDS          5
+#define TOP_INTERVAL_MS     1000
+
+time_t last_cpu[MAX_THREADS];
+
+void print_col(uint32_t value, uint32_t width)
+{
+    uint32_t digits = 1;
+    for (uint32_t v=value; v>=10; v/=10)
+        digits++;
+    while (width-- > digits)
+        write_char(' ');
+    uprintf("%u", value);
+}
+
+/* smallest bucket bound below which pct percent of the values lie */
+uint32_t percentile(const struct lat_hist_t *hist, uint32_t pct)
+{
+    if (hist->count == 0)
+        return 0;
+
+    uint32_t want = hist->count - (hist->count / 100) * (100 - pct);
+    uint32_t seen = 0;
+    for (uint32_t i=0; i<SCHEDSTAT_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= want)
+            return (i < SCHEDSTAT_BUCKETS - 1) ? (2u << i) : hist->max_us;
+    }
+    return hist->max_us;
+}
+
+void print_hist(const char *name, const struct lat_hist_t *hist)
+{
+    uprintf("%s", name);
+    print_col(hist->count, 9);
+    print_col(hist->avg_us, 9);
+    print_col(percentile(hist, 50), 9);
+    print_col(percentile(hist, 99), 9);
+    print_col(hist->max_us, 9);
+    uprintf("\n");
+}
+
+void print_load(uint32_t load)
+{
+    uint32_t frac = ((load & ((1 << LOADAVG_SHIFT) - 1)) * 100) >> LOADAVG_SHIFT;
+    uprintf(" %u.%c%c", load >> LOADAVG_SHIFT, '0' + frac / 10, '0' + frac % 10);
+}
+
+void report(uint32_t interval_us)
+{
+    struct schedstat_t all;
+    sched_stats(SCHEDSTAT_ALL, &all);
+
+    uprintf("load");
+    for (uint32_t i=0; i<3; i++)
+        print_load(all.loadavg[i]);
+    uprintf(", running %u (max %u)\n", all.nr_running, all.nr_running_max);
+
+    uprintf("us                count     mean      p50      p99      max\n");
+    print_hist("runq wait ", &all.runq_wait);
+    print_hist("wake late ", &all.wake_late);
+    print_hist("slice     ", &all.slice);
+    print_hist("irq late  ", &all.irq_late);
+
+    uprintf("tid cpu%% switches wait p99 late p99 slice mean\n");
+    for (uint32_t tid=0; tid<MAX_THREADS; tid++) {
+        struct schedstat_t stats;
+        struct rusage_t usage;
+        if (sched_stats(tid, &stats) || getrusage(tid, &usage)) {
+            last_cpu[tid] = 0;
+            continue;
+        }
+
+        uint32_t cpu = (uint32_t) (usage.cpu_time - last_cpu[tid]);
+        last_cpu[tid] = usage.cpu_time;
+
+        print_col(tid, 3);
+        print_col(interval_us ? cpu / (interval_us / 100) : 0, 5);
+        print_col(usage.n_switches, 9);
+        print_col(percentile(&stats.runq_wait, 99), 9);
+        print_col(percentile(&stats.wake_late, 99), 9);
+        print_col(stats.slice.avg_us, 11);
+        uprintf("\n");
+    }
+}
+
+void main(void *x)
+{
+    (void) x;
+
+    for (uint32_t tid=0; tid<MAX_THREADS; tid++) {
+        struct rusage_t usage;
+        if (!getrusage(tid, &usage))
+            last_cpu[tid] = usage.cpu_time;
+    }
+
+    time_t last = clock_us();
+    for (uint32_t round=0; round<TOP_ROUNDS; round++) {
+        sleep(TOP_INTERVAL_MS);
+        time_t now = clock_us();
+        uprintf("\n--- top %u/%u ---\n", round + 1, TOP_ROUNDS);
+        report((uint32_t) (now - last));
+        last = now;
+    }
+}
\ No newline at end of file
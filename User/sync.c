@@ -0,0 +1,165 @@
+#include <stdint.h>
+#include <user/sync.h>
+#include <user/sys.h>
+
+void sync_backoff(uint32_t *round)
+{
+    uint32_t r = (*round)++;
+
+    if (r < SYNC_SPIN_ROUNDS) {
+        asm volatile("nop");
+    }
+    else if (r < SYNC_SPIN_ROUNDS + SYNC_YIELD_ROUNDS) {
+        yield();
+    }
+    else {
+        /* 1, 2, 4, ... ms */
+        uint32_t shift = r - SYNC_SPIN_ROUNDS - SYNC_YIELD_ROUNDS;
+        uint32_t millis = (shift < 4) ? (1u << shift) : SYNC_MAX_SLEEP_MS;
+        sleep(millis);
+    }
+}
+
+void spin_lock(struct spinlock_t *lock)
+{
+    while (spin_trylock(lock))
+        continue;
+}
+
+uint8_t spin_trylock(struct spinlock_t *lock)
+{
+    if (lock->locked || atomic_cmpxchg(&lock->locked, 0, 1) != 0)
+        return 1;
+    dmb();
+    return 0;
+}
+
+void spin_unlock(struct spinlock_t *lock)
+{
+    atomic_store_rel(&lock->locked, 0);
+}
+
+void mutex_lock(struct mutex_t *mutex)
+{
+    uint32_t round = 0;
+    while (mutex_trylock(mutex))
+        sync_backoff(&round);
+}
+
+uint8_t mutex_trylock(struct mutex_t *mutex)
+{
+    if (mutex->locked || atomic_cmpxchg(&mutex->locked, 0, 1) != 0)
+        return 1;
+    dmb();
+    return 0;
+}
+
+void mutex_unlock(struct mutex_t *mutex)
+{
+    atomic_store_rel(&mutex->locked, 0);
+}
+
+void read_lock(struct rwlock_t *lock)
+{
+    uint32_t round = 0;
+    for (;;) {
+        uint32_t state = lock->state;
+        if (!(state & (RWLOCK_WRITER | RWLOCK_WAITING))
+            && atomic_cmpxchg(&lock->state, state, state + 1) == state)
+            break;
+        sync_backoff(&round);
+    }
+    dmb();
+}
+
+void read_unlock(struct rwlock_t *lock)
+{
+    dmb();
+    atomic_dec(&lock->state);
+}
+
+void write_lock(struct rwlock_t *lock)
+{
+    uint32_t round = 0;
+    for (;;) {
+        /* set again in every round: the last writer clears it */
+        atomic_or(&lock->state, RWLOCK_WAITING);
+        if (atomic_cmpxchg(&lock->state, RWLOCK_WAITING, RWLOCK_WRITER) == RWLOCK_WAITING)
+            break;
+        sync_backoff(&round);
+    }
+    dmb();
+}
+
+void write_unlock(struct rwlock_t *lock)
+{
+    dmb();
+    atomic_xchg(&lock->state, 0);
+}
+
+void mpmc_init(struct mpmc_queue_t *queue, struct mpmc_cell_t *cells, uint32_t size)
+{
+    for (uint32_t i=0; i<size; i++)
+        cells[i].seq = i;
+    queue->cells = cells;
+    queue->mask = size - 1;
+    queue->head = 0;
+    queue->tail = 0;
+    dmb();
+}
+
+uint8_t mpmc_push(struct mpmc_queue_t *queue, uint32_t value)
+{
+    uint32_t pos = queue->tail;
+    struct mpmc_cell_t *cell;
+
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        int32_t diff = (int32_t) (atomic_load_acq(&cell->seq) - pos);
+
+        if (diff == 0) {
+            uint32_t prev = atomic_cmpxchg(&queue->tail, pos, pos + 1);
+            if (prev == pos)
+                break;
+            pos = prev;
+        }
+        else if (diff < 0) {
+            return 1;   // the consumer of the previous round has not taken the cell yet
+        }
+        else {
+            pos = queue->tail;  // another producer was faster
+        }
+    }
+
+    cell->value = value;
+    atomic_store_rel(&cell->seq, pos + 1);
+    return 0;
+}
+
+uint8_t mpmc_pop(struct mpmc_queue_t *queue, uint32_t *value)
+{
+    uint32_t pos = queue->head;
+    struct mpmc_cell_t *cell;
+
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        int32_t diff = (int32_t) (atomic_load_acq(&cell->seq) - (pos + 1));
+
+        if (diff == 0) {
+            uint32_t prev = atomic_cmpxchg(&queue->head, pos, pos + 1);
+            if (prev == pos)
+                break;
+            pos = prev;
+        }
+        else if (diff < 0) {
+            return 1;   // empty
+        }
+        else {
+            pos = queue->head;
+        }
+    }
+
+    *value = cell->value;
+    atomic_store_rel(&cell->seq, pos + queue->mask + 1);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include <stdint.h>
+#include <user/sys.h>
+#include <user/print.h>
+#include <user/sync.h>
+#include <kernel/file.h>
+
+/*
+Stress tests of the user synchronization library (user/sync.c).
+Linked instead of main.c into build/kernel_synctest.elf and started
+with "make synctest".
+
+Every test prints one line
+    TEST <name> ok
+or
+    TEST <name> FAIL <details>
+and the run ends with SYNCTEST_DONE failed=<n>.
+
+All workers are threads of one process, so they share the globals.
+Critical sections yield or busy wait in the middle to force
+preemption while a lock is held. The globals test starts a second
+process, whose globals are copied by the DMA (more than DMA_MIN_COPY
+bytes); it reports through a tmpfs file.
+*/
+
+#define N_WORKERS       4
+#define N_ITERATIONS    2000
+#define N_RW_READERS    3
+#define N_RW_ITER       500
+#define N_PRODUCERS     3
+#define N_CONSUMERS     3
+#define N_ITEMS         3000    // per producer
+#define QUEUE_SIZE      16      // small, so the queue is often full and empty
+#define WINDOW          20      // busy wait inside critical sections
+
+volatile uint32_t workers_done;
+uint32_t failed;
+
+struct spinlock_t spin = SPINLOCK_INIT;
+struct mutex_t mutex = MUTEX_INIT;
+struct rwlock_t rwlock = RWLOCK_INIT;
+volatile uint32_t counter;
+volatile uint32_t pair_a, pair_b;
+volatile uint32_t rw_violations;
+
+struct mpmc_cell_t cells[QUEUE_SIZE];
+struct mpmc_queue_t queue;
+volatile uint32_t producers_done;
+volatile uint32_t consumed_count;
+volatile uint32_t consumed_sum;
+volatile uint32_t order_violations;
+
+/* initialised globals, larger than DMA_MIN_COPY: word k is
+(k / 4) * 0x01010101 + k % 4 */
+#define GLOBALS_WORDS   80
+#define PAT4(j)         (j) * 0x01010101u, (j) * 0x01010101u + 1, (j) * 0x01010101u + 2, (j) * 0x01010101u + 3
+#define PAT16(j)        PAT4(4 * (j)), PAT4(4 * (j) + 1), PAT4(4 * (j) + 2), PAT4(4 * (j) + 3)
+uint32_t globals_pattern[GLOBALS_WORDS] = {PAT16(0), PAT16(1), PAT16(2), PAT16(3), PAT16(4)};
+#define GLOBALS_RESULT  "globals.res"
+
+void busy_wait(uint32_t n)
+{
+    for (volatile uint32_t i=0; i<n; i++)
+        continue;
+}
+
+/* starts n workers and waits until all of them called worker_exit() */
+void run_workers(void (*func)(void*), uint32_t n)
+{
+    workers_done = 0;
+    for (uint32_t i=0; i<n; i++)
+        thread_create(func, &i, sizeof(i), 0);
+    while (atomic_load_acq(&workers_done) < n)
+        sleep(1);
+}
+
+void worker_exit()
+{
+    atomic_inc(&workers_done);
+}
+
+void check(const char *name, uint32_t got, uint32_t expected)
+{
+    if (got == expected) {
+        uprintf("TEST %s ok\n", name);
+    }
+    else {
+        uprintf("TEST %s FAIL got=%u expected=%u\n", name, (unsigned int) got, (unsigned int) expected);
+        failed++;
+    }
+}
+
+void atomic_worker(void *x)
+{
+    (void) x;
+    for (uint32_t i=0; i<N_ITERATIONS; i++)
+        atomic_inc(&counter);
+    worker_exit();
+}
+
+void spin_worker(void *x)
+{
+    (void) x;
+    for (uint32_t i=0; i<N_ITERATIONS; i++) {
+        spin_lock(&spin);
+        uint32_t value = counter;
+        busy_wait(WINDOW);
+        counter = value + 1;
+        spin_unlock(&spin);
+    }
+    worker_exit();
+}
+
+void mutex_worker(void *x)
+{
+    uint32_t id = *((uint32_t *) x);
+    for (uint32_t i=0; i<N_ITERATIONS; i++) {
+        mutex_lock(&mutex);
+        uint32_t value = counter;
+        if ((i + id) % 64 == 0)
+            yield();    // give up the CPU while holding the mutex
+        else
+            busy_wait(WINDOW);
+        counter = value + 1;
+        mutex_unlock(&mutex);
+    }
+    worker_exit();
+}
+
+void test_counter(const char *name, void (*worker)(void*))
+{
+    counter = 0;
+    run_workers(worker, N_WORKERS);
+    check(name, counter, N_WORKERS * N_ITERATIONS);
+}
+
+/* writers keep pair_a == pair_b; readers must never see a difference */
+void rw_worker(void *x)
+{
+    uint32_t id = *((uint32_t *) x);
+
+    for (uint32_t i=0; i<N_RW_ITER; i++) {
+        if (id == 0) {
+            write_lock(&rwlock);
+            pair_a++;
+            if (i % 16 == 0)
+                yield();
+            else
+                busy_wait(WINDOW);
+            pair_b++;
+            write_unlock(&rwlock);
+        }
+        else {
+            read_lock(&rwlock);
+            uint32_t a = pair_a;
+            busy_wait(WINDOW);
+            if (pair_b != a)
+                atomic_inc(&rw_violations);
+            read_unlock(&rwlock);
+        }
+    }
+    worker_exit();
+}
+
+void test_rwlock()
+{
+    pair_a = pair_b = 0;
+    rw_violations = 0;
+    run_workers(rw_worker, N_RW_READERS + 1);
+    check("rwlock_consistency", rw_violations, 0);
+    check("rwlock_writes", pair_a, N_RW_ITER);
+}
+
+/* items are (producer << 16) | sequence number */
+void producer(void *x)
+{
+    uint32_t id = *((uint32_t *) x);
+    uint32_t round = 0;
+
+    for (uint32_t i=1; i<=N_ITEMS; i++) {
+        while (mpmc_push(&queue, (id << 16) | i))
+            sync_backoff(&round);
+        round = 0;
+    }
+    atomic_inc(&producers_done);
+    worker_exit();
+}
+
+void consumer(void *x)
+{
+    (void) x;
+    uint32_t last[N_PRODUCERS];
+    uint32_t round = 0;
+    uint32_t value;
+
+    for (uint32_t i=0; i<N_PRODUCERS; i++)
+        last[i] = 0;
+
+    for (;;) {
+        if (mpmc_pop(&queue, &value) == 0) {
+            uint32_t from = value >> 16;
+            uint32_t seq = value & 0xFFFF;
+            /* one consumer sees the items of a producer in order */
+            if (from >= N_PRODUCERS || seq <= last[from])
+                atomic_inc(&order_violations);
+            else
+                last[from] = seq;
+            atomic_inc(&consumed_count);
+            atomic_add_return(&consumed_sum, seq);
+            round = 0;
+        }
+        else if (atomic_load_acq(&producers_done) == N_PRODUCERS) {
+            /* producers are gone; a last pop catches items pushed
+            between the failed pop and the check */
+            if (mpmc_pop(&queue, &value) != 0)
+                break;
+            atomic_inc(&consumed_count);
+            atomic_add_return(&consumed_sum, value & 0xFFFF);
+        }
+        else {
+            sync_backoff(&round);
+        }
+    }
+    worker_exit();
+}
+
+/* producers and consumers in one run: worker i < N_PRODUCERS produces */
+void queue_worker(void *x)
+{
+    uint32_t id = *((uint32_t *) x);
+    if (id < N_PRODUCERS)
+        producer(x);
+    else
+        consumer(x);
+}
+
+void test_mpmc()
+{
+    mpmc_init(&queue, cells, QUEUE_SIZE);
+    producers_done = consumed_count = consumed_sum = order_violations = 0;
+    run_workers(queue_worker, N_PRODUCERS + N_CONSUMERS);
+
+    check("mpmc_count", consumed_count, N_PRODUCERS * N_ITEMS);
+    check("mpmc_sum", consumed_sum, N_PRODUCERS * (N_ITEMS * (N_ITEMS + 1) / 2));
+    check("mpmc_order", order_violations, 0);
+}
+
+/* runs in a new process: its globals must be the initial values, not
+those of its creator */
+void globals_child(void *x)
+{
+    (void) x;
+    uint32_t bad = 0;
+    for (uint32_t k=0; k<GLOBALS_WORDS; k++) {
+        if (globals_pattern[k] != (k / 4) * 0x01010101u + k % 4)
+            bad++;
+    }
+
+    int32_t fd = open(GLOBALS_RESULT, O_CREAT | O_TRUNC | O_WRONLY);
+    if (fd >= 0) {
+        write(fd, &bad, sizeof(bad));
+        close(fd);
+    }
+}
+
+void test_globals()
+{
+    for (uint32_t k=0; k<GLOBALS_WORDS; k++)
+        globals_pattern[k] = ~globals_pattern[k];   // the child must not see this
+    unlink(GLOBALS_RESULT);
+    thread_create(globals_child, 0, 0, 1);
+
+    uint32_t bad = GLOBALS_WORDS + 1;    // no result
+    for (uint32_t tries=0; tries<1000; tries++) {
+        int32_t fd = open(GLOBALS_RESULT, O_RDONLY);
+        if (fd >= 0) {
+            int32_t n = read(fd, &bad, sizeof(bad));
+            close(fd);
+            if (n == sizeof(bad))
+                break;
+        }
+        sleep(1);
+    }
+    unlink(GLOBALS_RESULT);
+    check("proc_globals", bad, 0);
+}
+
+void main(void *x)
+{
+    (void) x;
+
+    uprintf("SYNCTEST_START\n");
+    test_counter("atomic_counter", atomic_worker);
+    test_counter("spinlock_counter", spin_worker);
+    test_counter("mutex_counter", mutex_worker);
+    test_rwlock();
+    test_mpmc();
+    test_globals();
+    uprintf("SYNCTEST_DONE failed=%u\n", (unsigned int) failed);
+
+    shutdown();
+}
\ No newline at end of file
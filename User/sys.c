@@ -1,5 +1,8 @@
 #include <stdint.h>
 #include <kernel/syscalls.h>
+#include <kernel/rusage.h>
+#include <kernel/schedstat.h>
+#include <kernel/ring.h>
 
 #define STR(x)  #x
 #define XSTR(s) STR(s)
@@ -24,6 +27,32 @@ void sleep(uint32_t millis)
     asm("svc " XSTR(SYS_SLEEP));
 }
 
+void sleep_until(time_t wake_us)
+{
+    (void) wake_us;
+    asm("svc " XSTR(SYS_SLEEP_UNTIL));
+}
+
+uint8_t set_timer_slack(uint32_t slack_us)
+{
+    (void) slack_us;
+
+    asm("svc " XSTR(SYS_SET_TIMER_SLACK) ::: "r0");
+    register uint8_t ret asm("r0");
+
+    return ret;
+}
+
+uint8_t set_nice(int32_t nice)
+{
+    (void) nice;
+
+    asm("svc " XSTR(SYS_SET_NICE) ::: "r0");
+    register uint8_t ret asm("r0");
+
+    return ret;
+}
+
 
 uint8_t read_char(char* char_read)
 {
@@ -42,6 +71,188 @@ void write_char(char char_write)
     asm("svc " XSTR(SYS_WRITE_CHAR) ::: );
 }
 
+void trace_mark(uint32_t id, uint32_t value)
+{
+    (void) id;
+    (void) value;
+    asm("svc " XSTR(SYS_TRACE_MARK));
+}
+
+void trace_ctl(uint32_t op)
+{
+    (void) op;
+    asm("svc " XSTR(SYS_TRACE_CTL));
+}
+
+uint8_t getrusage(int32_t tid, struct rusage_t *usage)
+{
+    (void) tid;
+    (void) usage;
+
+    asm("svc " XSTR(SYS_GETRUSAGE) ::: "r0");
+    register uint8_t ret asm("r0");
+
+    return ret;
+}
+
+uint8_t sched_stats(int32_t tid, struct schedstat_t *stats)
+{
+    (void) tid;
+    (void) stats;
+
+    asm("svc " XSTR(SYS_SCHED_STATS) ::: "r0");
+    register uint8_t ret asm("r0");
+
+    return ret;
+}
+
+void yield()
+{
+    asm("svc " XSTR(SYS_YIELD));
+}
+
+void shutdown()
+{
+    asm("svc " XSTR(SYS_SHUTDOWN));
+}
+
+void prof_ctl(uint32_t op, uint32_t hz)
+{
+    (void) op;
+    (void) hz;
+    asm("svc " XSTR(SYS_PROF_CTL));
+}
+
+uint8_t set_deadline(uint32_t runtime_us, uint32_t period_us, uint32_t deadline_us)
+{
+    (void) runtime_us;
+    (void) period_us;
+    (void) deadline_us;
+
+    asm("svc " XSTR(SYS_SET_DEADLINE) ::: "r0");
+    register uint8_t ret asm("r0");
+    return ret;
+}
+
+uint8_t next_period()
+{
+    asm("svc " XSTR(SYS_NEXT_PERIOD) ::: "r0");
+    register uint8_t ret asm("r0");
+    return ret;
+}
+
+uint8_t ring_setup(struct ring_t *ring)
+{
+    (void) ring;
+
+    asm("svc " XSTR(SYS_RING_SETUP) ::: "r0");
+    register uint8_t ret asm("r0");
+    return ret;
+}
+
+uint32_t ring_enter(uint32_t min_complete)
+{
+    (void) min_complete;
+
+    asm("svc " XSTR(SYS_RING_ENTER) ::: "r0");
+    register uint32_t ret asm("r0");
+    return ret;
+}
+
+int32_t spawn(const char *path, const void *args, uint32_t args_size)
+{
+    (void) path;
+    (void) args;
+    (void) args_size;
+
+    asm("svc " XSTR(SYS_SPAWN) ::: "r0");
+    register int32_t ret asm("r0");
+    return ret;
+}
+
+int32_t open(const char *path, uint32_t flags)
+{
+    (void) path;
+    (void) flags;
+
+    asm("svc " XSTR(SYS_OPEN) ::: "r0");
+    register int32_t ret asm("r0");
+    return ret;
+}
+
+int32_t read(int32_t fd, void *buf, uint32_t len)
+{
+    (void) fd;
+    (void) buf;
+    (void) len;
+
+    asm("svc " XSTR(SYS_READ) ::: "r0");
+    register int32_t ret asm("r0");
+    return ret;
+}
+
+int32_t write(int32_t fd, const void *buf, uint32_t len)
+{
+    (void) fd;
+    (void) buf;
+    (void) len;
+
+    asm("svc " XSTR(SYS_WRITE) ::: "r0");
+    register int32_t ret asm("r0");
+    return ret;
+}
+
+int32_t close(int32_t fd)
+{
+    (void) fd;
+
+    asm("svc " XSTR(SYS_CLOSE) ::: "r0");
+    register int32_t ret asm("r0");
+    return ret;
+}
+
+int32_t unlink(const char *path)
+{
+    (void) path;
+
+    asm("svc " XSTR(SYS_UNLINK) ::: "r0");
+    register int32_t ret asm("r0");
+    return ret;
+}
+
+void * mmap(int32_t fd, uint32_t offset, uint32_t len, uint32_t flags)
+{
+    (void) fd;
+    (void) offset;
+    (void) len;
+    (void) flags;
+
+    asm("svc " XSTR(SYS_MMAP) ::: "r0");
+    register void *ret asm("r0");
+    return ret;
+}
+
+uint8_t munmap(void *addr)
+{
+    (void) addr;
+
+    asm("svc " XSTR(SYS_MUNMAP) ::: "r0");
+    register uint8_t ret asm("r0");
+    return ret;
+}
+
+int32_t block_io(uint32_t op, uint32_t lba, void *buf, uint32_t count)
+{
+    (void) op;
+    (void) lba;
+    (void) buf;
+    (void) count;
+
+    asm("svc " XSTR(SYS_BLOCK_IO) ::: "r0");
+    register int32_t ret asm("r0");
+    return ret;
+}
+
 void unknown_syscall()
 {
     asm("svc " XSTR(N_SYSCALL_CODES)); // this syscall can never exist
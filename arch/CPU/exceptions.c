@@ -1,10 +1,14 @@
 
 #include <kernel/kprintf.h>
+#include <kernel/klog.h>
 #include <kernel/thread.h>
 #include <kernel/syscalls.h>
+#include <kernel/trace.h>
+#include <kernel/softirq.h>
 #include <arch/bsp/intr.h>
 #include <arch/bsp/timer.h>
 #include <arch/bsp/uart.h>
+#include <arch/bsp/dma.h>
 #include <arch/cpu/arm.h>
 #include <arch/cpu/exceptions.h>
 #include <lib/primfunc.h>
@@ -69,18 +73,28 @@ const char *mode_names[N_MODES] =
 
 uint8_t enable_intr_regdump = 0;
 
-void handle_mode(struct registers_t *reg)
+/* spsr of the exception mode; the handlers of the trap frame entries
+take the cpsr of the interrupted code from the frame instead */
+uint32_t banked_spsr()
 {
-    uint32_t cpsr, spsr, spsr_mode;
+    uint32_t cpsr, spsr;
     _get_cpsr_spsr(&cpsr, &spsr);
-    spsr_mode = spsr & PSR_MODE_MASK;
+    return spsr;
+}
+
+void handle_mode(struct registers_t *reg, uint32_t spsr)
+{
+    uint32_t spsr_mode = spsr & PSR_MODE_MASK;
 
     if (spsr_mode == PSR_USR) {
+        /* the thread continues in exit(), which ends it on its own
+        kernel stack; the exception mode has none */
         kprintf("\nFault occured in current thread. Thread is terminated.\n");
-        terminate_current_thread(reg);
+        reg->lr = (uint32_t) &exit;
     }
     else {
         kprintf("\nFault occured in Kernel. System is halted.\n");
+        klog_flush_sync();
         while (1);
     }
 }
@@ -170,14 +184,14 @@ void print_mode_registers(const char * mode_name, struct mode_registers * mreg)
     kprintf("\n");
 }
 
-void print_exception(struct registers_t *reg)
+void print_exception(struct registers_t *reg, uint32_t spsr)
 {
     struct mode_registers mreg;
     uint32_t cpsr;
-    uint32_t spsr;
+    uint32_t banked;
     enum modes_t current_mode;
     
-    _get_cpsr_spsr(&cpsr, &spsr);
+    _get_cpsr_spsr(&cpsr, &banked);
     current_mode = get_mode(cpsr);
 
     kprintf("\n>>> Registerschnappschuss (aktueller Modus) <<<\n");
@@ -222,8 +236,9 @@ void undefined_instruction(struct registers_t *reg)
     kprintf("########################################\n");
     kprintf("Undefined instruction an Adresse 0x%08x \n", (unsigned int)cause_pc);
 
-    print_exception(reg);
-    handle_mode(reg);
+    uint32_t spsr = banked_spsr();
+    print_exception(reg, spsr);
+    handle_mode(reg, spsr);
 }
 
 void software_interrupt(struct registers_t *reg)
@@ -232,9 +247,8 @@ void software_interrupt(struct registers_t *reg)
     uint8_t svc_error = 0;
 
     // only allow software interrupts during user mode
-    uint32_t cpsr, spsr, spsr_mode;
-    _get_cpsr_spsr(&cpsr, &spsr);
-    spsr_mode = spsr & PSR_MODE_MASK;
+    uint32_t spsr = TRAP_FRAME(reg)->spsr;
+    uint32_t spsr_mode = spsr & PSR_MODE_MASK;
 
     if (spsr_mode == PSR_USR) {
         /*  Supervisor Code is:
@@ -248,7 +262,10 @@ void software_interrupt(struct registers_t *reg)
         #define SVC_CODE_MASK   0xFF
         uint32_t svc_code = SVC_CODE_MASK & *((uint32_t*) cause_pc);
 
+        uint16_t tid = trace_current_tid();
+        trace_event(TRACE_SYSCALL_ENTRY, tid, svc_code, 0);
         svc_error = process_svc_code(svc_code, reg);
+        trace_event(TRACE_SYSCALL_EXIT, tid, svc_code, svc_error);
     }
     else {
         svc_error = 1;
@@ -258,9 +275,12 @@ void software_interrupt(struct registers_t *reg)
         kprintf("########################################\n");
         kprintf("Software interrupt an Adresse 0x%08x \n", (unsigned int)cause_pc);
 
-        print_exception(reg);
-        handle_mode(reg);
+        print_exception(reg, spsr);
+        handle_mode(reg, spsr);
     }
+
+    /* a thread the syscall made ready may be more urgent */
+    resched_check();
 }
 
 void prefetch_abort(struct registers_t *reg)
@@ -279,17 +299,32 @@ void prefetch_abort(struct registers_t *reg)
     fault_status &= 0xF; // get Status [0..3] bits
     kprintf("Fehler: %s\n", ifsr_fsrc[fault_status]);
 
-    print_exception(reg);
-    handle_mode(reg);
+    uint32_t spsr = banked_spsr();
+    print_exception(reg, spsr);
+    handle_mode(reg, spsr);
 }
 
 void data_abort(struct registers_t *reg)
 {
     uint32_t cause_pc = reg->lr - DATA_ABT_LR_OFFSET + DATA_ABT_LR_CORRECTION;    
+    uint32_t spsr = TRAP_FRAME(reg)->spsr;
     uint32_t fault_status;
     uint32_t fault_address;
     _get_fault_registers(&fault_status, &fault_address);
 
+    /* pages which are populated on demand: repeat the access. The
+    handler runs on the kernel stack of the thread, so it can wait for
+    the kernel lock of a preempted syscall */
+    if ((fault_status & ((1<<STATUS_4BIT) | 0xF)) == FSR_TRANSLATION_PAGE) {
+        kernel_lock();
+        uint8_t populated = thread_page_fault(fault_address);
+        kernel_unlock();
+        if (populated) {
+            reg->lr -= DATA_ABT_LR_CORRECTION;
+            return;
+        }
+    }
+
     kprintf("########################################\n");
     kprintf("Data Abort an Adresse 0x%08x \n", (unsigned int)cause_pc);
 
@@ -308,8 +343,8 @@ void data_abort(struct registers_t *reg)
     fault_status &= 0xF; // get Status [0..3] bits
     kprintf("Fehler: %s\n", dfsr_fsrc[fault_status]);
 
-    print_exception(reg);
-    handle_mode(reg);
+    print_exception(reg, spsr);
+    handle_mode(reg, spsr);
 }
 
 void unused_handler(struct registers_t *reg)
@@ -330,7 +365,7 @@ void irq(struct registers_t *reg)
         uint32_t cause_pc = reg->lr - IRQ_LR_OFFSET + IRQ_LR_CORRECTION; 
         kprintf("########################################\n");
         kprintf("IRQ an Adresse 0x%08x \n", (unsigned int)cause_pc);
-        print_exception(reg);
+        print_exception(reg, TRAP_FRAME(reg)->spsr);
     }
 
     /* Find interrupt source */
@@ -339,6 +374,8 @@ void irq(struct registers_t *reg)
         IRQ_TIMER_BASE + 1,
         IRQ_TIMER_BASE + 2,
         IRQ_TIMER_BASE + 3, // highest timer
+        IRQ_DMA_BASE + DMA_CH_MEMCPY,
+        IRQ_DMA_BASE + DMA_CH_UART_TX,
         IRQ_UART
     };
     const uint32_t N_IRQS = sizeof(POSSIBLE_IRQS) / sizeof(POSSIBLE_IRQS[0]);
@@ -364,10 +401,15 @@ void irq(struct registers_t *reg)
         return;
 
     /* IRQ handlers */
+    uint16_t tid = trace_current_tid();
+    trace_event(TRACE_IRQ_ENTRY, tid, irq_src, 0);
     switch(irq_src) {
         case IRQ_TIMER_BASE ... (IRQ_TIMER_BASE + NUM_TIMERS - 1):
             timer_intr_h(reg);
             break;
+        case IRQ_DMA_BASE ... (IRQ_DMA_BASE + DMA_CHANNELS - 1):
+            dma_intr_h(irq_src - IRQ_DMA_BASE);
+            break;
         case IRQ_UART:
             uart_intr_h(reg);
             break;
@@ -375,6 +417,10 @@ void irq(struct registers_t *reg)
             /* no handler for interrupt is defined */
             break;
     }
+    trace_event(TRACE_IRQ_EXIT, tid, irq_src, 0);
+
+    /* bottom halves and thread switch */
+    irq_exit();
 }
 
 void fiq(struct registers_t *reg)
@@ -383,7 +429,7 @@ void fiq(struct registers_t *reg)
         uint32_t cause_pc = reg->lr - FIQ_LR_OFFSET + FIQ_LR_CORRECTION;  
         kprintf("########################################\n");
         kprintf("FIQ an Adresse 0x%08x \n", (unsigned int)cause_pc);
-        print_exception(reg);
+        print_exception(reg, banked_spsr());
     }
 }
 
@@ -0,0 +1,68 @@
+#include <stdint.h>
+#include <arch/cpu/pmu.h>
+
+#define PMCR_E      0   /* enable all counters */
+#define PMCR_P      1   /* reset event counters */
+#define PMCR_C      2   /* reset cycle counter */
+#define PMCR_N_OFF  11  /* number of event counters */
+#define PMCR_N_MASK 0x1F
+
+#define PMCNTEN_CYCLES  31
+
+#define PMUSERENR_EN    0
+
+const uint32_t pmu_events[PMU_N_EVENT_COUNTERS] = {
+    PMU_EV_INSTRUCTIONS,
+    PMU_EV_L1I_REFILL,
+    PMU_EV_L1D_REFILL,
+    PMU_EV_L1D_ACCESS
+};
+uint32_t pmu_n_counters = 0;
+
+void pmu_init()
+{
+    uint32_t pmcr;
+    asm volatile("mrc p15, 0, %0, c9, c12, 0" : "=r" (pmcr));
+
+    pmu_n_counters = (pmcr >> PMCR_N_OFF) & PMCR_N_MASK;
+    if (pmu_n_counters > PMU_N_EVENT_COUNTERS)
+        pmu_n_counters = PMU_N_EVENT_COUNTERS;
+
+    /* select events */
+    uint32_t cnten = (1 << PMCNTEN_CYCLES);
+    for (uint32_t i=0; i<pmu_n_counters; i++) {
+        asm volatile("mcr p15, 0, %0, c9, c12, 5" :: "r" (i));              // PMSELR
+        asm volatile("isb");
+        asm volatile("mcr p15, 0, %0, c9, c13, 1" :: "r" (pmu_events[i])); // PMXEVTYPER
+        cnten |= (1 << i);
+    }
+    asm volatile("mcr p15, 0, %0, c9, c12, 1" :: "r" (cnten));  // PMCNTENSET
+
+    /* reset and start all counters */
+    pmcr |= (1 << PMCR_E) | (1 << PMCR_P) | (1 << PMCR_C);
+    asm volatile("mcr p15, 0, %0, c9, c12, 0" :: "r" (pmcr));
+
+    pmu_user_access(0);
+}
+
+void pmu_user_access(uint8_t enable)
+{
+    uint32_t userenr = enable ? (1 << PMUSERENR_EN) : 0;
+    asm volatile("mcr p15, 0, %0, c9, c14, 0" :: "r" (userenr));
+    asm volatile("isb");
+}
+
+void pmu_read(struct pmu_counts_t *counts)
+{
+    counts->cycles = pmu_read_cycles();
+
+    for (uint32_t i=0; i<PMU_N_EVENT_COUNTERS; i++) {
+        uint32_t value = 0;
+        if (i < pmu_n_counters) {
+            asm volatile("mcr p15, 0, %0, c9, c12, 5" :: "r" (i));          // PMSELR
+            asm volatile("isb");
+            asm volatile("mrc p15, 0, %0, c9, c13, 2" : "=r" (value));     // PMXEVCNTR
+        }
+        counts->events[i] = value;
+    }
+}
@@ -0,0 +1,215 @@
+#include <stdint.h>
+#include <arch/bsp/dma.h>
+#include <arch/bsp/intr.h>
+#include <arch/cpu/arm.h>
+#include <arch/cpu/atomic.h>
+#include <kernel/softirq.h>
+
+/*
+ * Device driver for the DMA controller
+ * Datasheet: https://www.raspberrypi.org/app/uploads/2012/02/BCM2835-ARM-Peripherals.pdf
+ * Page: From 38
+ *
+ * The caches are off, so neither the control blocks nor the buffers
+ * need cache maintenance before or after a transfer.
+*/
+
+#define DMA_CS_ACTIVE       0   /* cs register, channel runs */
+#define DMA_CS_END          1   /* cs register, chain finished; write 1 to clear */
+#define DMA_CS_INT          2   /* cs register, interrupt status; write 1 to clear */
+#define DMA_CS_ERROR        8   /* cs register, error in the debug register */
+#define DMA_CS_PRIORITY     16  /* cs register, AXI priority (4 bits) */
+#define DMA_CS_PANIC        20  /* cs register, AXI panic priority (4 bits) */
+#define DMA_CS_WAIT_WRITES  28  /* cs register, wait for outstanding writes */
+#define DMA_CS_RESET        31  /* cs register, resets the channel */
+
+#define DMA_CHANNEL_STRIDE  0x100
+#define DMA_ENABLE_OFFSET   0xFF0
+
+struct dma_channel {
+    uint32_t cs;        /* control and status */
+    uint32_t conblk_ad; /* current control block */
+    uint32_t ti;        /* the registers below are loaded from the control block */
+    uint32_t source_ad;
+    uint32_t dest_ad;
+    uint32_t txfr_len;
+    uint32_t stride;
+    uint32_t nextconbk;
+    uint32_t debug;
+};
+
+/* A memcpy request is a copy block followed by a block which writes
+the sequence number of the request to dma_completed and raises the
+interrupt. Requests queued while a chain runs are linked to each other
+and started as the next chain: a running chain can not be extended
+safely, the channel loads nextconbk with the block. */
+struct dma_req_t {
+    struct dma_cb_t copy;
+    struct dma_cb_t done;
+    uint32_t seq;
+    dma_callback_t callback;
+    void *arg;
+} __attribute__((aligned(32)));
+
+#define DMA_REQ(seq)    (&dma_reqs[(seq) % DMA_QUEUE])
+
+struct dma_req_t dma_reqs[DMA_QUEUE];
+volatile uint32_t dma_completed = 0;    // written by the DMA: last finished request
+uint32_t dma_queued = 0;                // last request in the queue
+uint32_t dma_started = 0;               // last request handed to the channel
+uint32_t dma_reaped = 0;                // last request whose callback ran
+
+void (*dma_handlers[DMA_CHANNELS])(void);
+
+volatile struct dma_channel * dma_chan(uint32_t ch)
+{
+    return (volatile struct dma_channel *) (DMA_BASE + ch * DMA_CHANNEL_STRIDE);
+}
+
+uint32_t dma_bus_addr(const volatile void *ptr)
+{
+    uint32_t addr = (uint32_t) ptr;
+    if (addr >= PERIPH_OFFSET)
+        return addr - PERIPH_OFFSET + DMA_BUS_PERIPH;
+    return addr | DMA_BUS_RAM;
+}
+
+void dma_channel_start(uint32_t ch, const struct dma_cb_t *cb)
+{
+    volatile struct dma_channel *chan = dma_chan(ch);
+    dmb();  // the control block is complete in memory
+    chan->conblk_ad = dma_bus_addr(cb);
+    chan->cs = (1 << DMA_CS_ACTIVE) | (1 << DMA_CS_END) | (1 << DMA_CS_INT)
+             | (8 << DMA_CS_PRIORITY) | (8 << DMA_CS_PANIC) | (1 << DMA_CS_WAIT_WRITES);
+}
+
+uint8_t dma_channel_active(uint32_t ch)
+{
+    return (dma_chan(ch)->cs >> DMA_CS_ACTIVE) & 0x1;
+}
+
+uint32_t dma_channel_dest(uint32_t ch)
+{
+    return dma_chan(ch)->dest_ad;
+}
+
+void dma_channel_handler(uint32_t ch, void (*handler)(void))
+{
+    if (ch < DMA_CHANNELS)
+        dma_handlers[ch] = handler;
+}
+
+/* starts the queued requests if the channel finished its chain;
+interrupts must be disabled */
+void dma_kick()
+{
+    if ((dma_started == dma_queued) || (dma_completed != dma_started))
+        return;
+
+    /* the last block wrote dma_completed; the channel stops right after it */
+    while (dma_channel_active(DMA_CH_MEMCPY))
+        continue;
+
+    dma_channel_start(DMA_CH_MEMCPY, &DMA_REQ(dma_started + 1)->copy);
+    dma_started = dma_queued;
+}
+
+uint32_t dma_memcpy(void *dest, const void *src, uint32_t len, dma_callback_t done, void *arg)
+{
+    if (len == 0)
+        return 0;
+
+    uint32_t cpsr = irq_save();
+    if (dma_queued - dma_reaped >= DMA_QUEUE) {
+        irq_restore(cpsr);
+        return 0;
+    }
+
+    uint32_t seq = ++dma_queued;
+    struct dma_req_t *req = DMA_REQ(seq);
+    req->seq = seq;
+    req->callback = done;
+    req->arg = arg;
+
+    req->copy.ti = DMA_TI_SRC_INC | DMA_TI_DEST_INC | DMA_TI_BURST(4) | DMA_TI_WAIT_RESP;
+    req->copy.source_ad = dma_bus_addr(src);
+    req->copy.dest_ad = dma_bus_addr(dest);
+    req->copy.txfr_len = len;
+    req->copy.stride = 0;
+    req->copy.nextconbk = dma_bus_addr(&req->done);
+
+    req->done.ti = DMA_TI_INTEN | DMA_TI_WAIT_RESP;
+    req->done.source_ad = dma_bus_addr(&req->seq);
+    req->done.dest_ad = dma_bus_addr(&dma_completed);
+    req->done.txfr_len = sizeof(req->seq);
+    req->done.stride = 0;
+    req->done.nextconbk = 0;
+
+    /* append to the requests which wait for the next chain */
+    if (seq - 1 != dma_started)
+        DMA_REQ(seq - 1)->done.nextconbk = dma_bus_addr(&req->copy);
+
+    dma_kick();
+    irq_restore(cpsr);
+    return seq;
+}
+
+uint8_t dma_done(uint32_t ticket)
+{
+    return (int32_t) (dma_completed - ticket) >= 0;
+}
+
+void dma_wait(uint32_t ticket)
+{
+    while (!dma_done(ticket))
+        continue;
+}
+
+void dma_memcpy_intr_h()
+{
+    dma_kick();
+    raise_softirq(SOFTIRQ_DMA);
+}
+
+/* runs the callbacks of the finished requests */
+void dma_softirq()
+{
+    while (dma_reaped != dma_completed) {
+        struct dma_req_t *req = DMA_REQ(dma_reaped + 1);
+        dma_callback_t callback = req->callback;
+        void *arg = req->arg;
+
+        dma_reaped++;   // the slot may be reused from now on
+        if (callback)
+            callback(arg);
+    }
+}
+
+void dma_init()
+{
+    volatile uint32_t *enable = (volatile uint32_t *) (DMA_BASE + DMA_ENABLE_OFFSET);
+    const uint32_t channels[] = {DMA_CH_MEMCPY, DMA_CH_UART_TX};
+
+    for (uint32_t i=0; i<sizeof(channels)/sizeof(channels[0]); i++) {
+        *enable |= 1 << channels[i];
+        dma_chan(channels[i])->cs = 1 << DMA_CS_RESET;
+        interrupt_enable(IRQ_DMA_BASE + channels[i], 0);
+    }
+
+    dma_handlers[DMA_CH_MEMCPY] = dma_memcpy_intr_h;
+    softirq_register(SOFTIRQ_DMA, dma_softirq);
+}
+
+void dma_intr_h(uint32_t ch)
+{
+    if (ch >= DMA_CHANNELS)
+        return;
+
+    /* acknowledge; writing 0 to ACTIVE would pause a running chain,
+    writing 1 to an idle channel does nothing as conblk_ad is 0 */
+    volatile struct dma_channel *chan = dma_chan(ch);
+    chan->cs = (1 << DMA_CS_INT) | (chan->cs & (1 << DMA_CS_ACTIVE));
+
+    if (dma_handlers[ch])
+        dma_handlers[ch]();
+}
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include <stdint.h>
+#include <arch/bsp/emmc.h>
+#include <kernel/klog.h>
+#include <lib/time.h>
+
+/*
+ * Device driver for the EMMC controller (an Arasan SDHCI), used for
+ * the SD card. QEMU raspi2b emulates it as a standard SDHCI; attach a
+ * card with -drive if=sd,format=raw,file=<image>.
+ * Datasheet: https://www.raspberrypi.org/app/uploads/2012/02/BCM2835-ARM-Peripherals.pdf
+ * Page: From 65; commands and responses from the SD Physical Layer
+ * Simplified Specification.
+ *
+ * Transfers are polled and the data register is read/written by the
+ * CPU (no DMA). Multi-block transfers use CMD18/CMD25 with an
+ * automatic CMD12 at the end.
+*/
+
+struct emmc {
+    uint32_t arg2;
+    uint32_t blksizecnt;    /* block size [9:0], block count [31:16] */
+    uint32_t arg1;
+    uint32_t cmdtm;         /* command and transfer mode */
+    uint32_t resp[4];
+    uint32_t data;
+    uint32_t status;
+    uint32_t control0;
+    uint32_t control1;
+    uint32_t interrupt;
+    uint32_t irpt_mask;
+    uint32_t irpt_en;
+    uint32_t control2;
+};
+
+volatile struct emmc* emmc_dev = (struct emmc*) EMMC_BASE;
+
+/* cmdtm */
+#define TM_BLKCNT_EN        (1 << 1)
+#define TM_AUTO_CMD12       (1 << 2)
+#define TM_DAT_DIR_READ     (1 << 4)
+#define TM_MULTI_BLOCK      (1 << 5)
+#define CMD_RSPNS_NONE      (0 << 16)
+#define CMD_RSPNS_136       (1 << 16)
+#define CMD_RSPNS_48        (2 << 16)
+#define CMD_RSPNS_48_BUSY   (3 << 16)
+#define CMD_CRCCHK_EN       (1 << 19)
+#define CMD_IXCHK_EN        (1 << 20)
+#define CMD_ISDATA          (1 << 21)
+#define CMD_INDEX(i)        ((i) << 24)
+
+/* status */
+#define SR_CMD_INHIBIT      (1 << 0)
+#define SR_DAT_INHIBIT      (1 << 1)
+
+/* control0; bus power bits as in the SDHCI standard (reserved on the
+Arasan controller, needed by QEMU) */
+#define C0_HCTL_DWIDTH      (1 << 1)
+#define C0_BUS_POWER_3V3    (0xF << 8)
+
+/* control1 */
+#define C1_CLK_INTLEN       (1 << 0)
+#define C1_CLK_STABLE       (1 << 1)
+#define C1_CLK_EN           (1 << 2)
+#define C1_DATA_TOUNIT_MAX  (0xE << 16)
+#define C1_SRST_HC          (1 << 24)
+#define C1_SRST_CMD         (1 << 25)
+
+/* interrupt */
+#define INT_CMD_DONE        (1 << 0)
+#define INT_DATA_DONE       (1 << 1)
+#define INT_WRITE_RDY       (1 << 4)
+#define INT_READ_RDY        (1 << 5)
+#define INT_ERR             (1 << 15)
+#define INT_ERROR_MASK      0xFFFF8000
+
+#define BASE_CLOCK          50000000    // EMMC clock set by the firmware
+#define CLOCK_ID            400000      // identification mode
+#define CLOCK_TRANSFER      25000000    // default speed mode
+
+#define TIMEOUT_US          500000
+#define ACMD41_TRIES        1000
+
+/* SD commands */
+#define GO_IDLE_STATE       (CMD_INDEX(0) | CMD_RSPNS_NONE)
+#define ALL_SEND_CID        (CMD_INDEX(2) | CMD_RSPNS_136 | CMD_CRCCHK_EN)
+#define SEND_RELATIVE_ADDR  (CMD_INDEX(3) | CMD_RSPNS_48 | CMD_CRCCHK_EN | CMD_IXCHK_EN)
+#define SELECT_CARD         (CMD_INDEX(7) | CMD_RSPNS_48_BUSY | CMD_CRCCHK_EN | CMD_IXCHK_EN)
+#define SEND_IF_COND        (CMD_INDEX(8) | CMD_RSPNS_48 | CMD_CRCCHK_EN | CMD_IXCHK_EN)
+#define SEND_CSD            (CMD_INDEX(9) | CMD_RSPNS_136 | CMD_CRCCHK_EN)
+#define SET_BLOCKLEN        (CMD_INDEX(16) | CMD_RSPNS_48 | CMD_CRCCHK_EN | CMD_IXCHK_EN)
+#define READ_SINGLE_BLOCK   (CMD_INDEX(17) | CMD_RSPNS_48 | CMD_CRCCHK_EN | CMD_IXCHK_EN | CMD_ISDATA | TM_DAT_DIR_READ)
+#define READ_MULTIPLE_BLOCK (CMD_INDEX(18) | CMD_RSPNS_48 | CMD_CRCCHK_EN | CMD_IXCHK_EN | CMD_ISDATA | TM_DAT_DIR_READ \
+                            | TM_MULTI_BLOCK | TM_BLKCNT_EN | TM_AUTO_CMD12)
+#define WRITE_BLOCK         (CMD_INDEX(24) | CMD_RSPNS_48 | CMD_CRCCHK_EN | CMD_IXCHK_EN | CMD_ISDATA)
+#define WRITE_MULTIPLE_BLOCK (CMD_INDEX(25) | CMD_RSPNS_48 | CMD_CRCCHK_EN | CMD_IXCHK_EN | CMD_ISDATA \
+                            | TM_MULTI_BLOCK | TM_BLKCNT_EN | TM_AUTO_CMD12)
+#define APP_CMD             (CMD_INDEX(55) | CMD_RSPNS_48 | CMD_CRCCHK_EN | CMD_IXCHK_EN)
+#define SET_BUS_WIDTH       (CMD_INDEX(6) | CMD_RSPNS_48 | CMD_CRCCHK_EN | CMD_IXCHK_EN)  // ACMD6
+#define SD_SEND_OP_COND     (CMD_INDEX(41) | CMD_RSPNS_48)                              // ACMD41
+
+#define IF_COND_PATTERN     0x1AA       // 2.7-3.6 V, check pattern 0xAA
+#define OCR_BUSY            (1u << 31)  // set when the card is ready
+#define OCR_CCS             (1 << 30)   // block addressing (SDHC/SDXC)
+#define OCR_HCS_3V3         0x40FF8000
+
+uint32_t card_rca;
+uint8_t card_block_addressing;
+uint32_t card_blocks;
+
+/* waits until (reg & mask) == value; returns 1 on timeout */
+uint8_t emmc_wait(volatile uint32_t *reg, uint32_t mask, uint32_t value)
+{
+    time_t start = get_current_time();
+    while ((*reg & mask) != value) {
+        if (get_current_time() - start > TIMEOUT_US)
+            return 1;
+    }
+    return 0;
+}
+
+/* waits for one of the interrupt bits in mask and clears it; returns 1
+on errors and timeouts */
+uint8_t emmc_wait_int(uint32_t mask)
+{
+    time_t start = get_current_time();
+    uint32_t irpt;
+
+    while (!((irpt = emmc_dev->interrupt) & (mask | INT_ERR))) {
+        if (get_current_time() - start > TIMEOUT_US) {
+            klog(KLOG_ERROR, "emmc: timeout, interrupt 0x%08x", (unsigned int) irpt);
+            return 1;
+        }
+    }
+    if (irpt & INT_ERROR_MASK) {
+        klog(KLOG_ERROR, "emmc: error, interrupt 0x%08x", (unsigned int) irpt);
+        emmc_dev->interrupt = irpt;
+        return 1;
+    }
+    emmc_dev->interrupt = irpt & mask;
+    return 0;
+}
+
+uint8_t emmc_cmd(uint32_t cmd, uint32_t arg)
+{
+    uint32_t inhibit = SR_CMD_INHIBIT | ((cmd & CMD_ISDATA) ? SR_DAT_INHIBIT : 0);
+    if (emmc_wait(&emmc_dev->status, inhibit, 0)) {
+        klog(KLOG_ERROR, "emmc: controller busy");
+        return 1;
+    }
+
+    emmc_dev->interrupt = 0xFFFFFFFF;
+    emmc_dev->arg1 = arg;
+    emmc_dev->cmdtm = cmd;
+    return emmc_wait_int(INT_CMD_DONE);
+}
+
+uint8_t emmc_app_cmd(uint32_t cmd, uint32_t arg)
+{
+    if (emmc_cmd(APP_CMD, card_rca << 16))
+        return 1;
+    return emmc_cmd(cmd, arg);
+}
+
+uint8_t emmc_set_clock(uint32_t hz)
+{
+    if (emmc_wait(&emmc_dev->status, SR_CMD_INHIBIT | SR_DAT_INHIBIT, 0))
+        return 1;
+
+    /* 10 bit divider, the clock is BASE_CLOCK / (2 * div) */
+    uint32_t div = (BASE_CLOCK + 2 * hz - 1) / (2 * hz);
+    if (div > 0x3FF)
+        div = 0x3FF;
+
+    emmc_dev->control1 &= ~C1_CLK_EN;
+    emmc_dev->control1 = (emmc_dev->control1 & ~0xFFE0) | ((div & 0xFF) << 8) | ((div >> 8) << 6);
+    if (emmc_wait(&emmc_dev->control1, C1_CLK_STABLE, C1_CLK_STABLE))
+        return 1;
+    emmc_dev->control1 |= C1_CLK_EN;
+    return 0;
+}
+
+/* bits [start+width-1:start] of the CSD register in the response of
+SEND_CSD; the controller drops the CRC byte, so the response
+registers hold the CSD shifted 8 bits down */
+uint32_t csd_field(uint32_t start, uint32_t width)
+{
+    uint32_t bit = start - 8;
+    uint32_t word = bit / 32;
+    uint32_t shift = bit % 32;
+
+    uint32_t value = emmc_dev->resp[word] >> shift;
+    if ((shift + width > 32) && (word < 3))
+        value |= emmc_dev->resp[word + 1] << (32 - shift);
+    return value & ((1u << width) - 1);
+}
+
+uint32_t csd_blocks()
+{
+    if (csd_field(126, 2)) {
+        /* version 2: capacity (C_SIZE + 1) * 512 KiB */
+        return (csd_field(48, 22) + 1) << 10;
+    }
+    /* version 1: (C_SIZE + 1) * 2^(C_SIZE_MULT + 2) * 2^READ_BL_LEN bytes */
+    uint32_t c_size = csd_field(62, 12);
+    uint32_t mult = csd_field(47, 3);
+    uint32_t bl_len = csd_field(80, 4);
+    if (bl_len < 9)
+        return 0;
+    return (c_size + 1) << (mult + 2 + bl_len - 9);
+}
+
+uint8_t emmc_init()
+{
+    card_blocks = 0;
+    card_rca = 0;
+
+    emmc_dev->control0 = 0;
+    emmc_dev->control1 |= C1_SRST_HC;
+    if (emmc_wait(&emmc_dev->control1, C1_SRST_HC, 0)) {
+        klog(KLOG_WARN, "emmc: no controller");
+        return 1;
+    }
+
+    emmc_dev->control0 = C0_BUS_POWER_3V3;
+    emmc_dev->control1 = C1_CLK_INTLEN | C1_DATA_TOUNIT_MAX;
+    emmc_dev->irpt_mask = 0xFFFFFFFF;   // report everything in interrupt
+    emmc_dev->irpt_en = 0;              // but raise no IRQs
+    if (emmc_set_clock(CLOCK_ID))
+        return 1;
+
+    /* identification */
+    if (emmc_cmd(GO_IDLE_STATE, 0))
+        return 1;
+    uint8_t v2 = (emmc_cmd(SEND_IF_COND, IF_COND_PATTERN) == 0)
+        && ((emmc_dev->resp[0] & 0xFFF) == IF_COND_PATTERN);
+    if (!v2) {
+        /* version 1 cards do not answer; reset the command line */
+        emmc_dev->control1 |= C1_SRST_CMD;
+        emmc_wait(&emmc_dev->control1, C1_SRST_CMD, 0);
+    }
+
+    uint32_t ocr = 0;
+    for (uint32_t i=0; (i<ACMD41_TRIES) && !(ocr & OCR_BUSY); i++) {
+        if (emmc_app_cmd(SD_SEND_OP_COND, v2 ? OCR_HCS_3V3 : (OCR_HCS_3V3 & ~OCR_CCS))) {
+            klog(KLOG_WARN, "emmc: no SD card");
+            return 1;
+        }
+        ocr = emmc_dev->resp[0];
+        if (!(ocr & OCR_BUSY))
+            ksleep(1000);
+    }
+    if (!(ocr & OCR_BUSY)) {
+        klog(KLOG_WARN, "emmc: SD card does not get ready");
+        return 1;
+    }
+    card_block_addressing = (ocr & OCR_CCS) ? 1 : 0;
+
+    if (emmc_cmd(ALL_SEND_CID, 0) || emmc_cmd(SEND_RELATIVE_ADDR, 0))
+        return 1;
+    card_rca = emmc_dev->resp[0] >> 16;
+
+    if (emmc_cmd(SEND_CSD, card_rca << 16))
+        return 1;
+    uint32_t blocks = csd_blocks();
+
+    /* transfer mode: 512 byte blocks, 4 bit bus, full speed */
+    if (emmc_cmd(SELECT_CARD, card_rca << 16))
+        return 1;
+    if (!card_block_addressing && emmc_cmd(SET_BLOCKLEN, EMMC_BLOCK_SIZE))
+        return 1;
+    if (emmc_app_cmd(SET_BUS_WIDTH, 2) == 0)
+        emmc_dev->control0 |= C0_HCTL_DWIDTH;
+    if (emmc_set_clock(CLOCK_TRANSFER))
+        return 1;
+
+    card_blocks = blocks;
+    klog(KLOG_INFO, "emmc: SD card with %u blocks (%u MiB)",
+        (unsigned int) card_blocks, (unsigned int) (card_blocks >> 11));
+    return 0;
+}
+
+uint32_t emmc_block_count()
+{
+    return card_blocks;
+}
+
+uint8_t emmc_transfer(uint32_t lba, uint32_t count, uint8_t * const bufs[], uint8_t write)
+{
+    if ((card_blocks == 0) || (count == 0) || (count > 0xFFFF)
+        || (lba >= card_blocks) || (count > card_blocks - lba))
+        return 1;
+
+    uint32_t cmd;
+    if (write)
+        cmd = (count > 1) ? WRITE_MULTIPLE_BLOCK : WRITE_BLOCK;
+    else
+        cmd = (count > 1) ? READ_MULTIPLE_BLOCK : READ_SINGLE_BLOCK;
+
+    emmc_dev->blksizecnt = (count << 16) | EMMC_BLOCK_SIZE;
+    if (emmc_cmd(cmd, card_block_addressing ? lba : lba * EMMC_BLOCK_SIZE))
+        return 1;
+
+    for (uint32_t b=0; b<count; b++) {
+        if (emmc_wait_int(write ? INT_WRITE_RDY : INT_READ_RDY))
+            return 1;
+        uint32_t *words = (uint32_t *) bufs[b];
+        if (write) {
+            for (uint32_t i=0; i<EMMC_BLOCK_SIZE / 4; i++)
+                emmc_dev->data = words[i];
+        }
+        else {
+            for (uint32_t i=0; i<EMMC_BLOCK_SIZE / 4; i++)
+                words[i] = emmc_dev->data;
+        }
+    }
+    return emmc_wait_int(INT_DATA_DONE);
+}
+
+uint8_t emmc_read_blocks(uint32_t lba, uint32_t count, uint8_t * const bufs[])
+{
+    return emmc_transfer(lba, count, bufs, 0);
+}
+
+uint8_t emmc_write_blocks(uint32_t lba, uint32_t count, uint8_t * const bufs[])
+{
+    return emmc_transfer(lba, count, bufs, 1);
+}
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include <arch/bsp/intr.h>
 #include <arch/bsp/timer.h>
 #include <arch/bsp/mmu.h>
+#include <arch/bsp/power.h>
+#include <arch/bsp/emmc.h>
 
 #define BASE_ADDR_OFF 20
 #define BASE_ADDR_L2_OFF 12
@@ -35,6 +37,10 @@
 #define EXEC_NEVER_PRIV_L1_SEC_OFF 0
 #define EXEC_NEVER_PRIV_L1_REF_OFF 2
 
+#define NOT_GLOBAL_L2_OFF 11
+
+#define TTBCR_PD1_BIT   5   // no walks through TTBR1
+
 #define SCTLR_MMU_BIT   0
 #define SCTLR_CACHE_BIT 2
 
@@ -110,7 +116,9 @@ void mmu_init()
         else if (
             (virt_adr == (TIMER_BASE & BASE_ADDR_MASK_SECT)) ||
             (virt_adr == (UART_BASE & BASE_ADDR_MASK_SECT)) ||
-            (virt_adr == (INTR_BASE & BASE_ADDR_MASK_SECT))
+            (virt_adr == (INTR_BASE & BASE_ADDR_MASK_SECT)) ||
+            (virt_adr == (PM_BASE & BASE_ADDR_MASK_SECT)) ||
+            (virt_adr == (EMMC_BASE & BASE_ADDR_MASK_SECT))
             ) 
         {
             right = RIGHT_SYS_ONLY;
@@ -119,10 +127,11 @@ void mmu_init()
         L1_init(phy_adr, virt_adr, right, 0, xn);
     }
 
-    // put L1 in the TTBR0 reg
+    // put L1 in the TTBR0 reg until the first process runs
     asm("mrc p15, 0, r0, c2, c0, 0" ::: "r0");
     asm("orr r0, r0, %0" :: "r" (L1) : "r0");
     asm("mcr p15, 0, r0, c2, c0, 0");
+    asm("mcr p15, 0, %0, c13, c0, 1" :: "r" (MMU_KERNEL_ASID));   // CONTEXTIDR
 
     // set domain access DACR
     uint32_t domain = 0;
@@ -131,8 +140,9 @@ void mmu_init()
     asm("orr r0, r0, %0" :: "r" (dacr) : "r0");
     asm("mcr p15, 0, r0, c3, c0, 0");
 
-    // Activation of 32-Bit Translation in TTBCR
-    uint32_t ttbcr = 0;
+    // Activation of 32-Bit Translation in TTBCR, split at 2^(32-N);
+    // nothing is mapped above the split, accesses there fault
+    uint32_t ttbcr = MMU_TTBCR_N | (1 << TTBCR_PD1_BIT);
     asm("mcr p15, 0, %0, c2, c0, 2" :: "r" (ttbcr));
 
     // disable caches and enable MMU
@@ -145,6 +155,12 @@ void mmu_init()
 
 void L1_init(uint32_t phy_adr, uint32_t vir_adr, uint32_t right, uint8_t isL2, 
     uint8_t xn[] /* execute never / priviliged xn */)
+{
+    L1_set(L1, phy_adr, vir_adr, right, isL2, xn);
+}
+
+void L1_set(uint32_t table[], uint32_t phy_adr, uint32_t vir_adr, uint32_t right, uint8_t isL2,
+    uint8_t xn[] /* execute never / priviliged xn */)
 {
     uint32_t L1_entry = (isL2 ? SECTION_L2 : SECTION_ENTRY);
 
@@ -163,7 +179,24 @@ void L1_init(uint32_t phy_adr, uint32_t vir_adr, uint32_t right, uint8_t isL2,
     }
 
     uint32_t index = vir_adr >> BASE_ADDR_OFF;
-    L1[index] = L1_entry;
+    table[index] = L1_entry;
+}
+
+void mmu_proc_table_init(uint32_t table[])
+{
+    for (uint32_t i=0; i<MMU_PROC_L1_SIZE; i++)
+        table[i] = L1[i];
+}
+
+void mmu_switch(uint32_t table[], uint8_t asid)
+{
+    /* ASID first, then the table (as the ARMv7 switch of Linux). The
+    kernel does not touch user addresses in between and runs with
+    interrupts disabled */
+    asm volatile("mcr p15, 0, %0, c13, c0, 1" :: "r" ((uint32_t) asid));    // CONTEXTIDR
+    asm volatile("isb");
+    asm volatile("mcr p15, 0, %0, c2, c0, 0" :: "r" (table));
+    asm volatile("isb");
 }
 
 // returns an entry for an L2 table
@@ -178,11 +211,49 @@ uint32_t L2_init(uint32_t phy_adr, uint32_t right, uint8_t isGuard, uint8_t xn /
         L2_entry |= ((right >> 2) << RIGHT_OFF_L2_2); // Set upper bit of access rights
 
         L2_entry |= (xn << EXEC_NEVER_L2_SEC_OFF); // Set upper bit of access rights
+
+        // L2 tables only map process windows: TLB entries carry the ASID
+        L2_entry |= (1 << NOT_GLOBAL_L2_OFF);
     }
 
     return L2_entry;
 }
 
+uint8_t L2_user_access(uint32_t L2_entry, uint8_t write)
+{
+    if (!(L2_entry & SECTION_SMALL_PAGE))    // bit 0 is execute never
+        return 0;
+
+    uint32_t right = ((L2_entry >> RIGHT_OFF_L2_01) & 0x3) | (((L2_entry >> RIGHT_OFF_L2_2) & 0x1) << 2);
+    if (write)
+        return right == RIGHT_FULL_ACCESS;
+    return (right == RIGHT_FULL_ACCESS) || (right == RIGHT_BOTH_READ_ONLY) || (right == RIGHT_READ_ONLY);
+}
+
+uint32_t L2_phys(uint32_t L2_entry)
+{
+    return L2_entry & BASE_ADDR_MASK_SP;
+}
+
+void mmu_tlb_flush()
+{
+    asm("DSB"); // ensures visibility of the data cleaned from the D Cache
+    asm("MCR p15,0,r5,c8,c3,0" ::: "r5"); // invalidate entire unified TLB Inner Shareable
+    asm("MCR p15,0,r5,c8,c5,0" ::: "r5"); // invalidate entire instruction TLB
+    asm("MCR p15,0,r5,c8,c6,0" ::: "r5"); // invalidate entire data TLB
+    asm("MCR p15,0,r5,c8,c7,0" ::: "r5"); // invalidate entire unified TLB
+    asm("DSB"); // ensure completion of the Invalidate TLB operation
+    asm("ISB"); // ensure table changes visible to instruction fetch
+}
+
+void mmu_tlb_flush_asid(uint8_t asid)
+{
+    asm volatile("dsb");
+    asm volatile("mcr p15, 0, %0, c8, c7, 2" :: "r" ((uint32_t) asid));  // TLBIASID
+    asm volatile("dsb");
+    asm volatile("isb");
+}
+
 void print_L_table(uint32_t table[], uint32_t n_entries)
 {
     kprintf("#### Table at %p ####\n", table);
@@ -0,0 +1,35 @@
+#include <stdint.h>
+#include <arch/bsp/power.h>
+#include <kernel/klog.h>
+
+/*
+ * Device driver for the power management / watchdog block
+ * Not described in the BCM2835 datasheet; register layout as used by
+ * the Linux bcm2835_wdt driver
+*/
+
+#define PM_PASSWORD             0x5A000000
+#define PM_RSTC_WRCFG_CLR       0xFFFFFFCF
+#define PM_RSTC_WRCFG_FULL_RESET 0x00000020
+#define PM_WDOG_TICKS           10
+
+struct pm {
+    uint32_t unused1[7];
+    uint32_t rstc;      /* reset control */
+    uint32_t rsts;      /* reset status */
+    uint32_t wdog;      /* watchdog timer */
+};
+
+volatile struct pm* pm_dev = (struct pm*) PM_BASE;
+
+void power_reset()
+{
+    /* do not lose the end of the log */
+    klog_flush_sync();
+
+    pm_dev->wdog = PM_PASSWORD | PM_WDOG_TICKS;
+    pm_dev->rstc = PM_PASSWORD | (pm_dev->rstc & PM_RSTC_WRCFG_CLR) | PM_RSTC_WRCFG_FULL_RESET;
+
+    while (1)
+        continue;
+}
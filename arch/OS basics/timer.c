@@ -3,6 +3,7 @@
 #include <arch/bsp/intr.h>
 #include <arch/cpu/arm.h>
 #include <kernel/thread.h>
+#include <kernel/schedstat.h>
 #include <kernel/kprintf.h>
 #include <lib/assert.h>
 #include <lib/time.h>
@@ -21,7 +22,7 @@ struct time_tr {
 };
 
 /* offset of 0x200 given in table on datasheet page 112 */
-struct time_tr* timer_dev = (struct time_tr*) (TIMER_BASE);
+volatile struct time_tr* timer_dev = (struct time_tr*) (TIMER_BASE);
 uint32_t c_user_values[NUM_TIMERS];
 void (*timer_callbacks[NUM_TIMERS])(void * args);
 
@@ -58,19 +59,25 @@ void timer_intr_h(struct registers_t *reg)
     assert(timer_match >= 0);
     assert(timer_match < NUM_TIMERS);
 
+    /* interrupt latency: the compare register holds the time of the match */
+    schedstat_irq(timer_dev->clo - timer_dev->c[timer_match]);
+
     /* reset interrupt */
     timer_dev->cs = 1<<timer_match;
     timer_dev->c[timer_match] += c_user_values[timer_match];
 
-    /* handler */
-    if (timer_match == SCHEDULER_TIMER)
-        timer_callbacks[timer_match]((void *) reg);
-    else 
-        timer_callbacks[timer_match]((void *) 0);
+    /* handler; gets the interrupted context */
+    timer_callbacks[timer_match]((void *) reg);
 }
 
 void timer_get_counter(uint32_t * high, uint32_t * low)
 {
-    *high = timer_dev->chi;
-    *low = timer_dev->clo;
+    /* chi and clo can not be read at once. Re-read chi to detect
+    a carry from clo in between and read again in that case. */
+    uint32_t high_check;
+    do {
+        *high = timer_dev->chi;
+        *low = timer_dev->clo;
+        high_check = timer_dev->chi;
+    } while (*high != high_check);
 }
\ No newline at end of file
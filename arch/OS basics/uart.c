@@ -4,9 +4,11 @@
 #include <arch/cpu/arm.h>
 #include <arch/bsp/uart.h>
 #include <arch/bsp/intr.h>
+#include <arch/bsp/dma.h>
 #include <lib/primfunc.h>
 #include <kernel/kprintf.h>
-#include <kernel/thread.h>
+#include <kernel/klog.h>
+#include <kernel/softirq.h>
 #include <user/userthread.h>
 
 /*
@@ -18,7 +20,26 @@
 #define UART_CR_TX  8   /* cr register, receive flag */
 #define UART_CR_RX  9   /* cr register, transmit flag */
 
+#define UART_CR_EN  0   /* cr register, UART enable */
+
 #define INTR_RX     4    /* ris, mis and icr register; receive bit */
+#define INTR_TX     5    /* ris, mis and icr register; transmit bit */
+#define INTR_RT     6    /* ris, mis and icr register; receive timeout bit */
+
+#define UART_FR_BUSY    3   /* fr register, transmitting */
+#define UART_FR_RXFE    4   /* fr register, receive FIFO empty */
+#define UART_FR_TXFF    5   /* fr register, transmit FIFO full */
+
+#define UART_LCRH_FEN   4   /* lcrh register, FIFO enable */
+
+/* ifls register: the receive interrupt fires when the RX FIFO (16
+chars) is half full; fewer chars raise the receive timeout interrupt
+once the line was idle for 32 bit periods */
+#define UART_IFLS_RX_SHIFT  3
+#define UART_IFLS_RX_HALF   2
+#define UART_IFLS_TX_HALF   2
+
+#define UART_DMACR_TXDMAE   1   /* dmacr register, transmit DMA enable */
 
 
 struct uart {
@@ -44,44 +65,86 @@ struct uart {
     uint32_t tdr;       /* test data register */
 };
 
+/*
+Input ring between the interrupt handler (producer, writes head) and
+the bottom halves/syscalls (consumer, writes tail). head and tail run
+freely and are masked on access, so head - tail is the fill level and
+no flag or lock is needed. Single core: the producer only interrupts
+the consumer, a compiler barrier orders the accesses.
+*/
+#if (UART_INPUT_BUFFER_SIZE & (UART_INPUT_BUFFER_SIZE - 1)) != 0
+#error "UART_INPUT_BUFFER_SIZE must be a power of two"
+#endif
+#define RING_MASK   (UART_INPUT_BUFFER_SIZE - 1)
+
 struct ring_buf {
-    int32_t head;
-    int32_t tail;
-    uint8_t is_full;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;   // chars lost because the ring was full
     char buff[UART_INPUT_BUFFER_SIZE];
 };
 
+#define compiler_barrier()  asm volatile("" ::: "memory")
+
 volatile struct uart* uart_dev = (struct uart*) UART_BASE;
 volatile struct ring_buf uart_input_buffer = {0,0,0,{0}};
 
+/* The DMA moves 32 bit words to the data register, one char each */
+uint32_t uart_tx_words[UART_DMA_TX_MAX];
+struct dma_cb_t uart_tx_cb;
+uint8_t uart_tx_dma = 0;
+
+void uart_tx_dma_h()
+{
+    raise_softirq(SOFTIRQ_KLOG);
+}
+
 void uart_enable()
 {
-    uart_dev->imsc = (1 << INTR_RX);
+    /* the line control may only change while the UART is disabled and
+    idle; enabling the FIFOs keeps the baud rate and format */
+    uint32_t cr = uart_dev->cr;
+    uart_dev->cr = cr & ~(1 << UART_CR_EN);
+    while (uart_dev->fr & (1 << UART_FR_BUSY))
+        continue;
+    uart_dev->lcrh |= (1 << UART_LCRH_FEN);
+    uart_dev->ifls = (UART_IFLS_RX_HALF << UART_IFLS_RX_SHIFT) | UART_IFLS_TX_HALF;
+    uart_dev->cr = cr;
+
+    uart_dev->icr = (1 << INTR_RX) | (1 << INTR_RT);
+    uart_dev->imsc |= (1 << INTR_RX) | (1 << INTR_RT);
     interrupt_enable(IRQ_UART, 0);
+
+    uart_dev->dmacr |= (1 << UART_DMACR_TXDMAE);
+    dma_channel_handler(DMA_CH_UART_TX, uart_tx_dma_h);
+    uart_tx_dma = 1;
 }
 
 uint8_t uart_char_available()
 {
-    return !(uart_input_buffer.head == uart_input_buffer.tail);
+    return uart_input_buffer.head != uart_input_buffer.tail;
 }
 
 char uart_get_char()
 {
     /* wait for data */
-    while (!uart_input_buffer.is_full && !uart_char_available()) {
+    while (!uart_char_available()) {
         continue;
     }
+    compiler_barrier();     // read the char after head
 
-    char c = uart_input_buffer.buff[uart_input_buffer.tail];
-
-    uart_input_buffer.tail = (uart_input_buffer.tail + 1) % UART_INPUT_BUFFER_SIZE;
-    uart_input_buffer.is_full = 0;
+    uint32_t tail = uart_input_buffer.tail;
+    char c = uart_input_buffer.buff[tail & RING_MASK];
+    compiler_barrier();     // the slot is free once tail moved on
+    uart_input_buffer.tail = tail + 1;
 
     return c;
 }
 
 void uart_put_char(char c) 
 {
+    while (uart_dev->fr & (1 << UART_FR_TXFF))
+        continue;
     uart_dev->dr = c;
 }
 
@@ -91,10 +154,55 @@ void uart_put_str(const char *input){
         uart_put_char(*input++);
 }
 
-void uart_intr_h(struct registers_t * reg)
+uint8_t uart_tx_ready()
+{
+    return !(uart_dev->fr & (1 << UART_FR_TXFF));
+}
+
+void uart_tx_intr_enable(uint8_t enable)
+{
+    if (enable)
+        uart_dev->imsc |= (1 << INTR_TX);
+    else
+        uart_dev->imsc &= ~(1 << INTR_TX);
+}
+
+uint8_t uart_tx_intr_enabled()
+{
+    return (uart_dev->imsc >> INTR_TX) & 0x1;
+}
+
+uint8_t uart_dma_tx_enabled()
+{
+    return uart_tx_dma;
+}
+
+uint8_t uart_dma_tx_busy()
+{
+    return dma_channel_active(DMA_CH_UART_TX);
+}
+
+void uart_dma_tx(const char *chars, uint32_t n)
 {
-    char c = uart_dev->dr;
+    if (n > UART_DMA_TX_MAX)
+        n = UART_DMA_TX_MAX;
 
+    for (uint32_t i=0; i<n; i++)
+        uart_tx_words[i] = (uint8_t) chars[i];
+
+    uart_tx_cb.ti = DMA_TI_INTEN | DMA_TI_WAIT_RESP | DMA_TI_SRC_INC | DMA_TI_DEST_DREQ
+                  | DMA_TI_PERMAP(DMA_DREQ_UART_TX);
+    uart_tx_cb.source_ad = dma_bus_addr(uart_tx_words);
+    uart_tx_cb.dest_ad = dma_bus_addr(&uart_dev->dr);
+    uart_tx_cb.txfr_len = n * sizeof(uart_tx_words[0]);
+    uart_tx_cb.stride = 0;
+    uart_tx_cb.nextconbk = 0;
+    dma_channel_start(DMA_CH_UART_TX, &uart_tx_cb);
+}
+
+/* Task 5: some chars access invalid memory regions */
+void uart_fault_test(char c)
+{
     /* Task 5: access invalid memory regions */
     #define READ_FROM(location) \
             asm("mov r5, %0" :: "r"(location): "r5"); \
@@ -132,26 +240,51 @@ void uart_intr_h(struct registers_t * reg)
     default:
         break;
     }
+}
 
-    /* add received char to buffer */
-    if (uart_input_buffer.is_full) {
-        #ifdef DEBUG_ENABLE
-        uart_put_str("WARNING: Full UART buffer. The input (\0");
-        uart_put_char(c);
-        uart_put_str(") wasn't saved!\n\0");
-        #else
-        (void) c;
-        #endif // DEBUG_ENABLE
 
-        return;
+
+void uart_intr_h(struct registers_t * reg)
+{
+    (void) reg;
+
+    /* transmitter can take more chars of the kernel log */
+    if (uart_dev->mis & (1 << INTR_TX)) {
+        uart_dev->icr = (1 << INTR_TX);
+        raise_softirq(SOFTIRQ_KLOG);
     }
 
-    uart_input_buffer.buff[uart_input_buffer.head] = c;
-    uart_input_buffer.head = (uart_input_buffer.head + 1) % UART_INPUT_BUFFER_SIZE;
+    if (!(uart_dev->mis & ((1 << INTR_RX) | (1 << INTR_RT))))
+        return;
+    uart_dev->icr = (1 << INTR_RX) | (1 << INTR_RT);
 
-    if(uart_input_buffer.head == uart_input_buffer.tail)
-        uart_input_buffer.is_full = 1;
+    /* drain the whole FIFO; the bottom half runs once for all chars */
+    uint32_t head = uart_input_buffer.head;
+    uint32_t dropped = 0;
+    while (!(uart_dev->fr & (1 << UART_FR_RXFE))) {
+        char c = uart_dev->dr;  // bits 8-11 are error flags
+        uart_fault_test(c);
 
-    thread_process_char_received(reg);
+        if (head - uart_input_buffer.tail == UART_INPUT_BUFFER_SIZE) {
+            dropped++;
+            continue;
+        }
+        uart_input_buffer.buff[head & RING_MASK] = c;
+        head++;
+    }
+
+    if (dropped) {
+        uart_input_buffer.dropped += dropped;
+        #ifdef DEBUG_ENABLE
+        uart_put_str("WARNING: Full UART buffer, input was dropped!\n");
+        #endif // DEBUG_ENABLE
+    }
+
+    if (head != uart_input_buffer.head) {
+        compiler_barrier();     // the chars are in the ring before head
+        uart_input_buffer.head = head;
+        /* the waiting thread gets the chars in the bottom half */
+        raise_softirq(SOFTIRQ_UART_RX);
+    }
 }
 
@@ -0,0 +1,70 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <stdint.h>
+
+/*
+Block layer of the SD card (arch/bsp/emmc.h) with a buffer cache.
+
+- BCACHE_BUFFERS buffers of one block each, replaced in LRU order
+  and found through a hash table.
+- Read-ahead: a miss reads the missing blocks of the request in one
+  multi-block command. If the request continues the previous one,
+  the following blocks are read as well. The read-ahead window
+  doubles with every sequential request up to BLOCK_READAHEAD_MAX
+  and is dropped by a random access.
+- Write-back: writes only fill buffers. The dirty buffers are written
+  when BLOCK_DIRTY_MAX of them have piled up, when a dirty buffer is
+  evicted, or on block_sync(). They are sorted by block number, so
+  consecutive blocks go out in one command.
+
+The op codes, errors and statistics are also used by the block_io
+syscall (user/sys.h).
+*/
+
+#define BLOCK_SIZE          512
+#define BCACHE_BUFFERS      128
+#define BCACHE_HASH         64      // must be a power of two
+#define BLOCK_READAHEAD_MAX 32
+#define BLOCK_DIRTY_MAX     64
+#define BLOCK_BATCH_MAX     32      // blocks per command of the driver
+
+/* operations of block_io() */
+#define BLOCK_OP_READ       0
+#define BLOCK_OP_WRITE      1
+#define BLOCK_OP_SYNC       2
+#define BLOCK_OP_STATS      3       // buf: struct block_stats_t
+
+/* errors, returned as negative values */
+#define BLOCK_ERR_IO        -1
+#define BLOCK_ERR_NODEV     -2
+#define BLOCK_ERR_INVAL     -3
+#define BLOCK_ERR_FAULT     -4      // buffer outside of the process
+
+struct block_stats_t {
+    uint32_t blocks;            // size of the device
+    uint32_t read_blocks;       // requested by block_read()
+    uint32_t write_blocks;      // requested by block_write()
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t readahead;         // blocks read ahead
+    uint32_t readahead_used;    // of them, later requested
+    uint32_t dev_reads;         // commands to the driver
+    uint32_t dev_read_blocks;
+    uint32_t dev_writes;
+    uint32_t dev_write_blocks;
+};
+
+/* initializes the SD card and the cache */
+void block_init(void);
+
+/* copy count blocks from / to buf; return count or an error */
+int32_t block_read(uint32_t lba, uint32_t count, void *buf);
+int32_t block_write(uint32_t lba, uint32_t count, const void *buf);
+
+/* writes all dirty buffers; returns 0 or an error */
+int32_t block_sync(void);
+
+void block_stats(struct block_stats_t *stats);
+
+#endif // BLOCK_H
\ No newline at end of file
@@ -2,7 +2,7 @@
 #define DEBUG_H
 
 #include <config.h>
-#include <kernel/kprintf.h>
+#include <kernel/klog.h>
 
 #define DEBUG_LEVEL_ERROR   1
 #define DEBUG_LEVEL_WARN    2
@@ -10,19 +10,19 @@
 
 #ifdef DEBUG_LEVEL
     #if DEBUG_LEVEL >= DEBUG_LEVEL_ERROR
-        #define ERROR(msg)  kprintf("ERROR: "); kprintf(msg);
+        #define ERROR(msg)  klog(KLOG_ERROR, msg);
     #else
         #define ERROR(msg)
     #endif
 
     #if DEBUG_LEVEL >= DEBUG_LEVEL_WARN
-        #define WARN(msg)  kprintf("WARN: "); kprintf(msg);
+        #define WARN(msg)  klog(KLOG_WARN, msg);
     #else
         #define WARN(msg)
     #endif
 
     #if DEBUG_LEVEL >= DEBUG_LEBEL_INFO
-        #define INFO(msg)  kprintf("INFO: "); kprintf(msg);
+        #define INFO(msg)  klog(KLOG_INFO, msg);
     #else
         #define INFO(msg)
     #endif
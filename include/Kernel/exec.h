@@ -0,0 +1,53 @@
+#ifndef EXEC_H
+#define EXEC_H
+
+#include <stdint.h>
+
+/*
+Loader for standalone user programs (ELF executables in the tmpfs,
+usually unpacked from the initramfs).
+
+A program runs in its own 1 MiB window at PROG_VADDR, which is mapped
+by a second L2 table of its process. Stack, TLS and time page of the
+threads stay in the usual user window. Programs are linked with
+user/programs/prog.lds.
+
+- Segments without write permission (text, rodata) are loaded once
+  and mapped read-only into every process of the program. The
+  loaded program stays cached, so later starts only copy the L2
+  entries. A cached program whose file was rewritten or removed is
+  loaded again by the next start.
+- Writable segments (data, bss) are not mapped at start. The first
+  access to a page faults; exec_fault() then fills a private page
+  from a copy of the file data taken at load time (or with zeros).
+  A write, truncate or unlink of the file therefore does not change
+  the data of processes which already run the program.
+*/
+
+#define PROG_VADDR      0x20000000  // keep in sync with user/programs/prog.lds
+#define PROG_PATH_MAX   32
+#define MAX_PROGRAMS    8
+
+struct program_t;
+
+/* loads a program or returns the cached one; 0 if it does not exist
+or is no valid program */
+struct program_t * exec_load(const char *path);
+
+/* entry point of a program */
+uint32_t exec_entry(struct program_t *prog);
+
+/* maps the program into the program window of address space proc */
+void exec_map(struct program_t *prog, uint32_t proc);
+
+/* unmaps the program of address space proc and frees its data pages */
+void exec_release(uint32_t proc);
+
+/* L2 table of the program window of proc; 0 if proc runs no program */
+uint32_t * exec_table(uint32_t proc);
+
+/* handles a translation fault at addr in address space proc;
+returns 1 if the page was populated and the access can be repeated */
+uint8_t exec_fault(uint32_t proc, uint32_t addr);
+
+#endif // EXEC_H
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef FILE_H
+#define FILE_H
+
+#include <stdint.h>
+
+/*
+File descriptors of the processes. Every address space has its own
+table of FILE_MAX_FDS descriptors, shared by all threads of the
+process and closed when its last thread exits. Files live in the
+tmpfs (kernel/tmpfs.h).
+
+The flags and error codes are also used by the syscalls of
+user/sys.h.
+*/
+
+#define FILE_MAX_FDS        8
+
+/* flags of open() */
+#define O_RDONLY            0x0
+#define O_WRONLY            0x1
+#define O_RDWR              0x2
+#define O_ACCMODE           0x3
+#define O_CREAT             0x4     // create the file if it does not exist
+#define O_TRUNC             0x8     // cut an existing file to 0 bytes
+#define O_APPEND            0x10    // every write goes to the end of the file
+
+/* errors, returned as negative values */
+#define FILE_ERR_BADF       -1      // no open descriptor / wrong access mode
+#define FILE_ERR_NOENT      -2      // file does not exist
+#define FILE_ERR_NOSPC      -3      // no memory or no inode left
+#define FILE_ERR_MFILE      -4      // descriptor table is full
+#define FILE_ERR_INVAL      -5      // invalid name or flags
+#define FILE_ERR_FAULT      -6      // buffer or name outside of the process
+
+/* opens path for the process proc; returns the descriptor or an error */
+int32_t file_open(uint32_t proc, const char *path, uint32_t flags);
+
+/* reads up to len bytes at the offset of fd and advances it; returns
+the number of bytes (0 at the end of the file) or an error */
+int32_t file_read(uint32_t proc, int32_t fd, void *buf, uint32_t len);
+
+/* writes len bytes at the offset of fd and advances it; returns the
+number of written bytes or an error */
+int32_t file_write(uint32_t proc, int32_t fd, const void *buf, uint32_t len);
+
+/* returns 0 or an error */
+int32_t file_close(uint32_t proc, int32_t fd);
+
+/* removes the name; open descriptors keep the data until they are
+closed. Returns 0 or an error */
+int32_t file_unlink(const char *path);
+
+/* inode of the tmpfs file of fd, which has to be open for reading
+(access O_RDONLY) or for reading and writing (O_RDWR); returns
+FILE_ERR_BADF otherwise */
+int32_t file_inode(uint32_t proc, int32_t fd, uint32_t access);
+
+/* closes all descriptors of proc */
+void file_release(uint32_t proc);
+
+#endif // FILE_H
\ No newline at end of file
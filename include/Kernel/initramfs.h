@@ -0,0 +1,20 @@
+#ifndef INITRAMFS_H
+#define INITRAMFS_H
+
+#include <stdint.h>
+
+/*
+Archive of files which is linked into the kernel image
+(kernel/initramfs_data.S). The format is the "newc" format of cpio,
+written by tools/mkinitramfs.py. At boot its files are copied into
+the tmpfs (kernel/tmpfs.h), which is what programs and exec use.
+*/
+
+/* looks up a file; returns 0 and sets data and size if it exists,
+1 otherwise */
+uint8_t initramfs_find(const char *path, const uint8_t **data, uint32_t *size);
+
+/* calls func for every regular file of the archive */
+void initramfs_foreach(void (*func)(const char *path, const uint8_t *data, uint32_t size));
+
+#endif // INITRAMFS_H
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef KLOG_H
+#define KLOG_H
+
+#include <stdint.h>
+
+/*
+Kernel log ring buffer.
+
+kprintf() and klog() only format the message and copy it into a ring
+buffer. The UART is fed later by klog_drain(), which is called from
+the idle path of the scheduler and from the bottom half of the UART
+transmit interrupt (SOFTIRQ_KLOG).
+Writers never wait for the UART, so logging from IRQ or exception
+context does not change the timing of the system.
+
+Space in the ring is reserved with LDREX/STREX, so writers can
+interrupt each other. There is one ring per CPU; the drain merges
+them by timestamp.
+*/
+
+#define KLOG_N_CPUS         1
+#define KLOG_RING_SIZE      0x4000  // must be a power of two
+#define KLOG_MAX_MSG        256     // longer messages are split into several records
+#define KLOG_DRAIN_BUDGET   32      // max chars written per klog_drain() call
+
+/* severity of a record (same numbering as DEBUG_LEVEL in debug.h);
+PLAIN records are printed without prefix */
+#define KLOG_PLAIN  0
+#define KLOG_ERROR  1
+#define KLOG_WARN   2
+#define KLOG_INFO   3
+#define KLOG_DEBUG  4   // kept in the ring only with the default console level
+
+/* message which is assembled on the stack of the writer */
+struct klog_msg_t {
+    uint8_t level;
+    uint32_t ts;        // lower 32 bit of the system timer (us)
+    uint32_t len;
+    char buf[KLOG_MAX_MSG];
+};
+
+void klog_msg_init(struct klog_msg_t *msg, uint8_t level);
+void klog_msg_putc(struct klog_msg_t *msg, char c);
+void klog_msg_puts(struct klog_msg_t *msg, const char *str);
+void klog_msg_commit(struct klog_msg_t *msg);
+
+/* logs a message with timestamp and severity prefix */
+void klog(uint8_t level, char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* records with a level above the console level stay in the ring only */
+void klog_set_console_level(uint8_t level);
+
+/* writes pending records to the UART as long as it accepts them
+without waiting; at most KLOG_DRAIN_BUDGET chars per call. With
+UART DMA it starts a transfer of up to UART_DMA_TX_MAX chars instead */
+void klog_drain(void);
+
+/* writes all pending records and waits for the UART. Only for
+situations where the system can not continue (e.g. kernel faults) */
+void klog_flush_sync(void);
+
+/* queues len chars as plain records, so they keep their order with
+the log and go out through the same drain. For output which must not
+be dropped (write_char syscall, ring writes): only if the ring is
+full it waits for the UART */
+void klog_write(const char *buf, uint32_t len);
+
+#endif // KLOG_H
@@ -1,6 +1,13 @@
 #ifndef KPRINTF_H
 #define KPRINTF_H
 
+#include <stdarg.h>
+#include <kernel/klog.h>
+
 void kprintf(char *fmt, ...) __attribute__((format(printf, 1, 2)));
 
+/* format into a log message instead of committing it directly */
+void kvprintf(struct klog_msg_t *msg, char *fmt, va_list argl);
+void kmsg_printf(struct klog_msg_t *msg, char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
 #endif // KPRINTF_H
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef MMAP_H
+#define MMAP_H
+
+#include <stdint.h>
+
+/*
+Memory mappings of the processes (mmap syscall).
+
+Every process has a window of MMAP_WINDOW_MB MiB at MMAP_VADDR,
+mapped by its own L2 tables. mmap() only reserves a range of the
+window; the pages are entered on the first access, from the data
+abort handler (mmap_fault()).
+
+- File mappings map the pages of the tmpfs file itself, so all
+  processes which map a file share its pages, and they see the
+  writes of write() at once (and vice versa). Accesses behind the
+  end of the file fault.
+- Anonymous mappings get private pages filled with zeros.
+
+The flags are also used by the syscalls of user/sys.h.
+*/
+
+#define MMAP_VADDR          0x30000000
+#define MMAP_WINDOW_MB      4
+
+/* flags of mmap() */
+#define PROT_READ           0x1
+#define PROT_WRITE          0x2
+#define MAP_ANONYMOUS       0x4     // no file; fd and offset are ignored
+
+#define MAP_FAILED          ((void *) 0)
+
+/* maps len bytes of the file fd, starting at offset (a multiple of
+the page size), or an anonymous region into the process proc.
+Returns the address or MAP_FAILED */
+void * mmap_create(uint32_t proc, int32_t fd, uint32_t offset, uint32_t len, uint32_t flags);
+
+/* results of mmap_remove() */
+#define MMAP_ERR_NOENT      1       // no region starts at addr
+#define MMAP_ERR_BUSY       2       // a ring or a pending ring read uses it
+
+/* removes the region which starts at addr; returns 0 or an
+MMAP_ERR_* code */
+uint8_t mmap_remove(uint32_t proc, uint32_t addr);
+
+/* removes all regions of proc */
+void mmap_release(uint32_t proc);
+
+/* L2 table of the i-th MiB of the window of proc */
+uint32_t * mmap_table(uint32_t proc, uint32_t i);
+
+/* handles a translation fault at addr in address space proc;
+returns 1 if the page was populated and the access can be repeated */
+uint8_t mmap_fault(uint32_t proc, uint32_t addr);
+
+#endif // MMAP_H
\ No newline at end of file
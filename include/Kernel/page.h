@@ -0,0 +1,39 @@
+#ifndef PAGE_H
+#define PAGE_H
+
+#include <stdint.h>
+
+/*
+Allocator for physical 4 KiB pages.
+
+It manages the RAM behind the address spaces of the processes (one
+1 MiB window per L2 table, see kernel/thread.c) up to the end of RAM.
+The kernel reaches these pages through the identity mapping; users
+only see pages that are mapped into their L2 tables.
+
+A bitmap marks used pages. Searches start behind the last allocation
+(next fit), so consecutive allocations tend to be contiguous.
+Allocation and free disable interrupts while they run, so they can be
+used from interrupt handlers (e.g. through kmalloc()).
+*/
+
+#define PAGE_SIZE       0x1000
+#define PAGE_SHIFT      12
+
+void page_init(void);
+
+/* returns the physical address of a free page or 0 */
+uint32_t page_alloc(void);
+
+/* allocates want contiguous pages, or the longest free run if there
+is no run of want pages; returns the address of the first one and
+their number in got, or 0 if no page is free */
+uint32_t page_alloc_run(uint32_t want, uint32_t *got);
+
+/* frees n contiguous pages starting at phys */
+void page_free(uint32_t phys, uint32_t n);
+
+/* number of free pages */
+uint32_t page_free_count(void);
+
+#endif // PAGE_H
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+#include <arch/cpu/arm.h>
+
+/*
+Sampling profiler
+
+A spare channel of the system timer interrupts the CPU at a fixed
+rate. Each interrupt records the interrupted PC, the lr of the
+interrupted mode, the mode and the running thread. prof_dump()
+prints the samples over the console; tools/prof2folded.py symbolizes
+them against build/kernel.elf and writes folded stacks for flame
+graphs.
+*/
+
+#define PROF_TIMER          1       // channels 0 and 2 belong to the GPU
+#define PROF_BUF_SIZE       4096    // samples
+#define PROF_DEFAULT_HZ     1000
+#define PROF_MAX_HZ         10000
+
+struct prof_sample_t {
+    uint32_t pc;
+    uint32_t lr;        // lr of the interrupted mode: approximates the caller
+    uint16_t tid;       // TRACE_IDLE_TID while idle
+    uint8_t mode;       // PSR mode bits of the interrupted context
+    uint8_t reserved;
+};
+
+/* starts sampling with hz samples per second (0: PROF_DEFAULT_HZ);
+the buffer is cleared */
+void prof_start(uint32_t hz);
+void prof_stop(void);
+void prof_dump(void);
+
+#endif // PROF_H
\ No newline at end of file
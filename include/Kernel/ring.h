@@ -0,0 +1,96 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+#include <lib/time.h>
+
+/*
+Asynchronous syscall interface with a submission and a completion
+ring in user memory (like io_uring).
+
+A thread registers a struct ring_t of its own memory with
+ring_setup(). It fills submission entries and advances sq_tail, then
+calls ring_enter(): the kernel consumes all new entries with one trap
+and posts a completion for each of them, at once (write) or later
+(read, sleep). The thread reaps completions by advancing cq_head; no
+syscall is needed as long as it does not want to wait.
+
+ring_enter(min_complete) blocks until at least min_complete
+completions are unreaped. It returns the number of consumed
+submissions. The kernel consumes a submission only if its completion
+fits into the completion ring, so completions are never lost.
+
+head and tail are free-running counters; the index of an entry is
+counter % RING_ENTRIES.
+*/
+
+#define RING_ENTRIES        16  // power of two
+#define RING_MAX_PENDING    8   // operations of one ring which wait for an event
+
+/* operations */
+#define RING_OP_NOP     0
+#define RING_OP_WRITE   1   // writes len chars at addr to the console; res: len
+#define RING_OP_READ    2   // reads 1 to len chars from the console to addr; res: number of chars
+#define RING_OP_SLEEP   3   // completes after arg milliseconds; res: 0
+#define RING_OP_MSG     4   // posts a completion into the ring of thread arg; res: 0
+
+/* res of failed operations */
+#define RING_ERR_INVAL  (-1)    // unknown operation or bad buffer
+#define RING_ERR_NOENT  (-2)    // message target has no ring
+#define RING_ERR_AGAIN  (-3)    // message target ring is full
+
+struct ring_sqe_t {
+    uint32_t op;
+    uint32_t arg;
+    uint32_t addr;
+    uint32_t len;       // RING_OP_MSG: value handed to the receiver
+    uint32_t user_data; // copied into the completion
+};
+
+/* a received message has op RING_OP_MSG, user_data = the value and
+res = id of the sending thread */
+struct ring_cqe_t {
+    uint32_t user_data;
+    int32_t res;
+    uint32_t op;
+};
+
+struct ring_t {
+    volatile uint32_t sq_head;  // written by the kernel
+    volatile uint32_t sq_tail;  // written by the user
+    volatile uint32_t cq_head;  // written by the user
+    volatile uint32_t cq_tail;  // written by the kernel
+    struct ring_sqe_t sq[RING_ENTRIES];
+    struct ring_cqe_t cq[RING_ENTRIES];
+};
+
+/* kernel interface, used by kernel/thread.c. The ring and all buffers
+are accessed through their physical addresses, so completions can be
+posted while another process runs. */
+
+/* registers the ring at physical address ring for thread tid;
+returns 0 on success and 1 if the thread already has a ring */
+uint8_t kring_setup(uint16_t tid, struct ring_t *ring);
+
+/* drops the ring of a terminated thread with its pending operations */
+void kring_release(uint16_t tid);
+
+/* returns 1 if a ring or the buffer of a pending read lies in the
+page at phys; such a page must not be freed */
+uint8_t kring_uses_page(uint32_t phys);
+
+/* consumes the new submissions of the ring of tid; returns their number */
+uint32_t kring_submit(uint16_t tid, time_t now);
+
+/* returns 1 if the ring of tid has at least min_complete unreaped
+completions; otherwise remembers that tid waits for them and returns 0 */
+uint8_t kring_wait(uint16_t tid, uint32_t min_complete);
+
+/* event sources: console input and time */
+void kring_uart_rx(void);
+void kring_timer(time_t now);
+
+/* time until the next sleep operation ends, at most max */
+time_t kring_next_timeout(time_t now, time_t max);
+
+#endif // RING_H
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef RUSAGE_H
+#define RUSAGE_H
+
+#include <stdint.h>
+#include <lib/time.h>
+
+/* resource usage of a thread, see getrusage() in user/sys.h */
+
+#define RUSAGE_SELF     -1
+
+struct rusage_t {
+    time_t created_at;      // system time of thread creation (us)
+    time_t cpu_time;        // time on the CPU (us)
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t l1i_refills;
+    uint64_t l1d_refills;
+    uint64_t l1d_accesses;
+    uint32_t n_switches;    // number of times the thread was switched in
+    uint32_t deadline_misses;   // deadline class only: late or throttled jobs
+};
+
+#endif // RUSAGE_H
@@ -0,0 +1,195 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include <lib/time.h>
+#include <lib/rbtree.h>
+
+/*
+Scheduling core: runqueue, sleepqueue and the choice of the next
+thread. It knows nothing about contexts, timers or the MMU, so the
+same code runs in the kernel (kernel/thread.c) and in the host
+simulator (tools/schedsim).
+
+Ordinary threads belong to the fair class (SCHED_FAIR, the default):
+every thread has a virtual runtime, its CPU time scaled by the weight
+of its nice level, and the thread with the smallest one runs. Threads
+are grouped, in the kernel one group per process: the groups have a
+virtual runtime of their own and the group with the smallest one is
+chosen first, so every process gets the same share no matter how many
+threads it has. Both levels are red-black trees sorted by virtual
+runtime. A thread or group that wakes up is placed at most
+SCHED_FAIR_WAKEUP_BONUS behind the smallest virtual runtime of its
+tree, so it runs soon but can not claim the time it slept.
+
+Without SCHED_FAIR ordinary threads form a ring which includes the
+running one and are scheduled round robin (the tools/schedsim
+baseline). Threads of the deadline class (EDF) are kept in a list
+sorted by absolute deadline and always run ahead of ordinary threads.
+The sleepqueue is sorted by wake-up time.
+
+Timer slack: an ordinary thread may wake up to slack us after its
+wake-up time. The timer is programmed for the earliest wake_at + slack
+of all sleepers, and every sleeper whose wake_at has passed by then
+wakes up with it, so wake-ups inside the combined window share one
+timer interrupt. Deadline threads always wake up exactly.
+*/
+
+enum thread_state_t {READY, RUNNING, WAITING, TERMINATED};
+
+/* bits of sched_policy */
+#define SCHED_INSERT_TAIL   (1 << 0)    // ready threads queue up behind all others instead of running next
+#define SCHED_TIMER_WAKEUP  (1 << 1)    // program the timer for the next wakeup even if threads are ready
+#define SCHED_FAIR          (1 << 2)    // fair class instead of the round robin ring; set before threads are added
+
+#define SCHED_POLICY_DEFAULT SCHED_FAIR
+
+/* fair class */
+#define SCHED_NICE_MIN          -20
+#define SCHED_NICE_MAX          19
+#define SCHED_NICE0_WEIGHT      1024    // weight of nice 0 and of every group
+#define SCHED_FAIR_LATENCY      20000   // us in which every ready thread should run once
+#define SCHED_FAIR_MIN_SLICE    1000    // us, lower bound of SCHED_FAIR_LATENCY / ready threads
+#define SCHED_FAIR_WAKEUP_BONUS (SCHED_FAIR_LATENCY / 2)
+
+/* admission control: the densities (runtime/deadline) of all deadline
+threads must not exceed SCHED_DL_MAX_DENSITY/SCHED_DL_SCALE. The rest
+is left to the kernel and ordinary threads. */
+#define SCHED_DL_SHIFT          20
+#define SCHED_DL_SCALE          (1 << SCHED_DL_SHIFT)
+#define SCHED_DL_MAX_DENSITY    (SCHED_DL_SCALE / 100 * 95)
+
+#define SCHED_SLACK_MAX         1000000 // us
+
+/* parameters and state of a deadline thread; all times in us */
+struct sched_dl_t {
+    uint8_t active;
+    time_t runtime;         // budget per period
+    time_t period;
+    time_t deadline;        // relative to the start of a period
+    time_t period_start;    // of the current job
+    time_t abs_deadline;    // of the current job
+    time_t used;            // runtime consumed by the current job
+    uint32_t density;       // runtime/deadline in units of 1/SCHED_DL_SCALE
+};
+
+/* a thread or a group in a tree of the fair class; the key of rb is
+the virtual runtime while it is queued */
+struct sched_entity_t {
+    struct rb_node_t rb;
+    time_t vruntime;
+    uint32_t weight;
+};
+
+/* threads which share the CPU time of one entity (a process) */
+struct sched_group_t {
+    struct sched_entity_t se;   // in the tree of the groups while threads are queued
+    struct rb_tree_t threads;   // ready and running threads
+    uint32_t nr_queued;
+    time_t min_vruntime;        // monotonic lower bound of the threads
+};
+
+struct sched_fair_t {
+    struct sched_entity_t se;
+    int32_t nice;
+    struct sched_group_t *group;
+};
+
+struct sched_node_t {
+    volatile struct sched_node_t *prev;
+    volatile struct sched_node_t *next;
+    volatile struct sched_node_t *next_sleeping;
+    enum thread_state_t state;
+    time_t wake_at;
+    time_t slack;           // us the wake-up may be delayed to share a timer interrupt
+    struct sched_dl_t dl;
+    struct sched_fair_t fair;
+};
+
+#define NO_NODE     ((volatile struct sched_node_t *) 0)
+
+extern uint32_t sched_policy;
+
+/* called for every thread sched_wake makes ready */
+typedef void (*sched_wake_hook_t)(volatile struct sched_node_t *node, time_t now);
+
+void sched_init(void);
+
+/* running thread, NO_NODE if idle or the running thread left the runqueue */
+volatile struct sched_node_t * sched_current(void);
+
+/* puts a thread on the runqueue; its position depends on its class
+and sched_policy */
+void sched_add_ready(volatile struct sched_node_t *node);
+
+/* takes a thread off the runqueue (sleeping, waiting, terminated) */
+void sched_remove(volatile struct sched_node_t *node);
+
+/* prepares a group for a new process (no thread of it is queued) */
+void sched_group_init(struct sched_group_t *group);
+
+/* puts a thread which is not queued into a group (0: the default
+group) with virtual runtime 0 and nice 0 */
+void sched_set_group(volatile struct sched_node_t *node, struct sched_group_t *group);
+
+/* sets the nice level (weight) of a thread of the fair class;
+returns 1 if nice is out of range */
+uint8_t sched_set_nice(volatile struct sched_node_t *node, int32_t nice);
+
+/* the current thread gives way: in the fair class it goes behind the
+other threads of its group, the ring moves on in sched_pick_next anyway */
+void sched_yield(void);
+
+/* makes the next ready thread the current one and returns it;
+NO_NODE if no thread is ready */
+volatile struct sched_node_t * sched_pick_next(void);
+
+/* puts a thread on the runqueue and makes it current at once */
+void sched_switch_to(volatile struct sched_node_t *node);
+
+/* moves a thread from the runqueue to the sleepqueue */
+void sched_sleep(volatile struct sched_node_t *node, time_t wake_at);
+
+/* makes all threads ready whose wake-up time has passed */
+void sched_wake(time_t now, sched_wake_hook_t hook);
+
+/* latest time the timer may fire without waking a sleeper later than
+its slack allows; 0 if no thread sleeps */
+time_t sched_next_wakeup(void);
+
+/* returns the time until the scheduler has to run again */
+time_t sched_timer_interval(time_t now, time_t tick);
+
+/* charges the time since the last call to the current thread; has to
+be called before the current thread changes */
+void sched_account(time_t now);
+
+/*
+Moves a thread into the deadline class (runtime > 0) or back into the
+ordinary class (runtime = 0). The first period starts at now. A thread
+which is on the runqueue changes its queue; if it is current it stays
+current until the next sched_pick_next.
+returns 0 on success, 1 if the parameters are invalid or the thread set
+would not be schedulable any more
+*/
+uint8_t sched_setdeadline(volatile struct sched_node_t *node, time_t runtime, time_t period,
+    time_t deadline, time_t now);
+
+/* releases the reservation of a deadline thread (before termination) */
+void sched_release(volatile struct sched_node_t *node);
+
+/*
+Ends the current job of a deadline thread: the thread sleeps until its
+next period starts.
+returns the lateness of the finished job in us (0: deadline met)
+*/
+time_t sched_next_period(volatile struct sched_node_t *node, time_t now);
+
+/*
+Throttles the current thread if it is a deadline thread which used up
+its runtime: the rest of its job is moved to the next period.
+returns the throttled thread or NO_NODE
+*/
+volatile struct sched_node_t * sched_throttle(time_t now);
+
+#endif // SCHED_H
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef SCHEDSTAT_H
+#define SCHEDSTAT_H
+
+#include <stdint.h>
+#include <lib/time.h>
+
+/*
+Scheduler latency statistics, see sched_stats() in user/sys.h.
+
+Every thread and the whole system have three histograms:
+- runq_wait: from becoming ready (woken, created, preempted) until
+  the thread is on the CPU
+- wake_late: sleepers only; from wake_at until the thread is ready
+- slice: time on the CPU from switch in to switch out
+The system wide statistics also have
+- irq_late: from the compare match of a system timer until its
+  interrupt handler runs (timer_intr_h)
+
+Buckets are powers of two: bucket 0 counts values below 2 us, bucket
+i values from 2^i to 2^(i+1)-1 us, the last one everything above.
+*/
+
+#define SCHEDSTAT_BUCKETS   24      // the last one starts at 8.4 s
+#define SCHEDSTAT_SELF      -1
+#define SCHEDSTAT_ALL       -2      // system wide statistics
+#define SCHEDSTAT_RESET     -3      // like SCHEDSTAT_ALL, then clears the system wide histograms
+
+/* load averages (1, 5 and 15 minutes) of the ready and running
+threads are fixed point numbers with LOADAVG_SHIFT fraction bits */
+#define LOADAVG_SHIFT       11
+#define LOADAVG_INTERVAL    5000000 // us between two samples
+
+struct lat_hist_t {
+    uint32_t count;
+    uint32_t avg_us;        // filled in by sched_stats()
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[SCHEDSTAT_BUCKETS];
+};
+
+struct schedstat_t {
+    struct lat_hist_t runq_wait;
+    struct lat_hist_t wake_late;
+    struct lat_hist_t slice;
+    /* system wide statistics only */
+    struct lat_hist_t irq_late;
+    uint32_t nr_running;        // ready and running threads at the last tick
+    uint32_t nr_running_max;
+    uint32_t loadavg[3];
+};
+
+/* record a value in the statistics of a thread and the system wide ones */
+void schedstat_wait(struct schedstat_t *thread, time_t us);
+void schedstat_wakeup(struct schedstat_t *thread, time_t us);
+void schedstat_slice(struct schedstat_t *thread, time_t us);
+
+/* records the interrupt latency of a timer (system wide only) */
+void schedstat_irq(uint32_t us);
+
+/* clears the system wide histograms and the maximum of nr_running */
+void schedstat_reset(void);
+
+/* samples the number of ready and running threads */
+void schedstat_tick(time_t now, uint32_t nr_running);
+
+/* copies src (0: the system wide statistics) to dst for the user */
+void schedstat_export(struct schedstat_t *dst, const struct schedstat_t *src);
+
+#endif // SCHEDSTAT_H
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdint.h>
+
+/*
+Allocator for kernel objects.
+
+A cache hands out objects of one size. It takes whole pages from the
+page allocator (slabs) and cuts them into objects; the slab header
+sits at the start of the page, so kmem_cache_free() finds the slab of
+an object by masking its address. Allocation and free are O(1): the
+slabs with free objects are kept in a list, the free objects of a slab
+in a list through their first word. A slab which gets empty is given
+back to the page allocator, unless it is the only empty one of its
+cache.
+
+Caches are static objects, initialized with KMEM_CACHE(); they are
+set up on their first allocation. kmalloc() picks a cache by size
+class; larger blocks get their own pages.
+
+All functions disable interrupts while they run, so they can be used
+from syscalls, softirqs and interrupt handlers. Objects are 8 byte
+aligned.
+*/
+
+struct slab_t;
+
+struct kmem_cache_t {
+    const char *name;
+    uint32_t size;              // object size, a multiple of 8
+    uint32_t per_slab;          // objects per slab; 0 until the first allocation
+    struct slab_t *partial;     // slabs with free objects
+    struct slab_t *full;
+    uint32_t empty_slabs;
+    struct kmem_cache_t *next;  // all caches, for the statistics
+    /* statistics */
+    uint32_t slabs;
+    uint32_t in_use;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;          // no page for a new slab
+};
+
+#define KMEM_CACHE(name, size) \
+    { (name), (((size) + 7) & ~7), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+
+#define KMALLOC_MIN         16
+#define KMALLOC_MAX         2048    // larger blocks are whole pages
+#define KMALLOC_CLASSES     8       // 16, 32, ..., 2048
+
+/* returns an object of the cache or 0 */
+void * kmem_cache_alloc(struct kmem_cache_t *cache);
+void kmem_cache_free(struct kmem_cache_t *cache, void *obj);
+
+/* returns a block of at least size bytes or 0 */
+void * kmalloc(uint32_t size);
+
+/* like kmalloc(), the block is filled with zeros */
+void * kzalloc(uint32_t size);
+
+/* frees a block of kmalloc(); ptr may be 0 */
+void kfree(void *ptr);
+
+/* writes the statistics of all caches to the kernel log */
+void kmem_print_stats(void);
+
+#endif // SLAB_H
\ No newline at end of file
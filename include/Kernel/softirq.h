@@ -0,0 +1,48 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <stdint.h>
+#include <arch/cpu/arm.h>
+
+/*
+Bottom halves of the interrupt handlers.
+
+An interrupt handler (top half) only acknowledges the device, saves
+what can not wait (e.g. the received char) and raises a softirq. The
+softirqs run in irq_exit() at the end of the IRQ, in SVC mode and
+with interrupts enabled, so a second interrupt is not delayed by the
+work of the first one. A top half which interrupts a softirq only
+raises its softirq; the running irq_exit() picks it up.
+
+Softirqs never interrupt each other. They may interrupt a preemptible
+syscall (see kernel/syscalls.h), which uses the scheduler queues only
+with interrupts disabled, so softirqs may use them as well. They must
+not touch the registers of the interrupted context: a thread switch
+is requested with softirq_resched() and done by irq_exit() once all
+softirqs are finished.
+*/
+
+#define SOFTIRQ_TIMER       0   // scheduler tick: timepage, wakeups
+#define SOFTIRQ_UART_RX     1   // hands received chars to the waiting thread
+#define SOFTIRQ_KLOG        2   // feeds the UART with the kernel log
+#define SOFTIRQ_DMA         3   // callbacks of finished DMA copies
+#define N_SOFTIRQS          4
+
+/* sets the handler of softirq nr */
+void softirq_register(uint32_t nr, void (*handler)(void));
+
+/* marks softirq nr pending; callable from any context */
+void raise_softirq(uint32_t nr);
+
+/* requests a call of the scheduler at the end of the IRQ */
+void softirq_resched(void);
+
+/* called at the end of every IRQ; runs the pending softirqs and the
+scheduler if requested */
+void irq_exit(void);
+
+/* runs the scheduler if a switch was requested and no softirq is
+running; called with interrupts disabled at the end of syscalls */
+void resched_check(void);
+
+#endif // SOFTIRQ_H
\ No newline at end of file
@@ -9,8 +9,48 @@
 #define SYS_SLEEP           2
 #define SYS_READ_CHAR       3
 #define SYS_WRITE_CHAR      4
-#define N_SYSCALL_CODES 5
+#define SYS_TRACE_MARK      5
+#define SYS_TRACE_CTL       6
+#define SYS_GETRUSAGE       7
+#define SYS_YIELD           8
+#define SYS_SHUTDOWN        9
+#define SYS_PROF_CTL        10
+#define SYS_SET_DEADLINE    11
+#define SYS_NEXT_PERIOD     12
+#define SYS_RING_SETUP      13
+#define SYS_RING_ENTER      14
+#define SYS_SPAWN           15
+#define SYS_OPEN            16
+#define SYS_READ            17
+#define SYS_WRITE           18
+#define SYS_CLOSE           19
+#define SYS_UNLINK          20
+#define SYS_MMAP            21
+#define SYS_MUNMAP          22
+#define SYS_BLOCK_IO        23
+#define SYS_SCHED_STATS     24
+#define SYS_SLEEP_UNTIL     25
+#define SYS_SET_TIMER_SLACK 26
+#define SYS_SET_NICE        27
+#define N_SYSCALL_CODES 28
 
+/* operations of SYS_TRACE_CTL */
+#define TRACE_CTL_STOP      0
+#define TRACE_CTL_START     1
+#define TRACE_CTL_DUMP      2
+
+/* operations of SYS_PROF_CTL */
+#define PROF_CTL_STOP       0
+#define PROF_CTL_START      1   // argument: samples per second
+#define PROF_CTL_DUMP       2
+#define PROF_CTL_PMU_USER   3   // user mode may use the PMU; init process only
+
+/* runs the syscall svc_code for the current thread. Short syscalls
+run with interrupts disabled. Long ones (file and block I/O, spawn,
+dumps, ...) are preemptible: they hold the kernel lock (see
+kernel/thread.h) and run with interrupts enabled, so interrupts and
+other threads are not delayed by them.
+returns 1 if the syscall does not exist */
 uint8_t process_svc_code(uint32_t svc_code, struct registers_t *reg);
 
 #endif // SYSCALLS_H
\ No newline at end of file
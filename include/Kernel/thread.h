@@ -3,28 +3,135 @@
 
 #include <stdint.h>
 #include <arch/cpu/arm.h>
+#include <kernel/rusage.h>
+#include <kernel/schedstat.h>
 
 #define SCHEDULER_TIMER 3
+#define MAX_THREADS     32  // also the number of address spaces
+
+/* ASID of the process with L2 table i (0 is the kernel's) */
+#define PROC_ASID(L2_table_i)   ((uint8_t) ((L2_table_i) + 1))
+
+/*
+Every thread has its own kernel stack. Syscalls, IRQs and data aborts
+save the interrupted context there (struct trap_frame_t), so a thread
+can block or be preempted in the middle of a syscall and continues
+where it stopped; scheduler() switches kernel stacks. The idle loop
+uses the boot stack.
+
+The functions which block the current thread are called by syscalls
+which run with interrupts disabled (see kernel/syscalls.h); they
+return once the thread runs again.
+*/
 
 void init_threads(void);
-void kthread_create(struct registers_t *reg, void(*func)(void*), const void *args, uint32_t args_size, 
+void kthread_create(void(*func)(void*), const void *args, uint32_t args_size, 
     uint8_t is_proc // whether the new thread shall open a new address space
     );
-void terminate_current_thread(struct registers_t *reg);
+
+/* ends the current thread; called with the kernel lock held */
+void terminate_current_thread(void);
+
+/* starts the program path of the tmpfs in a new process (see
+kernel/exec.h). path and args are user pointers of the current thread
+and are checked first. Returns the id of its thread or -1 */
+int32_t thread_spawn(const char *path, const void *args, uint32_t args_size);
+
+/* address space (process) of the current thread */
+uint32_t thread_current_proc(void);
+
+/* whether the current thread belongs to the process started at boot
+(user/main.c or the main of a test image) */
+uint8_t thread_in_init(void);
+
+/* called on translation faults; returns 1 if the page was populated
+and the access can be repeated */
+uint8_t thread_page_fault(uint32_t addr);
 void start_scheduling(void);
 
 /* thread_received_char is called, when ta thread needs
-to wair for  a character 
-returns 0 if thread is waiting
+to wair for  a character; it is written to c
+returns 0 after the char was received
 returns 1 if uart device is busy */
-uint8_t thread_wait_for_char(struct registers_t * reg);
-
-/* thread_received_char is called, when the uart device 
-receives a character */
-void thread_process_char_received(struct registers_t * reg);
+uint8_t thread_wait_for_char(char *c);
 
 /* sends the current thread to sleep for the given amount
 of milliseconds*/
-void thread_make_sleep_current(struct registers_t * reg, uint32_t millis);
+void thread_make_sleep_current(uint32_t millis);
+
+/* sends the current thread to sleep until the time wake_at (us since
+boot); returns at once if it has passed */
+void thread_sleep_until(time_t wake_at);
+
+/* gives the CPU to the next ready thread */
+void thread_yield(void);
+
+/* sets the timer slack of the current thread (see kernel/sched.h).
+Returns 0, or 1 if slack_us is above SCHED_SLACK_MAX */
+uint8_t thread_set_timer_slack(uint32_t slack_us);
+
+/* sets the nice level of the current thread (see kernel/sched.h).
+Returns 0, or 1 if nice is out of SCHED_NICE_MIN..SCHED_NICE_MAX */
+uint8_t thread_set_nice(int32_t nice);
+
+/* moves the current thread into the deadline class (runtime > 0) or
+back into the ordinary class (runtime = 0); see kernel/sched.h.
+Returns 0 (accepted) or 1 (rejected) */
+uint8_t thread_setdeadline(uint32_t runtime_us, uint32_t period_us, uint32_t deadline_us);
+
+/* ends the job of the current deadline thread; it sleeps until its
+next period. Returns 1 if the thread is no deadline thread */
+uint8_t thread_next_period(void);
+
+/* registers the ring at ring_vaddr (see kernel/ring.h) for the current
+thread. Returns 0 on success and 1 on failure */
+uint8_t thread_ring_setup(uint32_t ring_vaddr);
+
+/* submits the new entries of the ring of the current thread and blocks
+until min_complete completions are unreaped. Returns the number of
+consumed submissions */
+uint32_t thread_ring_enter(uint32_t min_complete);
+
+/* makes a thread which blocks in thread_ring_enter() ready again */
+void thread_ring_wakeup(uint16_t tid);
+
+/*
+Checks of user pointers, before the kernel uses them. A buffer must
+lie in the windows of the process (user RAM, program, mmap; the user
+text for reading) and user mode must be allowed to access it. Pages
+which are populated on demand are populated by the check, so the
+kernel does not fault on them.
+*/
+
+/* returns 1 if the current thread may access [buf, buf+len) (with
+write: write to it); always for len 0 */
+uint8_t thread_user_access(const void *buf, uint32_t len, uint8_t write);
+
+/* returns 1 if the current thread may read the string str up to its
+terminating 0 or up to max chars, whatever comes first */
+uint8_t thread_user_string(const char *str, uint32_t max);
+
+/* returns the physical address of the buffer [vaddr, vaddr+len) in the
+address space of thread tid; 0 if the thread may not access it or it
+is not contiguous in physical memory */
+uint32_t thread_user_to_phys(uint16_t tid, uint32_t vaddr, uint32_t len, uint8_t write);
+
+/* copies the resource usage of thread tid (or RUSAGE_SELF) to usage
+returns 0 on success, 1 if the thread does not exist */
+uint8_t thread_getrusage(int32_t tid, struct rusage_t *usage);
+
+/* copies the scheduler statistics of thread tid, SCHEDSTAT_SELF or
+SCHEDSTAT_ALL to stats; returns 0 on success, 1 if the thread does
+not exist */
+uint8_t thread_schedstat(int32_t tid, struct schedstat_t *stats);
+
+/* The kernel lock serializes the preemptible syscalls and the page
+faults: they use the tmpfs, the page allocator, the process tables,
+the block layer and other state which the kernel does not protect
+otherwise. A thread which holds it may be preempted, but must not
+block; the lock can be taken again by its owner. Other threads block
+in kernel_lock() until it is free. No-ops in the idle loop */
+void kernel_lock(void);
+void kernel_unlock(void);
 
 #endif // THREAD_H
\ No newline at end of file
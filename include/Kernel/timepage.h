@@ -0,0 +1,53 @@
+#ifndef TIMEPAGE_H
+#define TIMEPAGE_H
+
+#include <stdint.h>
+#include <lib/time.h>
+#include <arch/bsp/mmu.h>
+
+/*
+The time page is a read-only page which is mapped into every process.
+At boot the kernel stores the system timer together with the value of
+the generic timer (CNTVCT) at the same moment. User code extrapolates
+the current time from CNTVCT and never needs to enter the kernel.
+Later updates only advance the base along CNTVCT, so the time of user
+code is monotonic; it does not follow the system timer again (both
+run from the same oscillator). Without CNTVCT the time page holds the
+system timer of the last tick.
+
+Readers have to retry as long as seq is odd or changes during the read.
+*/
+
+/* last page of the user window; stacks start one page below */
+#define TIME_PAGE_L2_INDEX  (L2_SIZE-1)
+#define TIME_SHIFT          24
+
+extern uint32_t _ram_user_start;
+#define TIME_PAGE_VADDR     (LINKER2VAL(_ram_user_start) + TIME_PAGE_L2_INDEX*L2_PAGE_SIZE)
+
+struct time_page_t {
+    volatile uint32_t seq;
+    uint32_t cnt_valid;     // 0 if CNTVCT can not be used (tick resolution only)
+    time_t base_us;         // time at base_cnt
+    uint64_t base_cnt;      // CNTVCT at the last update (0 without CNTVCT)
+    uint32_t mult;          // us = (cnt * mult) >> TIME_SHIFT
+    uint32_t cnt_freq;      // CNTFRQ in Hz
+};
+
+/* reads the virtual count of the generic timer; accessible from
+PL0 once the kernel has set CNTKCTL.PL0VCTEN */
+static inline uint64_t read_cntvct(void)
+{
+    uint64_t cnt;
+    asm volatile("isb");
+    asm volatile("mrrc p15, 1, %Q0, %R0, c14" : "=r" (cnt));
+    return cnt;
+}
+
+void timepage_init(void);
+void timepage_update(void);
+
+/* maps the time page read-only into the given L2 table */
+void timepage_map(uint32_t *L2_table);
+
+#endif // TIMEPAGE_H
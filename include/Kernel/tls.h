@@ -0,0 +1,35 @@
+#ifndef TLS_H
+#define TLS_H
+
+#include <stdint.h>
+
+/*
+Thread-local storage block. kthread_create() puts one at the top of
+the stack of every thread and the kernel loads its (virtual) address
+into TPIDRURO on every switch to the thread. TPIDRURO is readable but
+not writable from PL0, so user code finds its block with a single MRC
+and can not redirect it.
+
+The block has a fixed layout; compiler generated TLS (__thread) is not
+supported because the image has no .tdata/.tbss sections.
+*/
+
+#define TLS_N_SLOTS     8
+
+struct tls_t {
+    uint32_t tid;       // thread id, as in trace and rusage
+    uint32_t pid;       // address space of the thread
+    int32_t error;      // last error of a user library call (errno)
+    uint32_t reserved;
+    void *slots[TLS_N_SLOTS];   // free for user libraries, e.g. allocator caches
+};
+
+/* returns the thread pointer (TPIDRURO) */
+static inline uint32_t read_tpidruro(void)
+{
+    uint32_t tp;
+    asm volatile("mrc p15, 0, %0, c13, c0, 3" : "=r" (tp));
+    return tp;
+}
+
+#endif // TLS_H
\ No newline at end of file
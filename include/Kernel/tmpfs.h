@@ -0,0 +1,70 @@
+#ifndef TMPFS_H
+#define TMPFS_H
+
+#include <stdint.h>
+
+/*
+RAM filesystem. There are no directories: a name like "bin/hello" is
+just a name with a slash; leading slashes are ignored.
+
+The data of a file is kept in extents, runs of contiguous pages of
+the page allocator (kernel/page.h). A growing file asks for all the
+pages it needs at once, and an extent which ends where the new run
+begins is extended, so most files consist of one or two extents and
+reads and writes copy whole runs.
+
+Inodes are counted: an unlinked file keeps its pages until the last
+reference is dropped.
+*/
+
+#define TMPFS_MAX_FILES     32
+#define TMPFS_NAME_MAX      32      // including the terminating 0
+#define TMPFS_MAX_EXTENTS   8
+
+/* creates the filesystem and copies the files of the initramfs
+(kernel/initramfs.h) into it */
+void tmpfs_init(void);
+
+/* returns the inode of name or -1 */
+int32_t tmpfs_lookup(const char *name);
+
+/* creates an empty file; returns its inode, FILE_ERR_NOSPC if no inode
+is free or FILE_ERR_INVAL if the name is too long or empty. The file
+must not exist */
+int32_t tmpfs_create(const char *name);
+
+/* removes name; returns 0 or FILE_ERR_NOENT */
+int32_t tmpfs_unlink(const char *name);
+
+/* reference counting of inodes */
+void tmpfs_get(uint32_t ino);
+void tmpfs_put(uint32_t ino);
+
+uint32_t tmpfs_size(uint32_t ino);
+
+/* incremented by every change of the content; lets caches notice a
+rewritten file */
+uint32_t tmpfs_version(uint32_t ino);
+
+/* copies up to len bytes from offset into buf; returns their number */
+uint32_t tmpfs_read(uint32_t ino, uint32_t offset, void *buf, uint32_t len);
+
+/* copies len bytes from buf to offset, growing the file (a gap is
+filled with zeros); returns the number of written bytes, which is
+less than len if memory runs out */
+uint32_t tmpfs_write(uint32_t ino, uint32_t offset, const void *buf, uint32_t len);
+
+/* cuts the file to 0 bytes and frees its pages; the pages of a
+pinned file are kept for the following writes */
+void tmpfs_truncate(uint32_t ino);
+
+/* pinned files keep their pages at the same place while they are
+mapped (kernel/mmap.h) */
+void tmpfs_pin(uint32_t ino);
+void tmpfs_unpin(uint32_t ino);
+
+/* physical address of page index of the file; 0 if the page is
+behind the end of the file */
+uint32_t tmpfs_page(uint32_t ino, uint32_t index);
+
+#endif // TMPFS_H
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/*
+Event tracing
+
+Events are written as fixed size binary records into a ring buffer,
+which overwrites the oldest records when full. trace_dump() prints the
+buffer over the console; tools/trace2json.py converts the output into
+the Chrome trace format (chrome://tracing, ui.perfetto.dev).
+*/
+
+#define TRACE_BUF_SIZE  1024    // entries, must be a power of two
+#define TRACE_IDLE_TID  0xFFFF  // tid used while no thread is running
+
+/* event types; keep in sync with tools/trace2json.py */
+#define TRACE_SWITCH_OUT    0   // arg0: next tid
+#define TRACE_SWITCH_IN     1   // arg0: previous tid, arg1: process
+#define TRACE_SYSCALL_ENTRY 2   // arg0: svc code
+#define TRACE_SYSCALL_EXIT  3   // arg0: svc code, arg1: error
+#define TRACE_IRQ_ENTRY     4   // arg0: irq number
+#define TRACE_IRQ_EXIT      5   // arg0: irq number
+#define TRACE_WAKEUP        6   // arg0: lateness in us, arg1: reason
+#define TRACE_USER_MARK     7   // arg0: marker id, arg1: user value
+
+/* wakeup reasons */
+#define TRACE_WAKE_TIMER    0
+#define TRACE_WAKE_UART     1
+#define TRACE_WAKE_RING     2   // completions of ring_enter() arrived
+
+struct trace_entry_t {
+    uint32_t ts;        // lower 32 bit of the system timer (us)
+    uint16_t type;
+    uint16_t tid;
+    uint32_t arg0;
+    uint32_t arg1;
+};
+
+void trace_event(uint16_t type, uint16_t tid, uint32_t arg0, uint32_t arg1);
+
+/* records switch out/in events if tid differs from the running thread */
+void trace_switch(uint16_t tid, uint32_t proc);
+
+/* returns tid of the thread that was switched in last */
+uint16_t trace_current_tid(void);
+
+void trace_enable(uint8_t enable);
+void trace_dump(void);
+
+#endif // TRACE_H
@@ -0,0 +1,14 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+#include <lib/time.h>
+
+/*
+Returns the time since boot in microseconds. The value is read from
+the time page the kernel maps into every process, so no syscall
+is executed.
+*/
+time_t clock_us(void);
+
+#endif // CLOCK_H
@@ -0,0 +1,18 @@
+#ifndef PRINT_H
+#define PRINT_H
+
+#include <stdint.h>
+
+/*
+Formatted output for user programs; every char is written with the
+write_char syscall.
+Supported conversions: %c %s %u %i %x %%
+    - @input fmt: format string
+    - @input ...: one 32 bit argument per conversion
+*/
+void uprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/* writes a string without formatting */
+void uputs(const char *str);
+
+#endif // PRINT_H
@@ -0,0 +1,111 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdint.h>
+#include <arch/cpu/atomic.h>
+
+/*
+Synchronization for user threads, built on LDREX/STREX (see
+arch/cpu/atomic.h) and DMB. Nothing here needs a syscall as long as
+there is no contention.
+
+Lock and queue functions return 0 on success and 1 if the lock is
+taken or the queue is full/empty, like the syscall wrappers.
+
+The board has a single core: a thread which waits for a lock can
+only make progress if the owner runs. spin_lock() therefore only
+suits very short sections; mutexes and rwlocks spin for a short
+while and then give the CPU away (yield, then sleep with growing
+intervals).
+*/
+
+#define SYNC_SPIN_ROUNDS    64  // busy tries before a waiter yields
+#define SYNC_YIELD_ROUNDS   8   // yields before a waiter sleeps
+#define SYNC_MAX_SLEEP_MS   8   // upper limit of the sleep backoff
+
+/* atomics; the _acq/_rel variants order the surrounding accesses */
+static inline uint32_t atomic_load_acq(volatile uint32_t *ptr)
+{
+    uint32_t value = *ptr;
+    dmb();
+    return value;
+}
+
+static inline void atomic_store_rel(volatile uint32_t *ptr, uint32_t value)
+{
+    dmb();
+    *ptr = value;
+}
+
+static inline uint32_t atomic_inc(volatile uint32_t *ptr)
+{
+    return atomic_add_return(ptr, 1);
+}
+
+static inline uint32_t atomic_dec(volatile uint32_t *ptr)
+{
+    return atomic_add_return(ptr, (uint32_t) -1);
+}
+
+/* waiting strategy of mutexes and rwlocks; round counts the failed
+tries of one waiter and starts at 0 */
+void sync_backoff(uint32_t *round);
+
+/* spinlock: busy waiting only */
+struct spinlock_t {
+    volatile uint32_t locked;
+};
+#define SPINLOCK_INIT   {0}
+
+void spin_lock(struct spinlock_t *lock);
+uint8_t spin_trylock(struct spinlock_t *lock);
+void spin_unlock(struct spinlock_t *lock);
+
+/* adaptive mutex: spins briefly, then backs off with yield and sleep */
+struct mutex_t {
+    volatile uint32_t locked;
+};
+#define MUTEX_INIT      {0}
+
+void mutex_lock(struct mutex_t *mutex);
+uint8_t mutex_trylock(struct mutex_t *mutex);
+void mutex_unlock(struct mutex_t *mutex);
+
+/* reader-writer lock; waiting writers keep new readers out */
+#define RWLOCK_WRITER   (1u << 31)  // a writer holds the lock
+#define RWLOCK_WAITING  (1u << 30)  // a writer waits; lower bits: number of readers
+
+struct rwlock_t {
+    volatile uint32_t state;
+};
+#define RWLOCK_INIT     {0}
+
+void read_lock(struct rwlock_t *lock);
+void read_unlock(struct rwlock_t *lock);
+void write_lock(struct rwlock_t *lock);
+void write_unlock(struct rwlock_t *lock);
+
+/*
+Lock-free bounded queue for any number of producers and consumers.
+Every cell carries a sequence number which tells whether it is free
+for the producer of position pos (seq == pos) or filled for the
+consumer of position pos (seq == pos+1).
+*/
+struct mpmc_cell_t {
+    volatile uint32_t seq;
+    uint32_t value;
+};
+
+struct mpmc_queue_t {
+    struct mpmc_cell_t *cells;
+    uint32_t mask;
+    volatile uint32_t head;     // next position to pop
+    volatile uint32_t tail;     // next position to push
+};
+
+/* size must be a power of two; cells must hold size entries */
+void mpmc_init(struct mpmc_queue_t *queue, struct mpmc_cell_t *cells, uint32_t size);
+uint8_t mpmc_push(struct mpmc_queue_t *queue, uint32_t value);
+uint8_t mpmc_pop(struct mpmc_queue_t *queue, uint32_t *value);
+
+#endif // SYNC_H
\ No newline at end of file
@@ -2,6 +2,12 @@
 #define SYS_H
 
 #include <stdint.h>
+#include <kernel/rusage.h>
+#include <kernel/schedstat.h>
+#include <kernel/ring.h>
+#include <kernel/file.h>
+#include <kernel/mmap.h>
+#include <kernel/block.h>
 
 /*
 This library provides functions to execute system calls.
@@ -35,10 +41,41 @@ the given amount of time
 */
 void sleep(uint32_t millis);
 
+/*
+Sleeps until an absolute point in time. Periodic threads use it
+without accumulating the latency of each wakeup.
+- @input wake_us: time in microseconds since boot (see clock_us());
+    returns at once if it has passed
+*/
+void sleep_until(time_t wake_us);
+
+/*
+Sets the timer slack of the calling thread: sleep() and sleep_until()
+may return up to slack_us later, so the kernel can serve wake-ups
+which are close together with one timer interrupt. Background threads
+trade precision for fewer interrupts. New threads and processes start
+with the slack of their creator; deadline threads ignore it.
+- @input slack_us: 0 (exact wake-ups, the default) up to 1 s
+- @return: 0 on success, 1 if slack_us is too large
+*/
+uint8_t set_timer_slack(uint32_t slack_us);
+
+/*
+Sets the nice level of the calling thread. The CPU time of a process
+is shared by its threads in proportion to their weights; a thread one
+level lower gets about 25 % more than one of the next level. Every
+process gets the same share, independent of its number of threads.
+New threads start with the nice level of their creator.
+- @input nice: -20 (highest weight) up to 19 (lowest), default 0
+- @return: 0 on success, 1 if nice is out of range
+*/
+uint8_t set_nice(int32_t nice);
+
 /* 
 Reads char from serial console in blocking mode.
 - @input char_read: pointer to where the read char shall be stored
-- @return: 0 if charackter was read; 1 if device is busy 
+- @return: 0 if charackter was read; 1 if device is busy or
+    char_read is no writable address of the process
 */
 uint8_t read_char(char* char_read);
 
@@ -48,6 +85,194 @@ Writes the given char to serial console.
 */
 void write_char(char char_write);
 
+/*
+Writes a marker into the kernel trace buffer.
+- @input id: identifies the marker in the trace viewer
+- @input value: arbitrary value stored with the marker
+*/
+void trace_mark(uint32_t id, uint32_t value);
+
+/*
+Controls kernel tracing.
+- @input op: TRACE_CTL_STOP, TRACE_CTL_START or TRACE_CTL_DUMP
+    (see kernel/syscalls.h). DUMP prints the trace buffer on the
+    console, tools/trace2json.py converts it to a Chrome trace.
+*/
+void trace_ctl(uint32_t op);
+
+/*
+Reads CPU time and hardware event counts of a thread.
+- @input tid: id of the thread or RUSAGE_SELF for the calling thread
+- @input usage: pointer to where the values shall be stored
+- @return: 0 on success; 1 if the thread does not exist or usage is
+    no writable buffer of the process
+*/
+uint8_t getrusage(int32_t tid, struct rusage_t *usage);
+
+/*
+Reads the scheduler latency histograms of a thread or of the whole
+system (see kernel/schedstat.h); bin/top shows them.
+- @input tid: id of the thread, SCHEDSTAT_SELF, SCHEDSTAT_ALL or
+    SCHEDSTAT_RESET (system wide, then cleared)
+- @input stats: pointer to where the values shall be stored
+- @return: 0 on success; 1 if the thread does not exist or stats is
+    no writable buffer of the process
+*/
+uint8_t sched_stats(int32_t tid, struct schedstat_t *stats);
+
+/*
+Gives the CPU to the next ready thread. Returns immediately if no
+other thread is ready.
+*/
+void yield(void);
+
+/*
+Stops the system. Under QEMU (started with -no-reboot) this ends
+the emulation. Only threads of the process started at boot may do
+this; for all others the call returns without effect.
+*/
+void shutdown(void);
+
+/*
+Controls the sampling profiler.
+- @input op: PROF_CTL_STOP, PROF_CTL_START, PROF_CTL_DUMP or
+    PROF_CTL_PMU_USER (see kernel/syscalls.h). START clears the sample
+    buffer, DUMP prints it on the console; tools/prof2folded.py turns
+    it into folded stacks. PMU_USER lets user mode read the PMU
+    counters (pmu_read_cycles()) from then on; it also allows writes,
+    so only the process started at boot may do this.
+- @input hz: samples per second for START (0: default rate)
+*/
+void prof_ctl(uint32_t op, uint32_t hz);
+
+/*
+Makes the calling thread a real-time thread of the deadline (EDF)
+class: every period_us it may run for runtime_us and has to finish
+within deadline_us. Deadline threads run ahead of all ordinary
+threads. The call is rejected if runtime <= deadline <= period is
+violated or the deadline threads together would need more than 95 %
+of the CPU. A runtime of 0 makes the thread ordinary again.
+- @return: 0 if accepted, 1 if rejected
+*/
+uint8_t set_deadline(uint32_t runtime_us, uint32_t period_us, uint32_t deadline_us);
+
+/*
+Ends the job of the current period; the thread sleeps until its next
+period starts. A job that finishes late or uses up its runtime counts
+as a deadline miss (see getrusage).
+- @return: 0 on success, 1 if the thread is no deadline thread
+*/
+uint8_t next_period(void);
+
+/*
+Registers a submission/completion ring of the calling thread (see
+kernel/ring.h and user/uring.h). A thread can have one ring; it is
+released when the thread exits.
+- @input ring: ring in memory of the thread, 4 byte aligned
+- @return: 0 on success, 1 if the ring is invalid or no ring is left
+*/
+uint8_t ring_setup(struct ring_t *ring);
+
+/*
+Hands all new submissions of the ring to the kernel and waits until
+at least min_complete completions are in the completion ring.
+- @input min_complete: 0 returns at once
+- @return: number of consumed submissions
+*/
+uint32_t ring_enter(uint32_t min_complete);
+
+/*
+Starts a program (an ELF file of the tmpfs, e.g. from the initramfs)
+in a new process. Its text is
+shared with other processes running the same program.
+- @input path: name of the program, e.g. "bin/hello"
+- @input args: argument handed to main of the program
+- @input args_size: number of bytes of args
+- @return: id of the new thread, -1 on failure
+*/
+int32_t spawn(const char *path, const void *args, uint32_t args_size);
+
+/*
+Opens a file of the tmpfs (see kernel/tmpfs.h). The descriptors
+belong to the process and are closed when its last thread exits.
+- @input path: name of the file, at most 31 chars
+- @input flags: O_RDONLY, O_WRONLY or O_RDWR, combined with O_CREAT,
+    O_TRUNC and O_APPEND (kernel/file.h)
+- @return: descriptor >= 0 or a negative FILE_ERR_* code
+*/
+int32_t open(const char *path, uint32_t flags);
+
+/*
+Reads from the current offset of a descriptor and advances it.
+- @input fd: descriptor opened for reading
+- @input buf: receives the data
+- @input len: maximum number of bytes
+- @return: number of bytes read, 0 at the end of the file, or a
+    negative FILE_ERR_* code
+*/
+int32_t read(int32_t fd, void *buf, uint32_t len);
+
+/*
+Writes at the current offset of a descriptor (at the end with
+O_APPEND) and advances it. The file grows as needed.
+- @input fd: descriptor opened for writing
+- @input buf: data
+- @input len: number of bytes
+- @return: number of bytes written (less than len if memory runs
+    out) or a negative FILE_ERR_* code
+*/
+int32_t write(int32_t fd, const void *buf, uint32_t len);
+
+/*
+Closes a descriptor.
+- @return: 0 or FILE_ERR_BADF
+*/
+int32_t close(int32_t fd);
+
+/*
+Removes a file. Descriptors which are still open can be used until
+they are closed.
+- @return: 0, FILE_ERR_NOENT or FILE_ERR_FAULT
+*/
+int32_t unlink(const char *path);
+
+/*
+Maps a file or an anonymous region into the mmap window of the
+process (see kernel/mmap.h). Pages are populated on the first access.
+File mappings use the pages of the file itself: they are shared with
+all other mappings of the file and with read/write. Anonymous
+regions are private and start zeroed.
+- @input fd: descriptor of the file; needs read access, and write
+    access for PROT_WRITE. Ignored with MAP_ANONYMOUS
+- @input offset: start in the file, a multiple of 4096
+- @input len: number of bytes
+- @input flags: PROT_READ and/or PROT_WRITE, optionally MAP_ANONYMOUS
+- @return: address of the mapping or MAP_FAILED
+*/
+void * mmap(int32_t fd, uint32_t offset, uint32_t len, uint32_t flags);
+
+/*
+Removes a mapping.
+- @input addr: address returned by mmap
+- @return: 0 on success, MMAP_ERR_NOENT if there is no mapping at
+    addr, MMAP_ERR_BUSY while a ring (ring_setup) or a pending ring
+    read uses its pages
+*/
+uint8_t munmap(void *addr);
+
+/*
+Accesses the SD card through the buffer cache (see kernel/block.h).
+- @input op: BLOCK_OP_READ or BLOCK_OP_WRITE: count blocks of 512
+    bytes starting at block lba to / from buf.
+    BLOCK_OP_SYNC: writes all cached changes to the card.
+    BLOCK_OP_STATS: copies the struct block_stats_t to buf; also
+    works without a card.
+- @return: number of blocks, 0, or a negative BLOCK_ERR_* code
+    (BLOCK_ERR_NODEV if there is no SD card, BLOCK_ERR_FAULT if buf
+    is no buffer of the process)
+*/
+int32_t block_io(uint32_t op, uint32_t lba, void *buf, uint32_t count);
+
 /*
 Calls an unknown syscall. This is used for debugging purposes.
 */
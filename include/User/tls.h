@@ -0,0 +1,23 @@
+#ifndef USER_TLS_H
+#define USER_TLS_H
+
+#include <stdint.h>
+#include <kernel/tls.h>
+
+/* returns the TLS block of the calling thread */
+static inline struct tls_t * tls_self(void)
+{
+    return (struct tls_t *) read_tpidruro();
+}
+
+/* returns the id of the calling thread without a syscall */
+static inline uint32_t gettid(void)
+{
+    return tls_self()->tid;
+}
+
+/* run-time ABI helper: returns the thread pointer in r0 and preserves
+all other registers. Used by code built with -mtp=soft */
+void * __aeabi_read_tp(void);
+
+#endif // USER_TLS_H
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+#include <kernel/ring.h>
+
+/*
+Helpers for the submission and completion rings of kernel/ring.h.
+
+    struct ring_sqe_t *sqe = uring_get_sqe(&ring);
+    uring_prep(sqe, RING_OP_WRITE, 0, (uint32_t) buf, len, 1);
+    uring_push_sqe(&ring);
+    ...
+    ring_enter(1);
+    struct ring_cqe_t *cqe = uring_peek_cqe(&ring);
+    ...
+    uring_cqe_seen(&ring);
+*/
+
+/* returns the next free submission entry or 0 if the ring is full */
+static inline struct ring_sqe_t * uring_get_sqe(struct ring_t *ring)
+{
+    if (ring->sq_tail - ring->sq_head >= RING_ENTRIES)
+        return 0;
+    return &ring->sq[ring->sq_tail % RING_ENTRIES];
+}
+
+static inline void uring_prep(struct ring_sqe_t *sqe, uint32_t op, uint32_t arg,
+    uint32_t addr, uint32_t len, uint32_t user_data)
+{
+    sqe->op = op;
+    sqe->arg = arg;
+    sqe->addr = addr;
+    sqe->len = len;
+    sqe->user_data = user_data;
+}
+
+/* makes the entry of uring_get_sqe() visible to the next ring_enter() */
+static inline void uring_push_sqe(struct ring_t *ring)
+{
+    asm volatile("dmb" ::: "memory");
+    ring->sq_tail++;
+}
+
+/* returns the oldest unreaped completion or 0 */
+static inline struct ring_cqe_t * uring_peek_cqe(struct ring_t *ring)
+{
+    if (ring->cq_head == ring->cq_tail)
+        return 0;
+    asm volatile("dmb" ::: "memory");
+    return &ring->cq[ring->cq_head % RING_ENTRIES];
+}
+
+/* releases the completion of uring_peek_cqe() */
+static inline void uring_cqe_seen(struct ring_t *ring)
+{
+    asm volatile("dmb" ::: "memory");
+    ring->cq_head++;
+}
+
+#endif // URING_H
\ No newline at end of file
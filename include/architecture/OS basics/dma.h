@@ -0,0 +1,75 @@
+#ifndef DMA_H
+#define DMA_H
+
+#include <stdint.h>
+#include <arch/cpu/mm.h>
+
+#define DMA_BASE            (0x7E007000 - PERIPH_OFFSET)
+#define DMA_BUS_PERIPH      0x7E000000  // peripherals as seen by the DMA
+#define DMA_BUS_RAM         0xC0000000  // RAM as seen by the DMA, L2 cache bypassed
+
+/* channels used by the kernel; 0-6 are the full channels which the
+firmware leaves to the ARM (mask 0x7F35) */
+#define DMA_CH_MEMCPY       4
+#define DMA_CH_UART_TX      5
+#define DMA_CHANNELS        7
+
+/* transfer information (ti) of a control block */
+#define DMA_TI_INTEN        (1 << 0)    // interrupt at the end of this block
+#define DMA_TI_WAIT_RESP    (1 << 3)    // wait for the write response
+#define DMA_TI_DEST_INC     (1 << 4)
+#define DMA_TI_DEST_DREQ    (1 << 6)    // writes are paced by the peripheral
+#define DMA_TI_SRC_INC      (1 << 8)
+#define DMA_TI_SRC_DREQ     (1 << 10)   // reads are paced by the peripheral
+#define DMA_TI_BURST(n)     ((n) << 12)
+#define DMA_TI_PERMAP(n)    ((n) << 16)
+#define DMA_TI_NO_WIDE      (1 << 26)
+
+/* DREQ peripheral numbers */
+#define DMA_DREQ_UART_TX    12
+
+#define DMA_QUEUE           16  // memcpy requests in flight
+#define DMA_MIN_COPY        256 // shorter copies are faster on the CPU
+
+/* control block; read by the DMA from memory, must be 32 byte aligned */
+struct dma_cb_t {
+    uint32_t ti;
+    uint32_t source_ad;
+    uint32_t dest_ad;
+    uint32_t txfr_len;
+    uint32_t stride;
+    uint32_t nextconbk;     // bus address of the next block, 0 ends the chain
+    uint32_t reserved[2];
+} __attribute__((aligned(32)));
+
+typedef void (*dma_callback_t)(void *arg);
+
+void dma_init(void);
+
+/* address of a kernel (identity mapped) pointer as seen by the DMA */
+uint32_t dma_bus_addr(const volatile void *ptr);
+
+/*
+Async copy of len bytes. done(arg) is called in the DMA softirq once
+the copy is finished; done may be 0. Neither buffer may be touched
+until then. Returns a ticket for dma_done()/dma_wait() or 0 if the
+queue is full; the caller copies with kmemcpy() then.
+*/
+uint32_t dma_memcpy(void *dest, const void *src, uint32_t len, dma_callback_t done, void *arg);
+
+/* returns 1 if the copy of the ticket is finished */
+uint8_t dma_done(uint32_t ticket);
+
+/* busy waits until the copy of the ticket is finished */
+void dma_wait(uint32_t ticket);
+
+/* raw channel access for the drivers of DREQ paced peripherals. The
+handler is called by the interrupt of the channel in IRQ mode */
+void dma_channel_start(uint32_t ch, const struct dma_cb_t *cb);
+uint8_t dma_channel_active(uint32_t ch);
+uint32_t dma_channel_dest(uint32_t ch);
+void dma_channel_handler(uint32_t ch, void (*handler)(void));
+
+void dma_intr_h(uint32_t ch);
+
+#endif // DMA_H
\ No newline at end of file
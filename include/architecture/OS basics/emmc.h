@@ -0,0 +1,23 @@
+#ifndef EMMC_H
+#define EMMC_H
+
+#include <stdint.h>
+#include <arch/cpu/mm.h>
+
+#define EMMC_BASE           (0x7E300000 - PERIPH_OFFSET)
+#define EMMC_BLOCK_SIZE     512
+
+/* initializes the controller and the SD card; returns 0 on success,
+1 if there is no usable card */
+uint8_t emmc_init(void);
+
+/* number of blocks of the card; 0 if there is none */
+uint32_t emmc_block_count(void);
+
+/* transfers count consecutive blocks starting at block lba with one
+(multi-block) command. Block i is read into / written from bufs[i],
+which has to be 4 byte aligned. Returns 0 on success, 1 on errors */
+uint8_t emmc_read_blocks(uint32_t lba, uint32_t count, uint8_t * const bufs[]);
+uint8_t emmc_write_blocks(uint32_t lba, uint32_t count, uint8_t * const bufs[]);
+
+#endif // EMMC_H
\ No newline at end of file
@@ -8,6 +8,7 @@
 
 /* ARM peripherals interrupt sources */
 #define IRQ_TIMER_BASE  0
+#define IRQ_DMA_BASE    16  // one interrupt per DMA channel
 #define IRQ_UART    57
 /* ... other sources can be found on page 113 */
 
@@ -13,12 +13,52 @@
 #define L2_SIZE 256
 #define L2_PAGE_SIZE    0x1000
 
+/*
+Translation table split (TTBCR.N = MMU_TTBCR_N): TTBR0 translates the
+lower 2 GiB, which hold everything (kernel, RAM, peripherals). Walks
+through TTBR1 are disabled (TTBCR.PD1), so the upper half faults; the
+split only halves the tables. The kernel is linked and identity
+mapped at low addresses, so every process has a TTBR0 table of its
+own with MMU_PROC_L1_SIZE entries: a copy of the kernel entries of
+the global L1 table (global TLB entries) and its windows (user RAM,
+program, mmap). All L2 pages are not global and tagged with the ASID
+of their process, so a switch between processes does not flush the
+TLB.
+*/
+#define MMU_TTBCR_N         1
+#define MMU_PROC_L1_SIZE    (4096 >> MMU_TTBCR_N)
+#define MMU_PROC_L1_ALIGN   (MMU_PROC_L1_SIZE * 4)
+#define MMU_KERNEL_ASID     0   // the global table while no process is loaded
+
 #define LINKER2VAL(linker)  ((uint32_t) &linker)
 
 void mmu_init(void);
 void L1_init(uint32_t phy_adr, uint32_t vir_adr, uint32_t right, uint8_t isL2, uint8_t xn[] /* execute never */);
 uint32_t L2_init(uint32_t phy_adr, uint32_t right, uint8_t isGuard, uint8_t xn /* execute never */);
 
+/* whether user mode may read (with write: write) the page of an L2
+entry; 0 for guard pages */
+uint8_t L2_user_access(uint32_t L2_entry, uint8_t write);
+
+/* physical address of the page of an L2 entry */
+uint32_t L2_phys(uint32_t L2_entry);
+
+/* like L1_init, but for the TTBR0 table of a process */
+void L1_set(uint32_t table[], uint32_t phy_adr, uint32_t vir_adr, uint32_t right, uint8_t isL2,
+    uint8_t xn[] /* execute never */);
+
+/* fills the TTBR0 table of a process with the kernel entries */
+void mmu_proc_table_init(uint32_t table[]);
+
+/* loads the TTBR0 table of a process and its ASID */
+void mmu_switch(uint32_t table[], uint8_t asid);
+
+/* invalidates all TLB entries after a change of the tables */
+void mmu_tlb_flush(void);
+
+/* invalidates the TLB entries of one process */
+void mmu_tlb_flush_asid(uint8_t asid);
+
 void print_L_table(uint32_t table[], uint32_t n_entries);
 
 #endif
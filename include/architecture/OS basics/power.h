@@ -0,0 +1,13 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <arch/cpu/mm.h>
+
+#define PM_BASE     (0x7E100000 - PERIPH_OFFSET)
+
+/* Resets the board through the watchdog of the power management block.
+QEMU started with -no-reboot exits instead, which ends headless runs. */
+void power_reset(void) __attribute__((noreturn));
+
+#endif // POWER_H
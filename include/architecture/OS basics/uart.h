@@ -6,6 +6,7 @@
 #include <arch/cpu/mm.h>
 
 #define UART_BASE   (0x7E201000 - PERIPH_OFFSET)
+#define UART_DMA_TX_MAX     128     // chars per DMA transfer
 
 void uart_enable(void);
 uint8_t uart_char_available(void);
@@ -13,6 +14,18 @@ char uart_get_char(void);
 void uart_put_char(char c);
 void uart_put_str(const char *input);
 
+/* transmit side for the kernel log drain */
+uint8_t uart_tx_ready(void);
+void uart_tx_intr_enable(uint8_t enable);
+uint8_t uart_tx_intr_enabled(void);
+
+/* DMA transmit: sends n <= UART_DMA_TX_MAX chars paced by the DREQ
+of the UART and raises SOFTIRQ_KLOG when done. The chars are copied,
+the buffer is free on return. Only one transfer runs at a time */
+uint8_t uart_dma_tx_enabled(void);
+uint8_t uart_dma_tx_busy(void);
+void uart_dma_tx(const char *chars, uint32_t n);
+
 void uart_intr_h(struct registers_t * reg);
 
 #endif // UART_H
@@ -34,6 +34,22 @@
 
 #define SWITCH_PROC_MODE(mode) asm("cps %0" :: "I"(mode))
 
+#define IRQ_DISABLE()   asm volatile("cpsid i" ::: "memory")
+#define IRQ_ENABLE()    asm volatile("cpsie i" ::: "memory")
+
+/* disables interrupts and returns the previous cpsr for irq_restore() */
+static inline uint32_t irq_save(void)
+{
+    uint32_t cpsr;
+    asm volatile("mrs %0, cpsr\n cpsid i" : "=r" (cpsr) :: "memory");
+    return cpsr;
+}
+
+static inline void irq_restore(uint32_t cpsr)
+{
+    asm volatile("msr cpsr_c, %0" :: "r" (cpsr) : "memory");
+}
+
 
 struct registers_t {
     uint32_t sp;
@@ -44,13 +60,22 @@ struct registers_t {
 
 #define NO_REGISTERS ((struct registers_t *) 0)
 
-/* TODO: use this everywhere instead of registers_t */
-struct context_t {
-    uint32_t sp;
-    uint32_t cpsr;
+/* frame of syscalls, IRQs and data aborts on the kernel stack of the
+thread (see arch/cpu/entry.S). The handlers get a pointer to reg */
+struct trap_frame_t {
+    uint32_t svc_lr;    // lr of interrupted kernel code
+    uint32_t usr_sp;
+    uint32_t usr_lr;
+    struct registers_t reg;     // lr is the return address
+    uint32_t spsr;      // cpsr of the interrupted code
+};
+
+#define TRAP_FRAME(r)   ((struct trap_frame_t *) ((uint32_t) (r) - __builtin_offsetof(struct trap_frame_t, reg)))
+
+/* saved by _switch_to() below the sp of a context which is switched out */
+struct switch_frame_t {
+    uint32_t registers[9];  // r3-r11
     uint32_t pc;
-    uint32_t base_registers[NUM_REGISTERS];
-    uint32_t lr;
 };
 
 struct mode_registers {
@@ -78,4 +103,14 @@ void _set_usr_sp_lr(uint32_t sp, uint32_t lr);
 
 void _infinite_loop(void);
 
+/* calls func with interrupts enabled; see kernel/softirq.h */
+void _softirq_call(void (*func)(void));
+
+/* saves the current kernel context, stores its sp to *save_sp and
+continues the context at sp */
+void _switch_to(uint32_t *save_sp, uint32_t sp);
+
+/* leaves the kernel through the struct trap_frame_t at sp */
+void _trap_return(void);
+
 #endif // ARM_H
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <stdint.h>
+
+/*
+Atomic operations based on LDREX/STREX. They are usable from kernel
+and user mode and are safe against interrupts, because an exception
+return clears the exclusive monitor.
+*/
+
+#define dmb()   asm volatile("dmb" ::: "memory")
+
+/* stores desired in *ptr if *ptr equals expected;
+returns the previous value of *ptr */
+static inline uint32_t atomic_cmpxchg(volatile uint32_t *ptr, uint32_t expected, uint32_t desired)
+{
+    uint32_t prev, fail;
+
+    do {
+        asm volatile(
+            "ldrex   %0, [%2]\n"
+            "mov     %1, #0\n"
+            "teq     %0, %3\n"
+            "strexeq %1, %4, [%2]\n"
+            : "=&r" (prev), "=&r" (fail)
+            : "r" (ptr), "r" (expected), "r" (desired)
+            : "cc", "memory");
+    } while (fail);
+
+    return prev;
+}
+
+/* adds value to *ptr and returns the new value */
+static inline uint32_t atomic_add_return(volatile uint32_t *ptr, uint32_t value)
+{
+    uint32_t result, fail;
+
+    do {
+        asm volatile(
+            "ldrex   %0, [%2]\n"
+            "add     %0, %0, %3\n"
+            "strex   %1, %0, [%2]\n"
+            : "=&r" (result), "=&r" (fail)
+            : "r" (ptr), "r" (value)
+            : "cc", "memory");
+    } while (fail);
+
+    return result;
+}
+
+/* stores value in *ptr and returns the previous value */
+static inline uint32_t atomic_xchg(volatile uint32_t *ptr, uint32_t value)
+{
+    uint32_t prev, fail;
+
+    do {
+        asm volatile(
+            "ldrex   %0, [%2]\n"
+            "strex   %1, %3, [%2]\n"
+            : "=&r" (prev), "=&r" (fail)
+            : "r" (ptr), "r" (value)
+            : "memory");
+    } while (fail);
+
+    return prev;
+}
+
+/* sets the bits of mask in *ptr */
+static inline void atomic_or(volatile uint32_t *ptr, uint32_t mask)
+{
+    uint32_t result, fail;
+
+    do {
+        asm volatile(
+            "ldrex   %0, [%2]\n"
+            "orr     %0, %0, %3\n"
+            "strex   %1, %0, [%2]\n"
+            : "=&r" (result), "=&r" (fail)
+            : "r" (ptr), "r" (mask)
+            : "cc", "memory");
+    } while (fail);
+}
+
+#endif // ATOMIC_H
@@ -4,6 +4,7 @@
 #define RW_OFFSET   11
 #define STATUS_4BIT 10
 #define IMP_EX_ABT  0b10110
+#define FSR_TRANSLATION_PAGE    0b00111
 
 #define DATA_ABT_LR_OFFSET  8
 #define PREF_ABT_LR_OFFSET  4
@@ -20,6 +20,10 @@
 #define STACK_SIZE_UND  STACK_SIZE_DEFAULT
 #define STACK_SIZE_ABT  STACK_SIZE_DEFAULT
 
+/* kernel stack of every thread for syscalls and interrupts; the SVC
+stack above is the one of the idle loop */
+#define STACK_SIZE_KERNEL   0x2000
+
 /* User Stack Management (0x0B001 - 0x1B000) */
 #define STACK_SIZE_THREAD   0x800 
 
@@ -0,0 +1,52 @@
+#ifndef PMU_H
+#define PMU_H
+
+#include <stdint.h>
+
+/*
+Performance monitoring unit of the Cortex-A7.
+
+The cycle counter and four event counters run freely; per-thread
+values are derived from the difference between two switches.
+
+User mode has no access by default. On ARMv7 PMUSERENR.EN also allows
+writes (reset, stop, event selection), so pmu_user_access() is only
+for trusted images like the benchmarks (PROF_CTL_PMU_USER); the
+accounting drops differences above PMU_MAX_CYCLES_PER_US.
+*/
+
+#define PMU_N_EVENT_COUNTERS    4
+#define PMU_MAX_CYCLES_PER_US   1500    // above any clock of the supported boards
+#define PMU_MAX_EVENTS_PER_CYCLE 2      // dual issue
+
+/* events of the counters 0..3 (ARMv7 common event numbers) */
+#define PMU_EV_INSTRUCTIONS     0x08
+#define PMU_EV_L1I_REFILL       0x01
+#define PMU_EV_L1D_REFILL       0x03
+#define PMU_EV_L1D_ACCESS       0x04
+
+#define PMU_CNT_INSTRUCTIONS    0
+#define PMU_CNT_L1I_REFILL      1
+#define PMU_CNT_L1D_REFILL      2
+#define PMU_CNT_L1D_ACCESS      3
+
+struct pmu_counts_t {
+    uint32_t cycles;
+    uint32_t events[PMU_N_EVENT_COUNTERS];
+};
+
+void pmu_init(void);
+void pmu_read(struct pmu_counts_t *counts);
+
+/* allows user mode to access the counters (PMUSERENR.EN) */
+void pmu_user_access(uint8_t enable);
+
+/* reads PMCCNTR; usable from user mode after pmu_user_access() */
+static inline uint32_t pmu_read_cycles(void)
+{
+    uint32_t cycles;
+    asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (cycles));
+    return cycles;
+}
+
+#endif // PMU_H
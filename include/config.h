@@ -34,8 +34,8 @@
 #define BUSY_WAIT_COUNTER 30000
 #endif // __QEMU__
 
-// Wir testen nur mit Werten die durch 2^n darstellbar sind
-#define UART_INPUT_BUFFER_SIZE 128
+// Muss eine Zweierpotenz sein (Index per Maske, siehe arch/bsp/uart.c)
+#define UART_INPUT_BUFFER_SIZE 1024
 
 // Timer Interrupt Interval zum testen in Mikrosekunden
 // Systimer taktet mit 1MHz
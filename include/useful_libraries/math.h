@@ -1,4 +1,4 @@
-#include <stdio.h>
+#include <stdint.h>
 
 #ifndef MATH_H
 #define MATH_H
@@ -15,4 +15,10 @@ Be cautions with negative values:
 */
 int32_t divide_ceil(int32_t numerator, int32_t denominator);
 
+/*
+Unsigned division of a 64 bit value by a 32 bit value. The compiler
+would call __aeabi_uldivmod for this, which is not available here.
+*/
+uint64_t divu64(uint64_t numerator, uint32_t denominator);
+
 #endif // MATH_H
\ No newline at end of file
@@ -6,5 +6,6 @@
 int32_t strlength(const char *str);
 int32_t ctoi(char c);
 void kmemcpy(void * dest, const void * src, uint32_t size);
+void kmemset(void * dest, uint8_t value, uint32_t size);
 
 #endif
\ No newline at end of file
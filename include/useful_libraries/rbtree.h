@@ -0,0 +1,41 @@
+#ifndef RBTREE_H
+#define RBTREE_H
+
+#include <stdint.h>
+
+/*
+Intrusive red-black tree sorted by a 64 bit key. The node is embedded
+in the element; the owner sets key before rb_insert and must not
+change it while the node is in a tree. Nodes with equal keys are kept
+in insertion order. The leftmost node is cached, so rb_first is O(1).
+*/
+
+struct rb_node_t {
+    struct rb_node_t *parent;
+    struct rb_node_t *left;
+    struct rb_node_t *right;
+    uint8_t red;
+    uint64_t key;
+};
+
+struct rb_tree_t {
+    struct rb_node_t *root;
+    struct rb_node_t *leftmost;
+};
+
+#define RB_TREE_INIT    {0, 0}
+
+void rb_insert(struct rb_tree_t *tree, struct rb_node_t *node);
+void rb_erase(struct rb_tree_t *tree, struct rb_node_t *node);
+
+/* smallest / largest key; 0 if the tree is empty */
+static inline struct rb_node_t * rb_first(const struct rb_tree_t *tree)
+{
+    return tree->leftmost;
+}
+struct rb_node_t * rb_last(const struct rb_tree_t *tree);
+
+/* in-order successor; 0 for the last node */
+struct rb_node_t * rb_next(const struct rb_node_t *node);
+
+#endif // RBTREE_H
\ No newline at end of file
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+"""
+Writes the initramfs archive which is linked into the kernel image.
+
+    tools/mkinitramfs.py -o build/initramfs.cpio bin/hello=build/user/programs/hello.elf ...
+
+Every argument is NAME=FILE: FILE is stored as NAME. The output is a
+cpio archive in the "newc" format (the same as "cpio -H newc"), which
+kernel/initramfs.c reads in place.
+"""
+
+import argparse
+import os
+import sys
+
+MODE_FILE = 0o100644
+
+
+def header(ino, mode, size, name):
+    fields = [ino, mode, 0, 0, 1, 0, size, 0, 0, 0, 0, len(name) + 1, 0]
+    return b"070701" + b"".join(b"%08x" % f for f in fields)
+
+
+def pad4(data):
+    return data + b"\0" * (-len(data) % 4)
+
+
+def entry(ino, mode, name, data):
+    return pad4(header(ino, mode, len(data), name) + name.encode() + b"\0") + pad4(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("files", nargs="*", metavar="NAME=FILE")
+    args = parser.parse_args()
+
+    archive = b""
+    for ino, spec in enumerate(args.files, start=1):
+        name, sep, path = spec.partition("=")
+        if not sep:
+            name, path = os.path.basename(spec), spec
+        name = name.lstrip("/")
+        try:
+            with open(path, "rb") as f:
+                data = f.read()
+        except OSError as err:
+            sys.exit("mkinitramfs: %s" % err)
+        archive += entry(ino, MODE_FILE, name, data)
+
+    archive += entry(0, 0, "TRAILER!!!", b"")
+    with open(args.output, "wb") as out:
+        out.write(archive)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+Symbolizes a profiler dump and writes folded stacks.
+
+A user thread starts the profiler with prof_ctl(PROF_CTL_START, hz)
+and prints the samples with prof_ctl(PROF_CTL_DUMP, 0). Capture the
+console output, e.g.
+
+    make qemu | tee prof.log
+
+and convert it with
+
+    tools/prof2folded.py prof.log > prof.folded
+    flamegraph.pl prof.folded > prof.svg
+
+Symbols are read from build/kernel.elf with nm (set NM or --nm for
+another toolchain prefix) or, with --dump, from the kernel_dump.s
+written by "make dump". Only the last PROF_BEGIN ... PROF_END block
+of the log is used.
+
+The kernel is built without frame pointers, so a stack has at most
+two frames: the function of the lr of the interrupted mode (usually
+the caller) and the function of the PC. --flat prints a flat profile
+instead.
+"""
+
+import argparse
+import bisect
+import collections
+import os
+import re
+import subprocess
+import sys
+
+IDLE_TID = 0xFFFF   # see include/Kernel/trace.h
+
+MODE_NAMES = {
+    0x10: "usr",
+    0x11: "fiq",
+    0x12: "irq",
+    0x13: "svc",
+    0x17: "abt",
+    0x1B: "und",
+    0x1F: "sys",
+}
+
+
+def read_samples(lines):
+    """returns (samples, hz, dropped) of the last complete dump in the log"""
+    result = ([], 0, 0)
+    current = None
+    header = None
+    for line in lines:
+        line = line.strip()
+        if line.startswith("PROF_BEGIN"):
+            fields = line.split()
+            header = (int(fields[2]), int(fields[3])) if len(fields) == 4 else (0, 0)
+            current = []
+        elif line.startswith("PROF_END"):
+            if current is not None:
+                result = (current, header[0], header[1])
+            current = None
+        elif current is not None and line.startswith("P "):
+            fields = line.split()
+            if len(fields) != 5:
+                continue
+            current.append((int(fields[1], 16), int(fields[2], 16),
+                            int(fields[3]), int(fields[4], 16)))
+    return result
+
+
+class Symbols:
+    def __init__(self, symbols):
+        symbols.sort()
+        self.addrs = [addr for addr, _ in symbols]
+        self.names = [name for _, name in symbols]
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return "0x%08x" % addr
+        return self.names[i]
+
+
+def symbols_from_nm(nm, elf):
+    out = subprocess.run([nm, "-n", elf], check=True, capture_output=True, text=True).stdout
+    symbols = []
+    for line in out.splitlines():
+        fields = line.split()
+        # only text symbols; $a/$d mapping symbols carry no names
+        if len(fields) == 3 and fields[1] in "tTwW" and not fields[2].startswith("$"):
+            symbols.append((int(fields[0], 16), fields[2]))
+    return Symbols(symbols)
+
+
+def symbols_from_dump(path):
+    symbol_line = re.compile(r"^([0-9a-fA-F]+) <([^>]+)>:")
+    symbols = []
+    with open(path, errors="replace") as dump:
+        for line in dump:
+            m = symbol_line.match(line)
+            if m and not m.group(2).startswith("$"):
+                symbols.append((int(m.group(1), 16), m.group(2)))
+    return Symbols(symbols)
+
+
+def stack(sample, symbols):
+    pc, lr, tid, mode = sample
+    func = symbols.lookup(pc)
+    thread = "idle" if tid == IDLE_TID else "thread %d" % tid
+    frames = [thread, MODE_NAMES.get(mode, "mode %x" % mode)]
+    if lr:
+        caller = symbols.lookup(lr)
+        if caller != func:
+            frames.append(caller)
+    frames.append(func)
+    return ";".join(frames)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="console log (default: stdin)")
+    parser.add_argument("--elf", default="build/kernel.elf")
+    parser.add_argument("--nm", default=os.environ.get("NM", "arm-none-eabi-nm"))
+    parser.add_argument("--dump", help="use this objdump output instead of nm")
+    parser.add_argument("--flat", action="store_true", help="print a flat profile")
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log, errors="replace") as log:
+            samples, hz, dropped = read_samples(log)
+    else:
+        samples, hz, dropped = read_samples(sys.stdin)
+
+    if not samples:
+        sys.exit("no profiler dump found")
+    if dropped:
+        sys.stderr.write("warning: %d samples were dropped (buffer full)\n" % dropped)
+
+    try:
+        symbols = symbols_from_dump(args.dump) if args.dump else symbols_from_nm(args.nm, args.elf)
+    except (OSError, subprocess.CalledProcessError) as err:
+        sys.exit("can not read symbols: %s" % err)
+
+    if args.flat:
+        counts = collections.Counter(symbols.lookup(pc) for pc, _, _, _ in samples)
+        total = len(samples)
+        print("# %d samples at %d Hz" % (total, hz))
+        for name, count in counts.most_common():
+            print("%6.2f%% %7d  %s" % (100.0 * count / total, count, name))
+    else:
+        counts = collections.Counter(stack(sample, symbols) for sample in samples)
+        for folded, count in sorted(counts.items()):
+            print("%s %d" % (folded, count))
+
+
+if __name__ == "__main__":
+    main()
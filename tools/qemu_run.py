@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""
+Runs the kernel headless under QEMU and logs the console output.
+
+    tools/qemu_run.py [--log FILE] [--timeout SEC] [--fail TEXT]
+                      [--max NAME=VALUE ...] -- qemu-system-arm ...
+
+The console is copied to stdout and, with --log, to FILE. When the
+guest prints a line
+
+    INPUT <n>
+
+the runner sends n chars to the UART, so benchmarks can measure the
+receive path without a human at the keyboard. Lowercase chars are
+used on purpose: some uppercase chars trigger the fault tests of the
+UART interrupt handler.
+
+QEMU must be started with -no-reboot; the shutdown syscall resets the
+board, which then ends QEMU. The exit code is 0 if QEMU exited by
+itself, 1 on timeout and 2 if a console line contained the --fail
+text (e.g. a failed stress test) or a limit was exceeded.
+
+--max NAME=VALUE checks result lines like
+    LAT idle.wakeup unit=us n=1024 ... max=37
+whose second field is NAME: the run fails if their max= field is
+greater than VALUE. The option can be given several times.
+"""
+
+import argparse
+import subprocess
+import sys
+import threading
+
+INPUT_CHAR = b"x"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--log", help="file which receives a copy of the console")
+    parser.add_argument("--timeout", type=float, default=120,
+                        help="seconds until QEMU is killed (default: %(default)s)")
+    parser.add_argument("--fail", help="the run fails if a console line contains this text")
+    parser.add_argument("--max", action="append", default=[], metavar="NAME=VALUE",
+                        help="the run fails if the max= field of result NAME exceeds VALUE")
+    parser.add_argument("qemu", nargs=argparse.REMAINDER,
+                        help="QEMU command line, after --")
+    args = parser.parse_args()
+
+    cmd = args.qemu
+    if cmd and cmd[0] == "--":
+        cmd = cmd[1:]
+    if not cmd:
+        parser.error("no QEMU command given")
+
+    limits = {}
+    for spec in args.max:
+        name, sep, value = spec.partition("=")
+        if not sep or not value.isdigit():
+            parser.error("--max expects NAME=VALUE, got %r" % spec)
+        limits[name] = int(value)
+
+    log = open(args.log, "w") if args.log else None
+    qemu = subprocess.Popen(cmd, stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    failures = []
+
+    def pump():
+        for raw in qemu.stdout:
+            line = raw.decode(errors="replace")
+            sys.stdout.write(line)
+            sys.stdout.flush()
+            if log:
+                log.write(line)
+                log.flush()
+            if args.fail and args.fail in line:
+                failures.append(line.strip())
+
+            fields = line.split()
+            if len(fields) >= 2 and fields[1] in limits:
+                for field in fields[2:]:
+                    if field.startswith("max=") and field[4:].isdigit():
+                        if int(field[4:]) > limits[fields[1]]:
+                            failures.append("%s: limit %d exceeded" % (line.strip(), limits[fields[1]]))
+            if len(fields) == 2 and fields[0] == "INPUT" and fields[1].isdigit():
+                qemu.stdin.write(INPUT_CHAR * int(fields[1]))
+                qemu.stdin.flush()
+
+    reader = threading.Thread(target=pump, daemon=True)
+    reader.start()
+
+    timed_out = False
+    try:
+        qemu.wait(timeout=args.timeout)
+    except subprocess.TimeoutExpired:
+        timed_out = True
+        qemu.kill()
+        qemu.wait()
+        sys.stderr.write("qemu_run: timeout after %g s\n" % args.timeout)
+
+    reader.join(timeout=1)
+    if log:
+        log.close()
+    if timed_out:
+        return 1
+    if failures:
+        sys.stderr.write("qemu_run: %d failure(s):\n" % len(failures))
+        for failure in failures:
+            sys.stderr.write("  %s\n" % failure)
+        return 2
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
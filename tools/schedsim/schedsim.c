@@ -0,0 +1,474 @@
+/*
+ * Host simulator for the scheduling core (kernel/sched.c).
+ *
+ * The simulator links the same sched.c as the kernel and replaces the
+ * hardware around it: the scheduler timer is a simulated clock in
+ * microseconds and the MMU is reduced to a fixed cost for each switch
+ * into another address space. A synthetic workload of CPU bound and
+ * I/O bound threads is replayed once per policy, so policies can be
+ * compared on the same input. Every process is a group of the fair
+ * class; --hog adds CPU bound threads to process 0 only. Optional deadline (EDF) threads run
+ * jobs of varying length every period.
+ *
+ * Build and run:
+ *     make schedsim
+ *     build/schedsim --cpu 500 --io 2000 --policy all
+ *
+ * Reported per policy:
+ *     switches   context switches (idle excluded)
+ *     timers     scheduler timer interrupts; --slack lets the I/O bound
+ *                threads share them (timer slack, see kernel/sched.h)
+ *     util       share of the simulated time spent in threads
+ *     io_ops/s   completed bursts of I/O bound threads per second
+ *     lat_*      wake-up latency: first dispatch after the requested
+ *                wake-up time, in microseconds
+ *     jain_*     Jain's fairness index of the CPU time of the CPU and
+ *                of the I/O bound threads and of the processes
+ *                (1.0 = perfectly fair)
+ *     dl_miss    jobs of deadline threads finished late or throttled
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+/* the kernel's time_t (64 bit microseconds) clashes with the one of libc */
+#define time_t ktime_t
+#include <kernel/sched.h>
+#undef time_t
+
+#define TCB_OF(node)    ((struct sim_thread_t *) (node))   // sched is the first member
+#define NO_THREAD       ((struct sim_thread_t *) 0)
+
+enum thread_kind_t {CPU_BOUND, IO_BOUND, DEADLINE};
+
+struct sim_thread_t {
+    struct sched_node_t sched;
+    uint32_t id;
+    uint32_t proc;              // address space
+    enum thread_kind_t kind;
+    ktime_t remaining;          // of the current burst or job
+    ktime_t cpu_time;
+    ktime_t wanted_at;          // requested wake-up time of a pending wake-up
+    uint8_t wake_pending;
+    uint64_t bursts;
+};
+
+struct sim_config_t {
+    uint32_t n_cpu;
+    uint32_t n_io;
+    uint32_t n_hog;             // extra CPU bound threads of process 0
+    uint32_t n_procs;
+    uint32_t n_rt;
+    ktime_t rt_runtime;         // reserved runtime of deadline threads
+    ktime_t rt_period;          // period (= relative deadline) of deadline threads
+    ktime_t rt_job;             // mean length of a job
+    ktime_t burst;              // mean CPU burst of I/O bound threads
+    ktime_t sleep;              // mean sleep of I/O bound threads
+    ktime_t slack;              // timer slack of I/O bound threads
+    ktime_t tick;               // scheduler timer interval
+    ktime_t duration;
+    ktime_t switch_cost;
+    ktime_t mmu_cost;           // additional cost of a switch between processes
+    uint32_t seed;
+};
+
+struct sim_result_t {
+    uint64_t switches;
+    uint64_t timers;
+    uint64_t bursts;
+    uint64_t dl_misses;
+    uint32_t dl_rejected;
+    ktime_t busy;
+    ktime_t *latencies;
+    uint64_t n_latencies;
+    uint64_t max_latencies;
+    double jain_cpu;
+    double jain_io;
+    double jain_proc;
+};
+
+struct policy_name_t {
+    const char *name;
+    uint32_t policy;
+};
+
+const struct policy_name_t policy_names[] = {
+    {"default",     SCHED_POLICY_DEFAULT},
+    {"rr",          0},
+    {"tail",        SCHED_INSERT_TAIL},
+    {"wakeup",      SCHED_TIMER_WAKEUP},
+    {"tail+wakeup", SCHED_INSERT_TAIL | SCHED_TIMER_WAKEUP},
+    {"fair",        SCHED_FAIR},
+    {"fair+wakeup", SCHED_FAIR | SCHED_TIMER_WAKEUP},
+};
+#define N_POLICIES  (sizeof(policy_names) / sizeof(policy_names[0]))
+
+uint32_t rng_state;
+
+/* xorshift32; the same seed gives every policy the same workload */
+uint32_t rng_next()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/* uniform in [mean/2, 3*mean/2] */
+ktime_t rng_around(ktime_t mean)
+{
+    if (mean < 2)
+        return mean;
+    return mean / 2 + rng_next() % (mean + 1);
+}
+
+struct sim_result_t *current_result;
+
+void record_latency(ktime_t latency)
+{
+    struct sim_result_t *res = current_result;
+    if (res->n_latencies == res->max_latencies) {
+        res->max_latencies = res->max_latencies ? 2 * res->max_latencies : 4096;
+        res->latencies = realloc(res->latencies, res->max_latencies * sizeof(ktime_t));
+        if (!res->latencies) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    res->latencies[res->n_latencies++] = latency;
+}
+
+void on_wakeup(volatile struct sched_node_t *node, ktime_t now)
+{
+    (void) now;
+    struct sim_thread_t *thread = TCB_OF(node);
+    thread->wanted_at = node->wake_at;
+    thread->wake_pending = 1;
+}
+
+double jain_index(struct sim_thread_t *threads, uint32_t n, enum thread_kind_t kind)
+{
+    double sum = 0, sum_sq = 0;
+    uint32_t count = 0;
+
+    for (uint32_t i=0; i<n; i++) {
+        if (threads[i].kind != kind)
+            continue;
+        double x = (double) threads[i].cpu_time;
+        sum += x;
+        sum_sq += x * x;
+        count++;
+    }
+    if ((count == 0) || (sum_sq == 0))
+        return 1.0;
+    return (sum * sum) / (count * sum_sq);
+}
+
+/* fairness of the CPU time of the processes */
+double jain_index_proc(struct sim_thread_t *threads, uint32_t n, uint32_t n_procs)
+{
+    double *proc_time = calloc(n_procs, sizeof(double));
+    if (!proc_time) {
+        perror("calloc");
+        exit(1);
+    }
+    for (uint32_t i=0; i<n; i++)
+        proc_time[threads[i].proc] += (double) threads[i].cpu_time;
+
+    double sum = 0, sum_sq = 0;
+    for (uint32_t p=0; p<n_procs; p++) {
+        sum += proc_time[p];
+        sum_sq += proc_time[p] * proc_time[p];
+    }
+    free(proc_time);
+    if (sum_sq == 0)
+        return 1.0;
+    return (sum * sum) / (n_procs * sum_sq);
+}
+
+void simulate(const struct sim_config_t *cfg, uint32_t policy, struct sim_result_t *res)
+{
+    uint32_t n = cfg->n_cpu + cfg->n_io + cfg->n_rt + cfg->n_hog;
+    struct sim_thread_t *threads = calloc(n, sizeof(struct sim_thread_t));
+    struct sched_group_t *groups = calloc(cfg->n_procs, sizeof(struct sched_group_t));
+    if (!threads || !groups) {
+        perror("calloc");
+        exit(1);
+    }
+
+    memset(res, 0, sizeof(*res));
+    current_result = res;
+    rng_state = cfg->seed ? cfg->seed : 1;
+    sched_init();
+    sched_policy = policy;
+    for (uint32_t p=0; p<cfg->n_procs; p++)
+        sched_group_init(&groups[p]);
+
+    /* interleave the kinds, so the start order does not favour one;
+    deadline threads and the hogs come last */
+    uint32_t n_normal = cfg->n_cpu + cfg->n_io;
+    for (uint32_t i=0; i<n; i++) {
+        struct sim_thread_t *thread = &threads[i];
+        thread->id = i;
+        thread->proc = (i >= n_normal + cfg->n_rt) ? 0 : i % cfg->n_procs;
+        if (i >= n_normal + cfg->n_rt)
+            thread->kind = CPU_BOUND;
+        else if (i >= n_normal)
+            thread->kind = DEADLINE;
+        else if ((uint64_t) i * cfg->n_io / n_normal != (uint64_t) (i + 1) * cfg->n_io / n_normal)
+            thread->kind = IO_BOUND;
+        else
+            thread->kind = CPU_BOUND;
+        thread->remaining = rng_around((thread->kind == DEADLINE) ? cfg->rt_job : cfg->burst);
+        sched_set_group(&thread->sched, &groups[thread->proc]);
+        if (thread->kind == IO_BOUND)
+            thread->sched.slack = cfg->slack;
+        sched_add_ready(&thread->sched);
+
+        if ((thread->kind == DEADLINE) &&
+            sched_setdeadline(&thread->sched, cfg->rt_runtime, cfg->rt_period, cfg->rt_period, 0))
+            res->dl_rejected++;
+    }
+
+    ktime_t now = 0;
+    ktime_t timer_at = 0;   // the first scheduler run starts the first thread
+    uint32_t last_proc = ~0;
+
+    while (now < cfg->duration) {
+        struct sim_thread_t *thread = TCB_OF(sched_current());
+
+        /* next event: the timer or the end of the current burst */
+        ktime_t next = timer_at;
+        uint8_t burst_done = 0;
+        if ((thread != NO_THREAD) && (thread->kind != CPU_BOUND) && (now + thread->remaining < next)) {
+            next = now + thread->remaining;
+            burst_done = 1;
+        }
+        if (next > cfg->duration)
+            next = cfg->duration;
+
+        if (thread != NO_THREAD) {
+            thread->cpu_time += next - now;
+            res->busy += next - now;
+            if (thread->kind != CPU_BOUND)
+                thread->remaining -= next - now;
+        }
+        now = next;
+        if (now >= cfg->duration)
+            break;
+        if (!burst_done)
+            res->timers++;
+
+        sched_account(now);
+        if (burst_done && (thread->kind == DEADLINE)) {
+            /* the thread calls next_period() */
+            if (!thread->sched.dl.active) {
+                thread->remaining = rng_around(cfg->rt_job);   // rejected: runs as ordinary thread
+            }
+            else {
+                if (sched_next_period(&thread->sched, now))
+                    res->dl_misses++;
+                thread->remaining = rng_around(cfg->rt_job);
+            }
+        }
+        else if (burst_done) {
+            /* the thread calls sleep() */
+            thread->bursts++;
+            res->bursts++;
+            thread->remaining = rng_around(cfg->burst);
+            sched_sleep(&thread->sched, now + rng_around(cfg->sleep));
+        }
+
+        /* scheduler(): throttle, wake threads, pick the next one, program the timer */
+        if (sched_throttle(now) != NO_NODE)
+            res->dl_misses++;
+        sched_wake(now, on_wakeup);
+        struct sim_thread_t *prev = TCB_OF(sched_current());
+        struct sim_thread_t *picked = TCB_OF(sched_pick_next());
+        if ((picked != NO_THREAD) && (picked != prev)) {
+            res->switches++;
+            now += cfg->switch_cost;
+            if (picked->proc != last_proc) {
+                /* mocked TTBR0/ASID switch (mmu_switch) */
+                now += cfg->mmu_cost;
+                last_proc = picked->proc;
+            }
+        }
+        if ((picked != NO_THREAD) && picked->wake_pending) {
+            picked->wake_pending = 0;
+            record_latency(now - picked->wanted_at);
+        }
+        timer_at = now + sched_timer_interval(now, cfg->tick);
+    }
+
+    res->jain_cpu = jain_index(threads, n, CPU_BOUND);
+    res->jain_io = jain_index(threads, n, IO_BOUND);
+    res->jain_proc = jain_index_proc(threads, n, cfg->n_procs);
+    free(threads);
+    free(groups);
+}
+
+int compare_time(const void *a, const void *b)
+{
+    ktime_t x = *(const ktime_t *) a;
+    ktime_t y = *(const ktime_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* nearest rank percentile of sorted values */
+ktime_t percentile(const ktime_t *sorted, uint64_t n, double p)
+{
+    if (n == 0)
+        return 0;
+    uint64_t rank = (uint64_t) (p / 100.0 * n + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    if (rank > n)
+        rank = n;
+    return sorted[rank - 1];
+}
+
+void print_result(const char *name, const struct sim_config_t *cfg, struct sim_result_t *res)
+{
+    qsort(res->latencies, res->n_latencies, sizeof(ktime_t), compare_time);
+    double seconds = cfg->duration / 1e6;
+
+    printf("%-12s %9llu %9llu %6.1f%% %10.1f %8llu %8llu %8llu %8llu %8.4f %8.4f %9.4f %8llu\n", name,
+        (unsigned long long) res->switches, (unsigned long long) res->timers, 100.0 * res->busy / cfg->duration,
+        res->bursts / seconds,
+        (unsigned long long) percentile(res->latencies, res->n_latencies, 50),
+        (unsigned long long) percentile(res->latencies, res->n_latencies, 99),
+        (unsigned long long) percentile(res->latencies, res->n_latencies, 99.9),
+        (unsigned long long) (res->n_latencies ? res->latencies[res->n_latencies - 1] : 0),
+        res->jain_cpu, res->jain_io, res->jain_proc, (unsigned long long) res->dl_misses);
+    if (res->dl_rejected)
+        printf("# %s: %u deadline threads rejected by admission control\n", name, res->dl_rejected);
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --cpu N          CPU bound threads (default 500)\n"
+        "  --io N           I/O bound threads (default 2000)\n"
+        "  --procs N        processes the threads are spread over (default 64)\n"
+        "  --hog N          extra CPU bound threads in process 0 (default 0)\n"
+        "  --rt N           deadline threads (default 0)\n"
+        "  --rt-runtime US  runtime reserved per period (default 2000)\n"
+        "  --rt-period US   period and relative deadline (default 10000)\n"
+        "  --rt-job US      mean length of a job (default 1000)\n"
+        "  --burst US       mean CPU burst of I/O bound threads (default 200)\n"
+        "  --sleep US       mean sleep of I/O bound threads (default 20000)\n"
+        "  --slack US       timer slack of I/O bound threads (default 0)\n"
+        "  --tick US        scheduler timer interval (default 1000000, TIMER_INTERVAL)\n"
+        "  --duration US    simulated time (default 60000000)\n"
+        "  --switch-cost US cost of a context switch (default 5)\n"
+        "  --mmu-cost US    extra cost of a switch between processes (default 10)\n"
+        "  --seed N         workload seed (default 1)\n"
+        "  --policy LIST    comma separated: default,rr,tail,wakeup,tail+wakeup,\n"
+        "                   fair,fair+wakeup or all (default: rr,wakeup,fair)\n",
+        prog);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    struct sim_config_t cfg = {
+        .n_cpu = 500,
+        .n_io = 2000,
+        .n_procs = 64,
+        .n_hog = 0,
+        .n_rt = 0,
+        .rt_runtime = 2000,
+        .rt_period = 10000,
+        .rt_job = 1000,
+        .burst = 200,
+        .sleep = 20000,
+        .slack = 0,
+        .tick = 1000000,
+        .duration = 60000000,
+        .switch_cost = 5,
+        .mmu_cost = 10,
+        .seed = 1,
+    };
+    char *policies = "rr,wakeup,fair";
+
+    static const struct option options[] = {
+        {"cpu",         required_argument, 0, 'c'},
+        {"io",          required_argument, 0, 'i'},
+        {"procs",       required_argument, 0, 'p'},
+        {"hog",         required_argument, 0, 'H'},
+        {"rt",          required_argument, 0, 'R'},
+        {"rt-runtime",  required_argument, 0, 'u'},
+        {"rt-period",   required_argument, 0, 'e'},
+        {"rt-job",      required_argument, 0, 'j'},
+        {"burst",       required_argument, 0, 'b'},
+        {"sleep",       required_argument, 0, 's'},
+        {"slack",       required_argument, 0, 'S'},
+        {"tick",        required_argument, 0, 't'},
+        {"duration",    required_argument, 0, 'd'},
+        {"switch-cost", required_argument, 0, 'w'},
+        {"mmu-cost",    required_argument, 0, 'm'},
+        {"seed",        required_argument, 0, 'r'},
+        {"policy",      required_argument, 0, 'P'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, 0)) != -1) {
+        switch (opt)
+        {
+        case 'c': cfg.n_cpu = strtoul(optarg, 0, 0); break;
+        case 'i': cfg.n_io = strtoul(optarg, 0, 0); break;
+        case 'p': cfg.n_procs = strtoul(optarg, 0, 0); break;
+        case 'H': cfg.n_hog = strtoul(optarg, 0, 0); break;
+        case 'R': cfg.n_rt = strtoul(optarg, 0, 0); break;
+        case 'u': cfg.rt_runtime = strtoull(optarg, 0, 0); break;
+        case 'e': cfg.rt_period = strtoull(optarg, 0, 0); break;
+        case 'j': cfg.rt_job = strtoull(optarg, 0, 0); break;
+        case 'b': cfg.burst = strtoull(optarg, 0, 0); break;
+        case 's': cfg.sleep = strtoull(optarg, 0, 0); break;
+        case 'S': cfg.slack = strtoull(optarg, 0, 0); break;
+        case 't': cfg.tick = strtoull(optarg, 0, 0); break;
+        case 'd': cfg.duration = strtoull(optarg, 0, 0); break;
+        case 'w': cfg.switch_cost = strtoull(optarg, 0, 0); break;
+        case 'm': cfg.mmu_cost = strtoull(optarg, 0, 0); break;
+        case 'r': cfg.seed = strtoul(optarg, 0, 0); break;
+        case 'P': policies = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if ((optind != argc) || (cfg.n_cpu + cfg.n_io + cfg.n_rt + cfg.n_hog == 0) || (cfg.n_procs == 0) || (cfg.tick == 0))
+        usage(argv[0]);
+
+    printf("# %u cpu + %u io + %u deadline + %u hog threads in %u processes, burst %llu us, sleep %llu us, slack %llu us, tick %llu us, %llu s\n",
+        cfg.n_cpu, cfg.n_io, cfg.n_rt, cfg.n_hog, cfg.n_procs, (unsigned long long) cfg.burst,
+        (unsigned long long) cfg.sleep, (unsigned long long) cfg.slack, (unsigned long long) cfg.tick,
+        (unsigned long long) (cfg.duration / 1000000));
+    printf("%-12s %9s %9s %7s %10s %8s %8s %8s %8s %8s %8s %9s %8s\n", "policy", "switches", "timers", "util",
+        "io_ops/s", "lat_p50", "lat_p99", "lat_p999", "lat_max", "jain_cpu", "jain_io", "jain_proc", "dl_miss");
+
+    char *list = strdup(policies);
+    for (char *name = strtok(list, ","); name; name = strtok(0, ",")) {
+        uint8_t found = 0;
+        for (uint32_t i=0; i<N_POLICIES; i++) {
+            if (strcmp(name, "all") && strcmp(name, policy_names[i].name))
+                continue;
+
+            struct sim_result_t res;
+            simulate(&cfg, policy_names[i].policy, &res);
+            print_result(policy_names[i].name, &cfg, &res);
+            free(res.latencies);
+            found = 1;
+        }
+        if (!found) {
+            fprintf(stderr, "unknown policy: %s\n", name);
+            return 2;
+        }
+    }
+    free(list);
+    return 0;
+}
@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""
+Converts a kernel trace dump into the Chrome trace event format.
+
+The kernel prints the trace buffer when a user thread calls
+trace_ctl(TRACE_CTL_DUMP). Capture the console output, e.g.
+
+    make qemu | tee trace.log
+
+and convert it with
+
+    tools/trace2json.py trace.log > trace.json
+
+The result can be opened in chrome://tracing or ui.perfetto.dev.
+Only the last TRACE_BEGIN ... TRACE_END block of the log is used.
+"""
+
+import json
+import sys
+
+# event types, see include/Kernel/trace.h
+SWITCH_OUT = 0
+SWITCH_IN = 1
+SYSCALL_ENTRY = 2
+SYSCALL_EXIT = 3
+IRQ_ENTRY = 4
+IRQ_EXIT = 5
+WAKEUP = 6
+USER_MARK = 7
+
+IDLE_TID = 0xFFFF
+KERNEL_PID = 1000   # irqs are shown in their own process row
+IDLE_PID = 1001
+
+# syscall codes, see include/Kernel/syscalls.h
+SYSCALL_NAMES = {
+    0: "exit",
+    1: "thread_create",
+    2: "sleep",
+    3: "read_char",
+    4: "write_char",
+    5: "trace_mark",
+    6: "trace_ctl",
+    7: "getrusage",
+    8: "yield",
+    9: "shutdown",
+    10: "prof_ctl",
+    11: "set_deadline",
+    12: "next_period",
+    13: "ring_setup",
+    14: "ring_enter",
+    15: "spawn",
+    16: "open",
+    17: "read",
+    18: "write",
+    19: "close",
+    20: "unlink",
+    21: "mmap",
+    22: "munmap",
+    23: "block_io",
+    24: "sched_stats",
+    25: "sleep_until",
+    26: "set_timer_slack",
+    27: "set_nice",
+}
+
+IRQ_NAMES = {
+    0: "timer0",
+    1: "timer1",
+    2: "timer2",
+    3: "timer3",
+    20: "dma_memcpy",
+    21: "dma_uart_tx",
+    57: "uart",
+}
+
+WAKE_REASONS = {0: "timer", 1: "uart", 2: "ring"}
+
+
+def read_entries(lines):
+    """returns the entries of the last complete dump in the log"""
+    entries = None
+    current = None
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE_BEGIN"):
+            current = []
+        elif line.startswith("TRACE_END"):
+            if current is not None:
+                entries = current
+            current = None
+        elif current is not None and line.startswith("T "):
+            fields = line.split()
+            if len(fields) != 6:
+                continue
+            current.append((int(fields[1], 16), int(fields[2]), int(fields[3]),
+                            int(fields[4], 16), int(fields[5], 16)))
+    return entries or []
+
+
+def unwrap(entries):
+    """timestamps are 32 bit microseconds; undo wrap-arounds"""
+    offset = 0
+    last = None
+    for ts, etype, tid, arg0, arg1 in entries:
+        if last is not None and ts < last and last - ts > 0x80000000:
+            offset += 1 << 32
+        last = ts
+        yield ts + offset, etype, tid, arg0, arg1
+
+
+def convert(entries):
+    events = []
+    proc_of = {}
+
+    def pid(tid):
+        if tid == IDLE_TID:
+            return IDLE_PID
+        return proc_of.get(tid, 0)
+
+    for ts, etype, tid, arg0, arg1 in unwrap(entries):
+        if etype == SWITCH_IN:
+            if tid != IDLE_TID:
+                proc_of[tid] = arg1
+            events.append({"name": "running", "ph": "B", "ts": ts,
+                           "pid": pid(tid), "tid": tid, "args": {"prev": arg0}})
+        elif etype == SWITCH_OUT:
+            events.append({"name": "running", "ph": "E", "ts": ts,
+                           "pid": pid(tid), "tid": tid, "args": {"next": arg0}})
+        elif etype == SYSCALL_ENTRY:
+            name = SYSCALL_NAMES.get(arg0, "syscall %d" % arg0)
+            events.append({"name": name, "cat": "syscall", "ph": "B", "ts": ts,
+                           "pid": pid(tid), "tid": tid})
+        elif etype == SYSCALL_EXIT:
+            name = SYSCALL_NAMES.get(arg0, "syscall %d" % arg0)
+            events.append({"name": name, "cat": "syscall", "ph": "E", "ts": ts,
+                           "pid": pid(tid), "tid": tid, "args": {"error": arg1}})
+        elif etype in (IRQ_ENTRY, IRQ_EXIT):
+            name = IRQ_NAMES.get(arg0, "irq %d" % arg0)
+            events.append({"name": name, "cat": "irq",
+                           "ph": "B" if etype == IRQ_ENTRY else "E", "ts": ts,
+                           "pid": KERNEL_PID, "tid": 0, "args": {"interrupted": tid}})
+        elif etype == WAKEUP:
+            events.append({"name": "wakeup", "cat": "sched", "ph": "i", "s": "t",
+                           "ts": ts, "pid": pid(tid), "tid": tid,
+                           "args": {"late_us": arg0,
+                                    "reason": WAKE_REASONS.get(arg1, arg1)}})
+        elif etype == USER_MARK:
+            events.append({"name": "mark %d" % arg0, "cat": "user", "ph": "i", "s": "t",
+                           "ts": ts, "pid": pid(tid), "tid": tid, "args": {"value": arg1}})
+
+    # names for the rows of the timeline
+    meta = [{"name": "process_name", "ph": "M", "pid": KERNEL_PID, "args": {"name": "irq"}},
+            {"name": "process_name", "ph": "M", "pid": IDLE_PID, "args": {"name": "idle"}}]
+    for tid, proc in sorted(proc_of.items()):
+        meta.append({"name": "process_name", "ph": "M", "pid": proc,
+                     "args": {"name": "process %d" % proc}})
+        meta.append({"name": "thread_name", "ph": "M", "pid": proc, "tid": tid,
+                     "args": {"name": "thread %d" % tid}})
+
+    return {"traceEvents": meta + events, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) > 2:
+        sys.exit("usage: %s [console.log]" % sys.argv[0])
+
+    if len(sys.argv) == 2:
+        with open(sys.argv[1], errors="replace") as log:
+            entries = read_entries(log)
+    else:
+        entries = read_entries(sys.stdin)
+
+    if not entries:
+        sys.exit("no trace dump found")
+
+    json.dump(convert(entries), sys.stdout, indent=1)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -30,4 +30,21 @@ int32_t divide_ceil(int32_t numerator, int32_t denominator)
         result++;
 
     return result;
+}
+
+uint64_t divu64(uint64_t numerator, uint32_t denominator)
+{
+    /* shift-subtract division; there is no libgcc to provide __aeabi_uldivmod */
+    uint64_t quotient = 0;
+    uint64_t remainder = 0;
+
+    for (int32_t i=63; i>=0; i--) {
+        remainder = (remainder << 1) | ((numerator >> i) & 1);
+        if (remainder >= denominator) {
+            remainder -= denominator;
+            quotient |= ((uint64_t) 1 << i);
+        }
+    }
+
+    return quotient;
 }
\ No newline at end of file
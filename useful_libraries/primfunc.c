@@ -25,9 +25,38 @@ int32_t ctoi(char c){
 
 void kmemcpy(void * dest, const void * src, uint32_t size)
 {
+    /* word copies if both pointers can be aligned, e.g. for the
+    page sized copies of the tmpfs */
+    if ((((uint32_t) dest ^ (uint32_t) src) & 0x3) == 0) {
+        while (((uint32_t) dest & 0x3) && size) {
+            *((char*)dest) = *((char*)src);
+            dest++;
+            src++;
+            size--;
+        }
+        while (size >= 16) {
+            uint32_t *d = (uint32_t*) dest;
+            const uint32_t *s = (const uint32_t*) src;
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
+            d[3] = s[3];
+            dest += 16;
+            src += 16;
+            size -= 16;
+        }
+    }
 	for (uint32_t i=0; i<size; i++) {
         *((char*)dest) = *((char*)src);
         dest++;
         src++;
 	}
+}
+
+void kmemset(void * dest, uint8_t value, uint32_t size)
+{
+	for (uint32_t i=0; i<size; i++) {
+        *((uint8_t*)dest) = value;
+        dest++;
+	}
 }
\ No newline at end of file
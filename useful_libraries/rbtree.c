@@ -0,0 +1,252 @@
+#include <lib/rbtree.h>
+
+/* the algorithms follow Cormen et al., with 0 instead of a sentinel
+leaf; the parent of a removed node's replacement is passed explicitly */
+
+void rb_rotate_left(struct rb_tree_t *tree, struct rb_node_t *x)
+{
+    struct rb_node_t *y = x->right;
+
+    x->right = y->left;
+    if (y->left)
+        y->left->parent = x;
+    y->parent = x->parent;
+    if (!x->parent)
+        tree->root = y;
+    else if (x == x->parent->left)
+        x->parent->left = y;
+    else
+        x->parent->right = y;
+    y->left = x;
+    x->parent = y;
+}
+
+void rb_rotate_right(struct rb_tree_t *tree, struct rb_node_t *x)
+{
+    struct rb_node_t *y = x->left;
+
+    x->left = y->right;
+    if (y->right)
+        y->right->parent = x;
+    y->parent = x->parent;
+    if (!x->parent)
+        tree->root = y;
+    else if (x == x->parent->right)
+        x->parent->right = y;
+    else
+        x->parent->left = y;
+    y->right = x;
+    x->parent = y;
+}
+
+void rb_insert(struct rb_tree_t *tree, struct rb_node_t *node)
+{
+    struct rb_node_t *parent = 0;
+    struct rb_node_t **link = &tree->root;
+    uint8_t leftmost = 1;
+
+    while (*link) {
+        parent = *link;
+        if (node->key < parent->key) {
+            link = &parent->left;
+        }
+        else {
+            link = &parent->right;   // equal keys behind the existing ones
+            leftmost = 0;
+        }
+    }
+    node->parent = parent;
+    node->left = 0;
+    node->right = 0;
+    node->red = 1;
+    *link = node;
+    if (leftmost)
+        tree->leftmost = node;
+
+    /* a red node has a black parent; the root is black, so a red
+    parent always has a parent itself */
+    while (node->parent && node->parent->red) {
+        struct rb_node_t *p = node->parent;
+        struct rb_node_t *g = p->parent;
+
+        if (p == g->left) {
+            struct rb_node_t *uncle = g->right;
+            if (uncle && uncle->red) {
+                p->red = 0;
+                uncle->red = 0;
+                g->red = 1;
+                node = g;
+                continue;
+            }
+            if (node == p->right) {
+                rb_rotate_left(tree, p);
+                node = p;
+                p = node->parent;
+            }
+            p->red = 0;
+            g->red = 1;
+            rb_rotate_right(tree, g);
+        }
+        else {
+            struct rb_node_t *uncle = g->left;
+            if (uncle && uncle->red) {
+                p->red = 0;
+                uncle->red = 0;
+                g->red = 1;
+                node = g;
+                continue;
+            }
+            if (node == p->left) {
+                rb_rotate_right(tree, p);
+                node = p;
+                p = node->parent;
+            }
+            p->red = 0;
+            g->red = 1;
+            rb_rotate_left(tree, g);
+        }
+    }
+    tree->root->red = 0;
+}
+
+/* puts v in the place of u */
+void rb_transplant(struct rb_tree_t *tree, struct rb_node_t *u, struct rb_node_t *v)
+{
+    if (!u->parent)
+        tree->root = v;
+    else if (u == u->parent->left)
+        u->parent->left = v;
+    else
+        u->parent->right = v;
+    if (v)
+        v->parent = u->parent;
+}
+
+/* restores the black height after a black node above x was removed */
+void rb_erase_fixup(struct rb_tree_t *tree, struct rb_node_t *x, struct rb_node_t *parent)
+{
+    while ((x != tree->root) && (!x || !x->red)) {
+        if (x == parent->left) {
+            struct rb_node_t *w = parent->right;
+            if (w->red) {
+                w->red = 0;
+                parent->red = 1;
+                rb_rotate_left(tree, parent);
+                w = parent->right;
+            }
+            if ((!w->left || !w->left->red) && (!w->right || !w->right->red)) {
+                w->red = 1;
+                x = parent;
+                parent = x->parent;
+                continue;
+            }
+            if (!w->right || !w->right->red) {
+                w->left->red = 0;
+                w->red = 1;
+                rb_rotate_right(tree, w);
+                w = parent->right;
+            }
+            w->red = parent->red;
+            parent->red = 0;
+            w->right->red = 0;
+            rb_rotate_left(tree, parent);
+        }
+        else {
+            struct rb_node_t *w = parent->left;
+            if (w->red) {
+                w->red = 0;
+                parent->red = 1;
+                rb_rotate_right(tree, parent);
+                w = parent->left;
+            }
+            if ((!w->left || !w->left->red) && (!w->right || !w->right->red)) {
+                w->red = 1;
+                x = parent;
+                parent = x->parent;
+                continue;
+            }
+            if (!w->left || !w->left->red) {
+                w->right->red = 0;
+                w->red = 1;
+                rb_rotate_left(tree, w);
+                w = parent->left;
+            }
+            w->red = parent->red;
+            parent->red = 0;
+            w->left->red = 0;
+            rb_rotate_right(tree, parent);
+        }
+        x = tree->root;
+    }
+    if (x)
+        x->red = 0;
+}
+
+void rb_erase(struct rb_tree_t *tree, struct rb_node_t *node)
+{
+    struct rb_node_t *x;
+    struct rb_node_t *x_parent;
+    uint8_t removed_red = node->red;
+
+    if (tree->leftmost == node)
+        tree->leftmost = rb_next(node);
+
+    if (!node->left) {
+        x = node->right;
+        x_parent = node->parent;
+        rb_transplant(tree, node, node->right);
+    }
+    else if (!node->right) {
+        x = node->left;
+        x_parent = node->parent;
+        rb_transplant(tree, node, node->left);
+    }
+    else {
+        /* the successor takes the place of node */
+        struct rb_node_t *y = node->right;
+        while (y->left)
+            y = y->left;
+        removed_red = y->red;
+        x = y->right;
+        if (y->parent == node) {
+            x_parent = y;
+        }
+        else {
+            x_parent = y->parent;
+            rb_transplant(tree, y, y->right);
+            y->right = node->right;
+            y->right->parent = y;
+        }
+        rb_transplant(tree, node, y);
+        y->left = node->left;
+        y->left->parent = y;
+        y->red = node->red;
+    }
+
+    if (!removed_red)
+        rb_erase_fixup(tree, x, x_parent);
+    node->parent = node->left = node->right = 0;
+}
+
+struct rb_node_t * rb_last(const struct rb_tree_t *tree)
+{
+    struct rb_node_t *node = tree->root;
+    if (node) {
+        while (node->right)
+            node = node->right;
+    }
+    return node;
+}
+
+struct rb_node_t * rb_next(const struct rb_node_t *node)
+{
+    if (node->right) {
+        node = node->right;
+        while (node->left)
+            node = node->left;
+        return (struct rb_node_t *) node;
+    }
+    while (node->parent && (node == node->parent->right))
+        node = node->parent;
+    return node->parent;
+}
\ No newline at end of file